@@ -0,0 +1,39 @@
+# MODULE:   IpcTest
+#
+# PROVIDES:
+#   ipc_add_test( name
+#                [SOURCES source1 [source2...]]
+#                [INCLUDES dir1 [dir2...]]
+#   )
+#
+#       Builds the test.cpp of the calling directory, plus any extra SOURCES, into
+#       the executable |name|, links it against lib-streamlabs-ipc and registers it
+#       with CTest. Tests report failures through their exit code.
+#
+#       INCLUDES adds include directories on top of the calling directory and the
+#       public headers of the library.
+
+function(ipc_add_test name)
+	cmake_parse_arguments(IPC_TEST "" "" "SOURCES;INCLUDES" ${ARGN})
+
+	ADD_EXECUTABLE(${name}
+		"${CMAKE_CURRENT_SOURCE_DIR}/test.cpp"
+		${IPC_TEST_SOURCES}
+	)
+
+	IF(WIN32)
+		target_compile_definitions(${name} PRIVATE _CRT_SECURE_NO_WARNINGS)
+	ENDIF()
+
+	target_include_directories(${name} PRIVATE
+		${CMAKE_CURRENT_SOURCE_DIR}
+		${lib-streamlabs-ipc_SOURCE_DIR}/include
+		${IPC_TEST_INCLUDES}
+	)
+
+	TARGET_LINK_LIBRARIES(${name}
+		lib-streamlabs-ipc
+	)
+
+	add_test(NAME ${name} COMMAND ${name})
+endfunction()
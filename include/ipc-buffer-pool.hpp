@@ -0,0 +1,49 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <inttypes.h>
+#include <vector>
+
+namespace ipc {
+/** Recycles message buffers so that steady state calls do not allocate.
+ *
+ * Buffers are grouped in power of two size classes from 256 bytes up to
+ * 4 MiB. Each thread keeps a few buffers per class and exchanges them in
+ * batches with a global freelist. Larger buffers are not pooled.
+ */
+class buffer_pool {
+public:
+	struct statistics {
+		uint64_t hits;       // acquire() served from a cache
+		uint64_t misses;     // acquire() that had to allocate
+		uint64_t dropped;    // release() that freed the buffer instead
+		uint64_t in_use;     // buffers acquired and not yet released
+		uint64_t high_water; // highest in_use seen
+	};
+
+	// Returns a zeroed buffer of the given size.
+	static std::vector<char> acquire(size_t size);
+
+	// Takes the buffer back and leaves it empty. Meant for buffers that came
+	// from acquire(), anything else skews the in_use counter.
+	static void release(std::vector<char> &&buffer);
+
+	static statistics get_statistics();
+};
+}
@@ -0,0 +1,53 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <atomic>
+
+namespace ipc {
+/** Cooperative cancellation of a call.
+ *
+ * The server cancels the token of a call once the client gives up on it.
+ * Handlers that run for long look at is_cancelled() now and then and return
+ * early, whatever they return then is not sent. Calls only get cancelled
+ * while they run if the server has an executor, otherwise the connection is
+ * not read until the handler returns.
+ */
+class cancellation_token {
+public:
+	bool is_cancelled() const;
+	void cancel();
+
+	// Token of the call the handler on this thread runs for. Outside of a
+	// call it is one that never gets cancelled.
+	static const cancellation_token &current();
+
+	// Makes |token| the one current() returns on this thread while the
+	// scope lives.
+	class scope {
+		const cancellation_token *m_previous;
+
+	public:
+		scope(const cancellation_token *token);
+		~scope();
+	};
+
+private:
+	std::atomic_bool m_cancelled = false;
+};
+}
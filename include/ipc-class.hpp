@@ -19,6 +19,7 @@
 #pragma once
 #include "ipc.hpp"
 #include "ipc-function.hpp"
+#include "ipc-typed.hpp"
 #include "ipc-value.hpp"
 #include <map>
 #include <memory>
@@ -31,10 +32,32 @@ public:
 
 	std::string get_name();
 	bool register_function(std::shared_ptr<function> func);
+
+	/** Register a free function with a native signature under the given name.
+	 *
+	 * Parameter and return types are taken from the function, see
+	 * ipc::typed. Arguments are checked once before the call and decoded
+	 * straight from the receive buffer, and whatever the function returns
+	 * becomes the values of the reply.
+	 */
+	template<auto Fn> bool register_typed(const std::string &name)
+	{
+		typedef ipc::typed::signature<decltype(Fn)> signature;
+		call_view_handler_t handler = &signature::template invoke<Fn>;
+		std::shared_ptr<function> func = std::make_shared<function>(name, signature::parameters(), handler);
+		func->set_strict(true);
+		return register_function(func);
+	}
 	std::shared_ptr<function> get_function(const std::string &name);
 
+	// Run calls into this collection one at a time and in order, for
+	// handlers that are not thread safe. Only matters with a server executor.
+	void set_serial(bool serial);
+	bool is_serial();
+
 private:
 	std::string m_name;
+	bool m_serial = false;
 	std::map<std::string, std::shared_ptr<function>> m_functions;
 };
 }
\ No newline at end of file
@@ -17,17 +17,25 @@
 ******************************************************************************/
 
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <string>
 #include <memory>
 #include "ipc.hpp"
+#include "ipc-future.hpp"
+#include "ipc-metrics.hpp"
+#include "ipc-reply-cache.hpp"
 #include "ipc-socket.hpp"
+#include "ipc-stream.hpp"
 
 typedef void (*call_return_t)(void *data, const std::vector<ipc::value> &rval);
 extern call_return_t g_fn;
 extern void *g_data;
 extern int64_t g_cbid;
 
+typedef void (*event_handler_t)(void *data, const std::string &topic, const std::vector<ipc::value> &values);
+
 typedef void (*call_on_freez_t)(bool freez_detected, std::string app_state_path, std::string call_name, int timeout);
 
 namespace ipc {
@@ -50,14 +58,111 @@ public:
 	// The destructor will call the method anyways.
 	virtual void stop() = 0;
 
+	// Queue a call, |fn| is called with the reply once it arrives. Replies are
+	// matched by uid, so any number of calls can be in flight at once. Calls
+	// and batches made inside an ipc::priority_scope ask for its lane.
 	virtual bool call(const std::string &cname, const std::string &fname, std::vector<ipc::value> args, call_return_t fn = g_fn, void *data = g_data,
 			  int64_t &cbid = g_cbid) = 0;
 
+	// Queue a call and return right away. The future completes on the thread
+	// that reads replies, so one thread can keep many calls in flight.
+	ipc::call_future call_async(const std::string &cname, const std::string &fname, std::vector<ipc::value> args);
+
 	virtual std::vector<ipc::value> call_synchronous_helper(const std::string &cname, const std::string &fname, const std::vector<ipc::value> &args) = 0;
 
+	// Same as call() and call_synchronous_helper(), for callers that give up
+	// at |deadline|. The server does not start the call after it and replaces
+	// replies that finish after it with IPC_DEADLINE_EXCEEDED, and the
+	// synchronous form returns that error once |deadline| passes. Clients
+	// whose server does not take deadlines make a plain call.
+	virtual bool call_with_deadline(const std::string &cname, const std::string &fname, std::vector<ipc::value> args,
+					std::chrono::steady_clock::time_point deadline, call_return_t fn = g_fn, void *data = g_data, int64_t &cbid = g_cbid)
+	{
+		return call(cname, fname, std::move(args), fn, data, cbid);
+	}
+	virtual std::vector<ipc::value> call_synchronous_with_deadline(const std::string &cname, const std::string &fname, const std::vector<ipc::value> &args,
+								       std::chrono::steady_clock::time_point deadline)
+	{
+		return call_synchronous_helper(cname, fname, args);
+	}
+
+	// Forget a call made with call(), |fn| will not be called for it. If the
+	// server takes cancel frames it takes the call off its queue, or cancels
+	// the ipc::cancellation_token its handler sees. False if the call already
+	// completed or the client can not cancel calls. Calls sent together by
+	// call_batch() can not be cancelled.
+	virtual bool cancel_call(int64_t cbid)
+	{
+		return false;
+	}
+
+	struct call_spec {
+		std::string cname;
+		std::string fname;
+		std::vector<ipc::value> args;
+	};
+
+	// Make several calls at once. The server runs them in order and every
+	// entry of the result is what call_synchronous_helper() would have
+	// returned for that call, so a failed call leaves a Null value holding
+	// the error while the others still succeed. The result is empty if the
+	// batch could not be sent at all.
+	// Clients that can not put the calls into one message make them one by one.
+	virtual std::vector<std::vector<ipc::value>> call_batch(std::vector<call_spec> calls)
+	{
+		std::vector<std::vector<ipc::value>> results;
+		results.reserve(calls.size());
+		for (call_spec &spec : calls) {
+			results.push_back(call_synchronous_helper(spec.cname, spec.fname, spec.args));
+		}
+		return results;
+	}
+
+	// Have |fn| called with the values the server publishes on |topic|, on the
+	// thread that reads replies. Events of a topic may be coalesced, so |fn|
+	// sees the latest values but not necessarily every one. False if the
+	// server does not take subscriptions.
+	virtual bool subscribe(const std::string &topic, event_handler_t fn, void *data)
+	{
+		return false;
+	}
+
+	virtual bool unsubscribe(const std::string &topic)
+	{
+		return false;
+	}
+
+	// Start a stream of bytes for a call, pass its id() as an argument and
+	// have the handler read it with stream_reader::open(). The calls and the
+	// stream may go out in any order. nullptr if the server does not take
+	// streams. Writes fail once the handler drops its reader before the end.
+	virtual std::shared_ptr<ipc::stream_writer> open_stream()
+	{
+		return nullptr;
+	}
+
+	// Replies of functions the server marks cacheable are kept by the client
+	// and answered without a round trip, on the calling thread, until the
+	// server sends an invalidation notice. Clients without events never
+	// cache. A capacity of 0 turns the cache off.
+	virtual void set_cache_capacity(size_t entries) {}
+	virtual ipc::reply_cache::statistics cache_statistics()
+	{
+		return {};
+	}
+
+	// Round trip percentiles of call_synchronous_helper() by "collection::function".
+	std::map<std::string, ipc::latency_summary> snapshot_metrics()
+	{
+		return m_metrics.snapshot();
+	}
+
 	std::atomic_bool m_shutting_down = false;
 	call_on_freez_t freez_cb = nullptr;
 	std::string app_state_path;
 	void set_freez_callback(call_on_freez_t cb, std::string app_state);
+
+protected:
+	ipc::metrics_registry m_metrics;
 };
 }
@@ -0,0 +1,115 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#pragma once
+#include "ipc-metrics.hpp"
+#include "ipc-priority.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ipc {
+/** Work stealing thread pool used by the server to run function calls.
+ *
+ * Every worker owns a queue. Tasks posted from a worker go to its own queue,
+ * all other tasks are spread over the workers. A worker runs the oldest task
+ * of its own queue, steals the oldest task of another worker once its own
+ * queue is empty, and only sleeps when every queue is. Posting takes the
+ * lock of one worker, the shared lock is only taken to wake sleeping
+ * workers. Tasks posted to the same strand run one at a time, in order.
+ *
+ * Every queue is split into one lane per ipc::priority. Each worker picks
+ * the lane of its next task among those with tasks waiting by smooth
+ * weighted round robin, with weights of 16, 4 and 1 from interactive to
+ * bulk. Lower lanes still move under a flood of higher ones.
+ */
+class executor {
+public:
+	typedef std::function<void()> task_t;
+	// Identifies a posted task until it starts, never 0.
+	typedef uint64_t ticket_t;
+
+private:
+	struct queued_task {
+		ticket_t ticket;
+		task_t task;
+		std::chrono::steady_clock::time_point posted;
+	};
+
+public:
+	class strand {
+		std::mutex lock;
+		std::deque<queued_task> tasks;
+		bool running = false;
+
+		friend class executor;
+	};
+
+	executor(size_t threads);
+	~executor();
+
+	ticket_t post(task_t task, ipc::priority lane = ipc::priority::normal);
+	// The strand runs in the lane of the task that found it idle.
+	ticket_t post(const std::shared_ptr<strand> &serial, task_t task, ipc::priority lane = ipc::priority::normal);
+
+	// Drop a task that did not start yet, which releases it right away. False
+	// if it started already or was posted to another strand.
+	bool cancel(ticket_t ticket);
+	bool cancel(const std::shared_ptr<strand> &serial, ticket_t ticket);
+
+	size_t size();
+	ipc::lane_summary get_lane_summary(ipc::priority lane);
+
+private:
+	struct worker {
+		std::mutex lock;
+		std::deque<queued_task> tasks[ipc::priority_count];
+		std::thread thread;
+		// Round robin state of the lane choice, only used by the worker.
+		int64_t credit[ipc::priority_count] = {};
+	};
+
+	std::vector<std::unique_ptr<worker>> m_workers;
+	std::atomic<size_t> m_next;
+	std::atomic<ticket_t> m_last_ticket;
+
+	// Tasks queued per lane over all workers.
+	std::atomic<size_t> m_queued[ipc::priority_count];
+	std::atomic<size_t> m_peak[ipc::priority_count];
+	ipc::histogram m_wait[ipc::priority_count];
+
+	// Workers about to sleep or sleeping. A worker counts itself and looks at
+	// the queues once more under the lock, so a post either finds it counted
+	// and wakes it, or is seen by that last look.
+	std::mutex m_idle_lock;
+	std::condition_variable m_idle_cv;
+	std::atomic<size_t> m_sleeping;
+	bool m_stop = false;
+
+	void run(size_t index);
+	void run_strand(std::shared_ptr<strand> serial);
+	bool take(size_t index, task_t &task);
+	bool take_lane(size_t index, size_t lane, task_t &task);
+};
+}
@@ -23,6 +23,9 @@
 
 namespace ipc {
 typedef void (*call_handler_t)(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval);
+// Same as call_handler_t, but the arguments point into the receive buffer,
+// which stays alive until the handler returns.
+typedef void (*call_view_handler_t)(void *data, const int64_t id, const std::vector<ipc::value_view> &args, std::vector<ipc::value> &rval);
 
 class function {
 public:
@@ -30,8 +33,12 @@ public:
 	function(const std::string &name, const std::vector<ipc::type> &params, call_handler_t ptr);
 	function(const std::string &name, const std::vector<ipc::type> &params, void *data);
 	function(const std::string &name, const std::vector<ipc::type> &params);
+	function(const std::string &name, const std::vector<ipc::type> &params, call_view_handler_t ptr, void *data);
+	function(const std::string &name, const std::vector<ipc::type> &params, call_view_handler_t ptr);
 	function(const std::string &name, call_handler_t ptr, void *data);
 	function(const std::string &name, call_handler_t ptr);
+	function(const std::string &name, call_view_handler_t ptr, void *data);
+	function(const std::string &name, call_view_handler_t ptr);
 	function(const std::string &name, void *data);
 	function(const std::string &name);
 	virtual ~function();
@@ -51,11 +58,48 @@ public:
 		*
 		*/
 	void call(const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval);
+	void call(const int64_t id, const std::vector<ipc::value_view> &args, std::vector<ipc::value> &rval);
+
+	/** Have the server reject calls whose arguments do not match the
+	 * parameter types, before the handler runs. Off by default, as the
+	 * parameters given by older registrations are not always accurate.
+	 */
+	void set_strict(bool strict);
+	bool is_strict();
+
+	/** Let the server answer repeated calls with the same arguments from its
+	 * reply cache instead of running the handler again. Only for handlers
+	 * whose reply depends on nothing but the arguments, not on the client
+	 * or on state that changes without server::invalidate() being called.
+	 * Tags name the state the reply depends on, see
+	 * server::invalidate_tag(). Clients that support it keep replies of
+	 * their own and drop them on the server's invalidation notices.
+	 */
+	void set_cacheable(bool cacheable, const std::vector<std::string> &tags = {});
+	bool is_cacheable();
+	bool has_cache_tag(const std::string &tag);
+
+	/** Lane calls of this function run in unless the client asks for
+	 * another, see ipc::priority. Normal by default.
+	 */
+	void set_priority(ipc::priority lane);
+	ipc::priority get_priority();
+
+	// Whether the arguments suit a strict function, always true otherwise.
+	bool check_arguments(const std::vector<ipc::value_view> &args, std::string &errormsg);
+	bool check_arguments(const std::vector<ipc::value> &args, std::string &errormsg);
 
 private:
 	std::string m_name, m_nameUnique;
 	std::vector<ipc::type> m_params;
 
 	std::pair<call_handler_t, void *> m_callHandler;
+	call_view_handler_t m_callViewHandler = nullptr;
+	bool m_strict = false;
+	bool m_cacheable = false;
+	std::vector<std::string> m_cache_tags;
+	ipc::priority m_priority = ipc::priority::normal;
+
+	template<typename T> bool check(const std::vector<T> &args, std::string &errormsg);
 };
 }
\ No newline at end of file
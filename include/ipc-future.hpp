@@ -0,0 +1,104 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ipc-value.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define IPC_HAS_COROUTINES 1
+#endif
+
+namespace ipc {
+/** Result of a call made with client::call_async().
+ *
+ * The reply is stored by the thread that reads replies, which also runs the
+ * continuation given to then(), if any. The future only becomes ready once
+ * that continuation is done. Waiting uses a mutex and a condition
+ * variable, so no kernel object is created per call. Errors follow the
+ * call_synchronous_helper() convention: a Null value holding the message, or
+ * no values if the call could not be sent.
+ *
+ * With C++20 coroutines the future can be awaited as well, the coroutine is
+ * then resumed on the reply thread.
+ */
+class call_future {
+public:
+	using continuation_t = std::function<void(std::vector<ipc::value> &values)>;
+
+	// Shared between the future and the pending call.
+	struct state {
+		std::mutex lock;
+		std::condition_variable cv;
+		bool replied = false; // the reply is in, the continuation may still be running
+		bool ready = false;   // the continuation, if any, is done as well
+		std::vector<ipc::value> values;
+		continuation_t continuation;
+		std::shared_ptr<state> self; // keeps the state alive while the call is pending
+
+		// Only the first completion counts.
+		void complete(const std::vector<ipc::value> &rval);
+	};
+
+	call_future() {}
+	explicit call_future(std::shared_ptr<state> state) : m_state(std::move(state)) {}
+
+	bool valid() const
+	{
+		return m_state != nullptr;
+	}
+
+	bool ready() const;
+	void wait() const;
+	bool wait_for(std::chrono::nanoseconds timeout) const;
+
+	// Blocks until the reply is there and the continuation has run, then
+	// hands out the values, once.
+	std::vector<ipc::value> get();
+
+	// Runs |fn| with the values once the reply is there, right away if it
+	// already is. Whatever |fn| leaves in the values is what get() returns.
+	void then(continuation_t fn);
+
+#ifdef IPC_HAS_COROUTINES
+	bool await_ready() const
+	{
+		return ready();
+	}
+
+	void await_suspend(std::coroutine_handle<> handle)
+	{
+		then([handle](std::vector<ipc::value> &values) { handle.resume(); });
+	}
+
+	// Either ready or resumed by the continuation, after the reply is in.
+	std::vector<ipc::value> await_resume()
+	{
+		return std::move(m_state->values);
+	}
+#endif
+
+private:
+	std::shared_ptr<state> m_state;
+};
+}
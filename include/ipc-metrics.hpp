@@ -0,0 +1,97 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+
+namespace ipc {
+struct latency_summary {
+	uint64_t count = 0;
+	std::chrono::nanoseconds p50{0};
+	std::chrono::nanoseconds p99{0};
+	std::chrono::nanoseconds p999{0};
+	std::chrono::nanoseconds max{0};
+};
+
+/** Log-linear latency histogram in the spirit of HdrHistogram.
+ *
+ * Every power of two is split into 16 buckets, which keeps percentiles within
+ * about 6% of the real value, from nanoseconds up to roughly 18 minutes.
+ * Recording is a relaxed atomic increment, so it is cheap enough to run on
+ * every call from any thread.
+ */
+class histogram {
+public:
+	histogram();
+
+	void record(std::chrono::nanoseconds duration);
+	latency_summary summarize() const;
+
+private:
+	static constexpr size_t sub_bucket_bits = 4;
+	static constexpr size_t sub_buckets = size_t(1) << sub_bucket_bits;
+	static constexpr size_t max_exponent = 39;
+	static constexpr size_t bucket_count = sub_buckets + (max_exponent - sub_bucket_bits + 1) * sub_buckets;
+
+	std::atomic<uint64_t> m_counts[bucket_count];
+	std::atomic<uint64_t> m_max;
+
+	static size_t bucket_for(uint64_t value);
+	static uint64_t highest_in_bucket(size_t bucket);
+};
+
+// Server side timing of one function.
+struct function_metrics {
+	histogram queue_wait; // request read until the handler starts
+	histogram handler;
+	histogram serialize; // encoding the reply
+	std::atomic<uint64_t> cache_hits{0};
+	std::atomic<uint64_t> cache_misses{0};
+};
+
+struct function_summary {
+	latency_summary queue_wait;
+	latency_summary handler;
+	latency_summary serialize;
+	uint64_t cache_hits = 0;
+	uint64_t cache_misses = 0;
+};
+
+// Queueing in one lane of the executor, see ipc::priority.
+struct lane_summary {
+	uint64_t depth = 0;         // tasks waiting right now
+	uint64_t peak_depth = 0;    // most tasks ever waiting at once
+	latency_summary queue_wait; // posted until a worker took the task
+};
+
+// Histograms by name, created on first use.
+class metrics_registry {
+public:
+	histogram &get(const std::string &name);
+	std::map<std::string, latency_summary> snapshot();
+
+private:
+	std::shared_mutex m_lock;
+	std::map<std::string, std::unique_ptr<histogram>> m_histograms;
+};
+}
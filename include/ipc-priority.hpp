@@ -0,0 +1,50 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace ipc {
+/** Priority class of a call.
+ *
+ * Every class has a lane of its own. The server's executor queues calls per
+ * lane and takes the next one by weight, so a burst of bulk calls delays an
+ * interactive one by a few calls at most. Call and reply frames also go out
+ * ahead of the frames of lower lanes still waiting to be written. A call
+ * runs in the lane the client asks for, see priority_scope, or else in the
+ * one its function was registered with, see function::set_priority().
+ */
+enum class priority : uint8_t { interactive, normal, bulk };
+const size_t priority_count = 3;
+
+const char *priority_name(priority lane);
+
+// Calls made on this thread while the scope lives ask for |lane|.
+class priority_scope {
+	const priority *m_previous;
+	priority m_lane;
+
+public:
+	priority_scope(priority lane);
+	~priority_scope();
+
+	// Lane of the innermost scope on this thread, null outside of any.
+	static const priority *current();
+};
+}
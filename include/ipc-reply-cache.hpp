@@ -0,0 +1,86 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "ipc-value.hpp"
+#include <cstddef>
+#include <inttypes.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ipc {
+/** Replies of cacheable functions, by function id and arguments.
+ *
+ * The key is the function id followed by the arguments in a compact
+ * encoding, so calls only match when their arguments are equal. The cache
+ * holds a bounded number of replies and drops the least recently used one
+ * to make room.
+ */
+class reply_cache {
+public:
+	struct statistics {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;     // replies dropped to make room
+		uint64_t invalidations; // replies dropped by invalidate()
+		uint64_t entries;
+	};
+
+	reply_cache(size_t capacity = 1024);
+
+	// Maximum number of replies kept, 0 turns the cache off.
+	void set_capacity(size_t capacity);
+
+	static std::string make_key(uint32_t fid, const std::vector<ipc::value_view> &args);
+	static std::string make_key(uint32_t fid, const std::vector<ipc::value> &args);
+
+	// Copies a cached reply into |rval|, counting a hit or a miss.
+	bool find(const std::string &key, std::vector<ipc::value> &rval);
+
+	// Current generation, to be taken before running the handler and passed
+	// to insert(). Replies computed across an invalidation are not kept.
+	uint64_t generation();
+	void insert(std::string key, uint32_t fid, const std::vector<ipc::value> &rval, uint64_t generation);
+
+	// Both return the generation that follows the invalidation.
+	uint64_t invalidate(uint32_t fid);
+	uint64_t clear();
+
+	statistics get_statistics();
+
+private:
+	struct entry {
+		std::string key;
+		uint32_t fid;
+		std::vector<ipc::value> rval;
+	};
+
+	std::mutex m_lock;
+	size_t m_capacity;
+	uint64_t m_generation = 0;
+	// Most recently used first.
+	std::list<entry> m_entries;
+	std::unordered_map<std::string, std::list<entry>::iterator> m_index;
+	statistics m_statistics = {};
+
+	void erase(std::list<entry>::iterator it);
+};
+}
@@ -29,4 +29,12 @@ public:
 	server_instance(){};
 	virtual ~server_instance(){};
 };
+
+// Takes the events of the topics a client subscribed to, see server::publish().
+// The server holds on to it, so it may outlive its instance.
+class event_sink {
+public:
+	virtual ~event_sink(){};
+	virtual void push_event(const std::string &topic, const std::vector<ipc::value> &values) = 0;
+};
 }
\ No newline at end of file
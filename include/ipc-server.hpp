@@ -19,11 +19,20 @@
 #pragma once
 #include "ipc.hpp"
 #include "ipc-class.hpp"
+#include "ipc-executor.hpp"
+#include "ipc-metrics.hpp"
+#include "ipc-reply-cache.hpp"
 #include "ipc-server-instance.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <list>
 #include <map>
 #include <mutex>
 #include <queue>
+#include <set>
+#include <shared_mutex>
 #include <string>
 #include <thread>
 #include <functional>
@@ -31,6 +40,7 @@
 
 namespace ipc {
 class server_instance;
+class event_sink;
 
 typedef bool (*server_connect_handler_t)(void *, int64_t);
 typedef void (*server_disconnect_handler_t)(void *, int64_t);
@@ -44,15 +54,46 @@ class server {
 	// Functions
 	std::map<std::string, std::shared_ptr<ipc::collection>> m_classes;
 
+	// Dispatch table, indexed by function id.
+	struct function_entry {
+		std::string cname;
+		std::string fname;
+		std::shared_ptr<ipc::collection> cls;
+		std::shared_ptr<ipc::function> fnc;
+		std::shared_ptr<ipc::function_metrics> metrics;
+	};
+	std::shared_mutex m_functions_mtx;
+	std::deque<function_entry> m_functions;
+	std::map<std::pair<std::string, std::string>, uint32_t> m_function_ids;
+	ipc::reply_cache m_cache;
+	std::atomic<uint64_t> m_expired_calls = 0;
+	std::atomic<uint64_t> m_expired_replies = 0;
+	std::atomic<uint64_t> m_cancelled_calls = 0;
+	std::atomic<uint64_t> m_cancelled_handlers = 0;
+	bool find_cached(const std::string &key, ipc::function_metrics *metrics, std::vector<ipc::value> &rval);
+	// Tells subscribed clients to drop their cached replies of a function.
+	void notify_invalidated(uint32_t fid, uint64_t generation);
+	static void resolve_function_handler(void *data, const int64_t id, const std::vector<ipc::value_view> &args, std::vector<ipc::value> &rval);
+
+	// Executor
+	std::shared_ptr<ipc::executor> m_executor;
+	std::mutex m_strands_mtx;
+	std::map<std::string, std::shared_ptr<ipc::executor::strand>> m_strands;
+	// Strand of the serial collection |call| belongs to, null for the others.
+	std::shared_ptr<ipc::executor::strand> find_strand(const ipc::message::function_call_view &call);
+
 	// Socket
 	std::mutex m_sockets_mtx;
 #ifdef WIN32
 	std::list<std::shared_ptr<ipc::socket>> m_sockets;
 #elif __APPLE__
 	std::list<std::shared_ptr<ipc::socket>> m_sockets;
+#elif __linux__
+	std::list<std::shared_ptr<ipc::socket>> m_sockets;
 #endif
 	std::string m_socketPath = "";
 	int m_callTimeout = 0;
+	size_t m_listeningInstances = 4;
 
 	// Client management.
 	std::mutex m_clients_mtx;
@@ -60,8 +101,14 @@ class server {
 	std::map<std::shared_ptr<ipc::socket>, std::shared_ptr<server_instance>> m_clients;
 #elif __APPLE__
 	std::map<std::shared_ptr<ipc::socket>, std::shared_ptr<server_instance>> m_clients;
+#elif __linux__
+	std::map<std::shared_ptr<ipc::socket>, std::shared_ptr<server_instance>> m_clients;
 #endif
 
+	// Clients subscribed to each topic.
+	std::mutex m_subscribers_mtx;
+	std::map<std::string, std::set<std::shared_ptr<event_sink>>> m_subscribers;
+
 	// Event Handlers
 	std::pair<server_connect_handler_t, void *> m_handlerConnect;
 	std::pair<server_disconnect_handler_t, void *> m_handlerDisconnect;
@@ -72,10 +119,18 @@ class server {
 	// Worker
 	struct {
 		std::thread worker;
-		bool stop = false;
+		std::atomic_bool stop = false;
+		std::mutex lock;
+		std::condition_variable cv;
+		std::deque<std::shared_ptr<ipc::socket>> pending; // sockets to look at
 	} m_watcher;
 
 	void watcher();
+#ifdef __linux__
+	void watch_socket(std::shared_ptr<ipc::socket> socket);
+	void check_socket(std::shared_ptr<ipc::socket> socket);
+	void listen_socket(std::shared_ptr<ipc::socket> socket);
+#endif
 
 #ifdef WIN32
 	void spawn_client(std::shared_ptr<ipc::socket> socket);
@@ -83,6 +138,9 @@ class server {
 #elif __APPLE__
 	void spawn_client(std::shared_ptr<ipc::socket> socket);
 	void kill_client(std::shared_ptr<ipc::socket> socket);
+#elif __linux__
+	void spawn_client(std::shared_ptr<ipc::socket> socket);
+	void kill_client(std::shared_ptr<ipc::socket> socket);
 #endif
 
 public:
@@ -99,6 +157,15 @@ public: // Status
 	void finalize();
 	void set_call_timeout(int callTimeout);
 
+	// Number of instances kept listening for new clients, every connected
+	// client has an instance of its own. Call before initialize(). Has no
+	// effect on macOS, where all clients share one pair of FIFOs.
+	void set_listening_instances(size_t count);
+
+	// Run function calls on a pool of |threads| workers instead of the thread
+	// reading the connection, 0 runs them inline. Call before initialize().
+	void set_executor_threads(size_t threads = std::thread::hardware_concurrency());
+
 public: // Events
 	void set_connect_handler(server_connect_handler_t handler, void *data);
 	void set_disconnect_handler(server_disconnect_handler_t handler, void *data);
@@ -107,11 +174,95 @@ public: // Events
 	void set_post_callback(server_post_callback_t handler, void *data);
 
 public: // Functionality
+	static const uint32_t invalid_function_id = UINT32_MAX;
+
 	bool register_collection(std::shared_ptr<ipc::collection> cls);
 
+	// Dense id of a function, assigned on first use. Calls may carry the id
+	// in place of the names, see IPC_RESOLVE_FUNCTION.
+	uint32_t resolve_function(const std::string &cname, const std::string &fname);
+
+	// Latency percentiles and call counts by "collection::function".
+	std::map<std::string, ipc::function_summary> snapshot_metrics();
+
+	// Queue depth and wait of each lane of the executor by ipc::priority_name(),
+	// all zero without an executor.
+	std::map<std::string, ipc::lane_summary> snapshot_lanes();
+
+public: // Reply cache
+	// Number of replies kept for cacheable functions, see
+	// function::set_cacheable(). Defaults to 1024, 0 turns caching off.
+	void set_cache_capacity(size_t entries);
+
+	// Drop cached replies once the state they were computed from changed,
+	// here and in clients that cache replies themselves.
+	void invalidate(const std::string &cname, const std::string &fname);
+	void invalidate_tag(const std::string &tag);
+	void invalidate_all();
+
+	ipc::reply_cache::statistics cache_statistics();
+
+public: // Deadlines
+	struct deadline_statistics {
+		uint64_t expired_calls;   // dropped before their handler ran
+		uint64_t expired_replies; // replaced by an error as the handler finished late
+	};
+	deadline_statistics get_deadline_statistics();
+
+	// Whether a call's deadline passed, which counts it as dropped.
+	bool drop_expired(uint64_t deadline, bool handler_ran);
+
+public: // Cancellation
+	struct cancel_statistics {
+		uint64_t cancelled_calls;    // dropped while queued
+		uint64_t cancelled_handlers; // cancelled while their handler ran
+	};
+	cancel_statistics get_cancel_statistics();
+	void count_cancelled(bool handler_ran);
+
 public: // Client -> Server
+	// Timing of one call. |queued| is when the request was read, the queue
+	// wait and handler time are recorded by client_call_function(), which
+	// also points |metrics| at the function so the caller can add the time
+	// it took to serialize the reply.
+	struct call_timing {
+		std::chrono::steady_clock::time_point queued;
+		ipc::function_metrics *metrics = nullptr;
+	};
+
 	bool client_call_function(int64_t cid, const std::string &cname, const std::string &fname, std::vector<ipc::value> &args, std::vector<ipc::value> &rval,
 				  std::string &errormsg);
+	bool client_call_function(int64_t cid, const ipc::message::function_call_view &call, std::vector<ipc::value> &rval, std::string &errormsg,
+				  call_timing *timing = nullptr);
+
+	// Lane |call| runs in: the one the client asked for if any, else the one
+	// its function was registered with.
+	ipc::priority call_priority(const ipc::message::function_call_view &call, const ipc::priority *requested);
+
+	// Run |task| for |call|, on the executor if there is one. Returns the
+	// ticket of the queued task, 0 if it ran right away.
+	ipc::executor::ticket_t dispatch(const ipc::message::function_call_view &call, std::function<void()> task,
+					 ipc::priority lane = ipc::priority::normal);
+
+	// Take a task dispatch() queued for |call| off the queue again. False if
+	// it started already, then it runs as usual.
+	bool withdraw(const ipc::message::function_call_view &call, ipc::executor::ticket_t ticket);
+
+	// Called by an instance once its connection is gone, so that the watcher
+	// removes it and accepts the next client on the socket.
+	void client_disconnected(std::shared_ptr<ipc::socket> socket);
+
+public: // Server -> Client
+	// Push |values| to every client subscribed to |topic|. Events are
+	// coalesced per topic: while a client is still receiving earlier events,
+	// newer values replace the ones waiting for the same topic, so a client
+	// gets the latest state instead of a backlog.
+	void publish(const std::string &topic, const std::vector<ipc::value> &values);
+
+	// Subscriptions of a client, which drops them all once it goes away.
+	void subscribe(std::shared_ptr<event_sink> sink, const std::string &topic);
+	void unsubscribe(std::shared_ptr<event_sink> sink, const std::string &topic);
+	void unsubscribe_all(std::shared_ptr<event_sink> sink);
 
 	friend class server_instance;
 };
@@ -0,0 +1,190 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <inttypes.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ipc {
+/** Sending end of a stream of bytes, see client::open_stream().
+ *
+ * The bytes go out in chunks of their own frames, so other calls keep
+ * flowing on the same connection. The sender may be ahead of the receiver
+ * by at most the window, after that write() waits for the receiver to hand
+ * out more credit as it reads.
+ */
+class stream_writer {
+public:
+	static constexpr size_t chunk_size = 64 * 1024;
+	static constexpr size_t window = 1024 * 1024;
+
+	// Sends one chunk with ipc::stream_end and ipc::stream_reset |flags|.
+	// False if the connection is gone.
+	typedef std::function<bool(uint64_t id, const char *data, size_t length, uint8_t flags)> send_t;
+
+	stream_writer(uint64_t id, send_t send);
+	// Abandons the stream if it was not closed.
+	~stream_writer();
+
+	// Pass this to the handler, which opens the reader with it.
+	uint64_t id() const
+	{
+		return m_id;
+	}
+
+	// Blocks while the window is used up. Must not be called on the thread
+	// that reads replies. False if the connection is gone.
+	bool write(const char *data, size_t length);
+
+	// Marks the end of the stream.
+	bool close();
+
+	// Called by the connection. reset() is for a receiver that dropped the
+	// stream, it fails the writes and ends the stream on the wire.
+	void add_credit(size_t bytes);
+	void fail();
+	void reset();
+
+private:
+	uint64_t m_id;
+	send_t m_send;
+	// Held while sending, so nothing follows the last frame of the stream.
+	std::mutex m_send_lock;
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+	size_t m_credit = window;
+	bool m_closed = false;
+	bool m_failed = false;
+};
+
+/** Receiving end of a stream, for a handler.
+ *
+ * Chunks are kept as they arrived until read, and credit goes back to the
+ * sender as they are consumed.
+ *
+ * Reading blocks until the sender catches up, so handlers that take streams
+ * have to run on the server's executor, see server::set_executor_threads().
+ * Inline they would block the thread that receives the chunks.
+ */
+class stream_reader {
+public:
+	// Hands |bytes| of credit back to the sender.
+	typedef std::function<void(uint64_t id, size_t bytes)> grant_t;
+
+	// The reader for stream |id| of the connection whose call the calling
+	// thread is handling, nullptr outside of a handler.
+	static std::shared_ptr<stream_reader> open(uint64_t id);
+
+	stream_reader(uint64_t id, grant_t grant);
+
+	// Dropping the last reference before the end of the stream resets it,
+	// which makes the sender's writes fail.
+	~stream_reader();
+
+	// Blocks until there is data. Returns 0 once the stream ended, or if the
+	// connection is gone.
+	size_t read(char *buffer, size_t length);
+
+	// Whether the stream ended and everything has been read.
+	bool eof();
+
+	// Whether the connection went away or the sender abandoned the stream
+	// before the end.
+	bool failed();
+
+	// Called by the connection. |data| is a received frame, the chunk starts
+	// at |offset|.
+	void push(std::vector<char> &&data, size_t offset, bool end);
+	void fail();
+
+private:
+	struct chunk {
+		std::vector<char> data;
+		size_t offset;
+	};
+
+	uint64_t m_id;
+	grant_t m_grant;
+	// Set once opened, tells the table the reader is gone.
+	std::function<void(uint64_t id)> m_abandon;
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+	std::deque<chunk> m_chunks;
+	size_t m_consumed = 0;
+	bool m_ended = false;
+	bool m_failed = false;
+
+	friend class stream_table;
+};
+
+/** Streams a connection receives, by id. */
+class stream_table : public std::enable_shared_from_this<stream_table> {
+public:
+	// Streams nobody opened yet, each holds up to a window of chunks. Past
+	// this the oldest one is reset.
+	static constexpr size_t max_unopened = 16;
+
+	// |grant| also sends the resets, as a credit of zero.
+	stream_table(stream_reader::grant_t grant);
+
+	// Chunks may arrive before the handler opens the reader and the other
+	// way around, whichever comes first creates it. The table only keeps
+	// the reader until it is opened. A stream is forgotten once it was
+	// opened and has ended, or once it was reset and the sender ended it.
+	std::shared_ptr<stream_reader> open(uint64_t id);
+	void push(uint64_t id, std::vector<char> &&data, size_t offset, uint8_t flags);
+
+	// The connection is gone.
+	void fail_all();
+
+	// Makes |table| the one stream_reader::open() uses on this thread while
+	// the scope lives.
+	class scope {
+		stream_table *m_previous;
+
+	public:
+		scope(stream_table *table);
+		~scope();
+	};
+
+private:
+	struct entry {
+		// Holds the chunks until the stream is opened.
+		std::shared_ptr<stream_reader> pending;
+		std::weak_ptr<stream_reader> reader;
+		bool opened = false;
+		bool ended = false;
+		// Chunks still in flight are dropped until the sender's last frame.
+		bool reset = false;
+	};
+
+	stream_reader::grant_t m_grant;
+	std::mutex m_lock;
+	std::map<uint64_t, entry> m_readers;
+	size_t m_unopened = 0;
+	bool m_failed = false;
+
+	entry &find(uint64_t id, std::vector<uint64_t> &resets);
+	void abandon(uint64_t id);
+};
+}
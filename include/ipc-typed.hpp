@@ -0,0 +1,132 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "ipc-value.hpp"
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ipc {
+/** Marshalling for handlers with native signatures, see
+ * ipc::collection::register_typed().
+ *
+ * Parameters may be any of int32_t, uint32_t, int64_t, uint64_t, float,
+ * double, std::string, std::vector<char>, or std::string_view and
+ * ipc::span<const char>, which point into the receive buffer and are only
+ * valid while the handler runs. Handlers return void, one value or a
+ * std::tuple of them, which become the values of the reply.
+ */
+namespace typed {
+template<typename T> struct dependent_false : std::false_type {};
+
+template<typename T> struct traits {
+	static_assert(dependent_false<T>::value, "Type can not be passed through ipc::value");
+};
+
+// Every member of the value union starts at its beginning.
+template<typename T, ipc::type TYPE> struct number_traits {
+	static constexpr ipc::type type = TYPE;
+	static T decode(const ipc::value_view &v)
+	{
+		T result;
+		memcpy(&result, &v.value_union, sizeof(T));
+		return result;
+	}
+	static ipc::value encode(T v) { return ipc::value(v); }
+};
+
+template<> struct traits<int32_t> : number_traits<int32_t, ipc::type::Int32> {};
+template<> struct traits<uint32_t> : number_traits<uint32_t, ipc::type::UInt32> {};
+template<> struct traits<int64_t> : number_traits<int64_t, ipc::type::Int64> {};
+template<> struct traits<uint64_t> : number_traits<uint64_t, ipc::type::UInt64> {};
+template<> struct traits<float> : number_traits<float, ipc::type::Float> {};
+template<> struct traits<double> : number_traits<double, ipc::type::Double> {};
+
+template<> struct traits<std::string> {
+	static constexpr ipc::type type = ipc::type::String;
+	static std::string decode(const ipc::value_view &v) { return std::string(v.value_str); }
+	static ipc::value encode(std::string v)
+	{
+		ipc::value result(std::string{});
+		result.value_str = std::move(v);
+		return result;
+	}
+};
+
+template<> struct traits<std::string_view> {
+	static constexpr ipc::type type = ipc::type::String;
+	static std::string_view decode(const ipc::value_view &v) { return v.value_str; }
+};
+
+template<> struct traits<std::vector<char>> {
+	static constexpr ipc::type type = ipc::type::Binary;
+	static std::vector<char> decode(const ipc::value_view &v) { return std::vector<char>(v.value_bin.begin(), v.value_bin.end()); }
+	static ipc::value encode(std::vector<char> v) { return ipc::value(v); }
+};
+
+template<> struct traits<ipc::span<const char>> {
+	static constexpr ipc::type type = ipc::type::Binary;
+	static ipc::span<const char> decode(const ipc::value_view &v) { return v.value_bin; }
+};
+
+// Values of the reply for what the handler returned.
+template<typename R> struct results {
+	static void encode(R &&value, std::vector<ipc::value> &rval) { rval.push_back(traits<std::decay_t<R>>::encode(std::move(value))); }
+};
+
+template<typename... Ts> struct results<std::tuple<Ts...>> {
+	static void encode(std::tuple<Ts...> &&values, std::vector<ipc::value> &rval)
+	{
+		rval.reserve(rval.size() + sizeof...(Ts));
+		std::apply([&rval](Ts &... value) { (rval.push_back(traits<std::decay_t<Ts>>::encode(std::move(value))), ...); }, values);
+	}
+};
+
+template<typename F> struct signature {
+	static_assert(dependent_false<F>::value, "register_typed() takes a pointer to a free function");
+};
+
+template<typename R, typename... Args> struct signature<R (*)(Args...)> {
+	static std::vector<ipc::type> parameters() { return {traits<std::decay_t<Args>>::type...}; }
+
+	// Argument count and types were checked before the handler is called,
+	// see ipc::function::set_strict().
+	template<R (*Fn)(Args...), size_t... I>
+	static void call(const std::vector<ipc::value_view> &args, std::vector<ipc::value> &rval, std::index_sequence<I...>)
+	{
+		if constexpr (std::is_void_v<R>) {
+			Fn(traits<std::decay_t<Args>>::decode(args[I])...);
+		} else {
+			results<R>::encode(Fn(traits<std::decay_t<Args>>::decode(args[I])...), rval);
+		}
+	}
+
+	template<R (*Fn)(Args...)> static void invoke(void *data, const int64_t id, const std::vector<ipc::value_view> &args, std::vector<ipc::value> &rval)
+	{
+		call<Fn>(args, rval, std::index_sequence_for<Args...>{});
+	}
+};
+
+template<typename R, typename... Args> struct signature<R (*)(Args...) noexcept> : signature<R (*)(Args...)> {};
+} // namespace typed
+} // namespace ipc
@@ -18,7 +18,9 @@
 
 #pragma once
 #include <inttypes.h>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 
 typedef float float_t;
@@ -37,8 +39,109 @@ enum class type : uint32_t {
 	Binary,
 };
 
+/** Contents of a string or binary ipc::value.
+ *
+ * Up to 15 bytes are kept inline, longer contents live on the heap. A zero
+ * byte always follows the contents, so strings can be used as C strings. It
+ * offers the parts of the std::string and std::vector<char> interfaces that
+ * values are commonly used with, and converts to either.
+ */
+class value_storage {
+	static constexpr size_t inline_size = 16;
+
+	uint32_t m_size = 0;
+	// The contents while they fit, otherwise a pointer to them.
+	char m_bytes[inline_size] = {};
+
+	bool is_inline() const { return m_size < inline_size; }
+	char *heap() const
+	{
+		char *ptr;
+		memcpy(&ptr, m_bytes, sizeof(ptr));
+		return ptr;
+	}
+	void release()
+	{
+		if (!is_inline()) {
+			delete[] heap();
+		}
+	}
+
+public:
+	value_storage() {}
+	value_storage(const char *data, size_t size) { assign(data, size); }
+	explicit value_storage(const std::string &str) : value_storage(str.data(), str.size()) {}
+	explicit value_storage(const std::vector<char> &bin) : value_storage(bin.data(), bin.size()) {}
+	value_storage(const value_storage &other) : value_storage(other.data(), other.size()) {}
+	value_storage(value_storage &&other) noexcept : m_size(other.m_size)
+	{
+		memcpy(m_bytes, other.m_bytes, inline_size);
+		other.m_size = 0;
+		other.m_bytes[0] = 0;
+	}
+	~value_storage() { release(); }
+
+	value_storage &operator=(const value_storage &other)
+	{
+		if (this != &other) {
+			assign(other.data(), other.size());
+		}
+		return *this;
+	}
+	value_storage &operator=(value_storage &&other) noexcept
+	{
+		if (this != &other) {
+			release();
+			m_size = other.m_size;
+			memcpy(m_bytes, other.m_bytes, inline_size);
+			other.m_size = 0;
+			other.m_bytes[0] = 0;
+		}
+		return *this;
+	}
+	value_storage &operator=(const char *str) { return assign(str, strlen(str)); }
+	value_storage &operator=(std::string_view str) { return assign(str.data(), str.size()); }
+	value_storage &operator=(const std::string &str) { return assign(str.data(), str.size()); }
+	value_storage &operator=(const std::vector<char> &bin) { return assign(bin.data(), bin.size()); }
+
+	value_storage &assign(const char *data, size_t size);
+	value_storage &assign(const char *first, const char *last) { return assign(first, size_t(last - first)); }
+	void clear() { assign(m_bytes, size_t(0)); }
+
+	size_t size() const { return m_size; }
+	size_t length() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	const char *data() const { return is_inline() ? m_bytes : heap(); }
+	char *data() { return is_inline() ? m_bytes : heap(); }
+	const char *c_str() const { return data(); }
+	const char *begin() const { return data(); }
+	const char *end() const { return data() + m_size; }
+	char *begin() { return data(); }
+	char *end() { return data() + m_size; }
+	const char &operator[](size_t idx) const { return data()[idx]; }
+	char &operator[](size_t idx) { return data()[idx]; }
+
+	std::string_view view() const { return std::string_view(data(), m_size); }
+	operator std::string() const { return std::string(data(), m_size); }
+	operator std::vector<char>() const { return std::vector<char>(begin(), end()); }
+
+	friend bool operator==(const value_storage &a, std::string_view b) { return a.view() == b; }
+	friend bool operator==(std::string_view a, const value_storage &b) { return a == b.view(); }
+	friend bool operator!=(const value_storage &a, std::string_view b) { return a.view() != b; }
+	friend bool operator!=(std::string_view a, const value_storage &b) { return a != b.view(); }
+	friend bool operator==(const value_storage &a, const std::vector<char> &b) { return a.view() == std::string_view(b.data(), b.size()); }
+	friend bool operator!=(const value_storage &a, const std::vector<char> &b) { return !(a == b); }
+};
+
+/** A single argument or return value.
+ *
+ * Strings and binaries share their storage, value_str holds it and
+ * value_bin() gives it out under its binary name. Null values may carry a
+ * string as well, replies use that for error messages.
+ */
 struct value {
-	type type;
+	ipc::type type;
+	ipc::value_storage value_str;
 	union {
 		float fp32;
 		double fp64;
@@ -47,8 +150,6 @@ struct value {
 		uint32_t ui32;
 		uint64_t ui64;
 	} value_union;
-	std::string value_str;
-	std::vector<char> value_bin;
 
 	value();
 	value(float);
@@ -60,8 +161,78 @@ struct value {
 	value(const std::string &p_value);
 	value(const std::vector<char> &p_value);
 
+	value(const value &other) : type(other.type), value_str(other.value_str), value_union(other.value_union) {}
+	value(value &&other) noexcept : type(other.type), value_str(std::move(other.value_str)), value_union(other.value_union) {}
+	value &operator=(const value &other)
+	{
+		type = other.type;
+		value_str = other.value_str;
+		value_union = other.value_union;
+		return *this;
+	}
+	value &operator=(value &&other) noexcept
+	{
+		type = other.type;
+		value_str = std::move(other.value_str);
+		value_union = other.value_union;
+		return *this;
+	}
+
+	ipc::value_storage &value_bin() { return value_str; }
+	const ipc::value_storage &value_bin() const { return value_str; }
+
 	size_t size();
 	size_t serialize(std::vector<char> &buf, size_t offset);
 	size_t deserialize(const std::vector<char> &buf, size_t offset);
+
+	// v2 wire format: 1 byte type tag, varint integers and lengths.
+	size_t size_v2();
+	size_t serialize_v2(std::vector<char> &buf, size_t offset);
+};
+
+// Minimal std::span replacement until the project moves to C++20.
+template<typename T>
+class span {
+	T *m_data = nullptr;
+	size_t m_size = 0;
+
+public:
+	span() {}
+	span(T *data, size_t size) : m_data(data), m_size(size) {}
+
+	T *data() const { return m_data; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	T *begin() const { return m_data; }
+	T *end() const { return m_data + m_size; }
+	T &operator[](size_t idx) const { return m_data[idx]; }
+};
+
+/** Non-owning counterpart of ipc::value.
+ *
+ * Strings and binaries point straight into the buffer the view was parsed
+ * from (or into the value it was made from), so a view is only valid as long
+ * as that buffer is.
+ */
+struct value_view {
+	ipc::type type;
+	union {
+		float fp32;
+		double fp64;
+		int32_t i32;
+		int64_t i64;
+		uint32_t ui32;
+		uint64_t ui64;
+	} value_union;
+	std::string_view value_str;
+	ipc::span<const char> value_bin;
+
+	value_view();
+	value_view(const ipc::value &p_value);
+
+	ipc::value to_value() const;
+
+	size_t deserialize(const std::vector<char> &buf, size_t offset);
+	size_t deserialize_v2(const std::vector<char> &buf, size_t offset);
 };
 }
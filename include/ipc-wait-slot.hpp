@@ -0,0 +1,63 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+#ifdef __APPLE__
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace ipc {
+/** Per thread wakeup used by synchronous calls.
+ *
+ * Works like a binary semaphore on a single atomic word: signal() sets it
+ * and wait() takes it back. The waiter spins for a short while first, as
+ * replies often arrive within microseconds, and only then parks on the word
+ * (futex on Linux, WaitOnAddress on Windows). Nothing is created per call.
+ *
+ * A signal meant for an earlier call that gave up can still arrive, so
+ * callers keep their own completion flag and wait again until it is set.
+ */
+class wait_slot {
+public:
+	// The slot of the calling thread.
+	static wait_slot &local();
+
+	void signal();
+
+	// False if |timeout| passed without a signal.
+	bool wait(std::chrono::nanoseconds timeout);
+
+private:
+	static const uint32_t idle = 0;
+	static const uint32_t signalled = 1;
+	static const uint32_t parked = 2;
+
+	std::atomic<uint32_t> m_word{idle};
+#ifdef __APPLE__
+	// No public futex, park on a condition variable instead.
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+#endif
+
+	bool park(std::chrono::nanoseconds timeout);
+	void wake();
+};
+}
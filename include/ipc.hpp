@@ -17,7 +17,10 @@
 ******************************************************************************/
 
 #pragma once
+#include "ipc-priority.hpp"
 #include "ipc-value.hpp"
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -37,6 +40,26 @@
 #define DWORD unsigned long
 #endif
 
+// Collection every server provides. Its Resolve(String collection, String
+// function) returns the UInt32 id of a function, which calls may then send as
+// their class name, with a Null function name. Cacheable functions get the
+// server's UInt64 cache generation as a second value.
+#define IPC_BUILTIN_COLLECTION "$ipc"
+#define IPC_RESOLVE_FUNCTION "Resolve"
+
+// Topic of the invalidation notices of a cacheable function, followed by its
+// id. The event holds the UInt64 cache generation after the invalidation.
+#define IPC_INVALIDATE_TOPIC "$ipc/invalidate/"
+
+// Subscribe(String topic) and Unsubscribe(String topic) are answered by the
+// connection itself. Once subscribed, the client gets event frames for the
+// topic, see ipc::frame_event.
+#define IPC_SUBSCRIBE_FUNCTION "Subscribe"
+#define IPC_UNSUBSCRIBE_FUNCTION "Unsubscribe"
+
+// Error of calls the server dropped because their deadline passed.
+#define IPC_DEADLINE_EXCEEDED "Call deadline exceeded."
+
 namespace ipc {
 typedef uint64_t ipc_size_t;
 typedef uint32_t ipc_size_real_t;
@@ -61,6 +84,19 @@ public:
 	static std::string getDescription(DWORD key);
 };
 
+// Deadlines travel as microseconds of std::chrono::steady_clock, which both
+// processes of a local connection share. 0 stands for no deadline.
+inline uint64_t make_deadline(std::chrono::steady_clock::time_point deadline)
+{
+	int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(deadline.time_since_epoch()).count();
+	return (micros > 0) ? uint64_t(micros) : 1;
+}
+
+inline bool deadline_passed(uint64_t deadline)
+{
+	return (deadline != 0) && (make_deadline(std::chrono::steady_clock::now()) >= deadline);
+}
+
 inline void make_sendable(std::vector<char> &in)
 {
 	reinterpret_cast<ipc_size_real_t &>(in[sizeof(ipc_size_real_t)]) = ipc_size_real_t(in.size() - sizeof(ipc_size_t));
@@ -71,6 +107,84 @@ inline ipc_size_t read_size(std::vector<char> const &in)
 	return reinterpret_cast<const ipc_size_real_t &>(in[sizeof(ipc_size_real_t)]);
 }
 
+// Wire format versions. The first byte of the frame header tells which one
+// the message in the frame uses, v1 senders leave it zero. Only send v2 to
+// peers that agreed to it when connecting.
+const uint8_t wire_v1 = 1;
+const uint8_t wire_v2 = 2;
+
+inline void make_sendable(std::vector<char> &in, uint8_t version)
+{
+	in[0] = (version == wire_v2) ? char(wire_v2) : 0;
+	make_sendable(in);
+}
+
+inline uint8_t read_version(std::vector<char> const &in)
+{
+	return (uint8_t(in[0]) == wire_v2) ? wire_v2 : wire_v1;
+}
+
+// The second byte tells what the frame holds: a single call or reply, or a
+// batch of them. Batches are only sent to peers that agreed to them, events
+// only to clients that subscribed.
+const uint8_t frame_single = 0;
+const uint8_t frame_batch = 1;
+const uint8_t frame_event = 2;
+
+// Once its handlers ran, the client answers an event frame with a one byte
+// event frame of its own. The server sends the next one only after that, and
+// coalesces whatever is published meanwhile.
+const uint8_t event_ack = 1;
+
+// A stream frame carries a chunk of an ipc::stream_writer: the varint stream
+// id, a flags byte and the bytes of the chunk. A credit frame goes the other
+// way and holds the varint stream id and the varint number of bytes the
+// sender may send on top. Only sent to peers that agreed to streams.
+//
+// A credit of zero resets the stream, the receiver dropped it before the end.
+// The sender's writes fail and it answers with a last frame flagged
+// stream_end and stream_reset, unless it had ended the stream already. The
+// sender flags its last frame the same way when it abandons a stream.
+const uint8_t frame_stream = 3;
+const uint8_t frame_credit = 4;
+const uint8_t stream_end = 0x1;
+const uint8_t stream_reset = 0x2;
+
+// A cancel frame holds the varint uid of a call the client gave up on. The
+// server drops the call if it did not start yet and cancels its
+// ipc::cancellation_token otherwise, either way no reply is sent. Only sent to
+// servers that agreed to it.
+const uint8_t frame_cancel = 5;
+
+inline void make_sendable(std::vector<char> &in, uint8_t version, uint8_t kind)
+{
+	in[1] = char(kind);
+	make_sendable(in, version);
+}
+
+inline uint8_t read_kind(std::vector<char> const &in)
+{
+	return uint8_t(in[1]);
+}
+
+// The third byte of a call or batch frame holds the lane the client asks for
+// plus one, 0 leaves it to the priority of the function. Senders that know
+// nothing of lanes leave it zero, so it needs no agreement when connecting.
+inline void set_priority(std::vector<char> &in, priority lane)
+{
+	in[2] = char(uint8_t(lane) + 1);
+}
+
+inline bool read_priority(std::vector<char> const &in, priority &lane)
+{
+	uint8_t raw = uint8_t(in[2]);
+	if ((raw == 0) || (raw > priority_count)) {
+		return false;
+	}
+	lane = priority(raw - 1);
+	return true;
+}
+
 void log(const char *fmt, ...);
 void register_log_callback(ipc::log_callback_t callback, void *data);
 
@@ -82,25 +196,136 @@ public:
 };
 
 namespace message {
+struct gather;
+
 struct function_call {
-	ipc::value uid = ipc::value(0ull);
+	ipc::value uid = ipc::value((uint64_t)0);
 	ipc::value class_name = ipc::value("");
 	ipc::value function_name = ipc::value("");
 	std::vector<ipc::value> arguments;
+	// See ipc::make_deadline(), 0 for none. Follows the arguments when set,
+	// as a plain uint64 in v1 and a varint in v2. Only sent on single calls
+	// to servers that agreed to deadlines.
+	uint64_t deadline = 0;
 
 	size_t size();
 	size_t serialize(std::vector<char> &buf, size_t offset);
 	size_t deserialize(std::vector<char> &buf, size_t offset);
+
+	// v2 drops the inner length and sends the uid as a plain varint.
+	size_t size_v2();
+	size_t serialize_v2(std::vector<char> &buf, size_t offset);
+
+	// Lays the frame out for a gathered write, see ipc::message::gather.
+	void serialize(gather &out, uint8_t version);
+};
+
+/** function_call parsed in place.
+ *
+ * Every string and binary refers to the receive buffer, which has to outlive
+ * the view. Lets handlers taking ipc::value_view arguments run without
+ * copying their arguments out of the message.
+ */
+struct function_call_view {
+	ipc::value_view uid;
+	ipc::value_view class_name;
+	ipc::value_view function_name;
+	std::vector<ipc::value_view> arguments;
+	uint64_t deadline = 0;
+
+	size_t deserialize(const std::vector<char> &buf, size_t offset);
+	// v2 calls have no inner length, |length| is where the call ends if it
+	// does not run to the end of the buffer.
+	size_t deserialize_v2(const std::vector<char> &buf, size_t offset, size_t length = SIZE_MAX);
 };
 
 struct function_reply {
-	ipc::value uid = ipc::value(0ull);
+	ipc::value uid = ipc::value((uint64_t)0);
 	std::vector<ipc::value> values;
 	ipc::value error = ipc::value("");
 
 	size_t size();
 	size_t serialize(std::vector<char> &buf, size_t offset);
 	size_t deserialize(std::vector<char> &buf, size_t offset);
+
+	size_t size_v2();
+	size_t serialize_v2(std::vector<char> &buf, size_t offset);
+	size_t deserialize_v2(std::vector<char> &buf, size_t offset);
+
+	void serialize(gather &out, uint8_t version);
+};
+
+/** A frame laid out for a gathered write.
+ *
+ * The frame header and all small fields are written to `head`, which comes
+ * from ipc::buffer_pool. Strings and binaries of at least reference_size bytes
+ * are not copied, `references` points at their storage instead, so the
+ * message has to outlive the write. parts() lists the pieces in wire order.
+ */
+struct gather {
+	static constexpr size_t reference_size = 1024;
+
+	std::vector<char> head;
+	// Referenced storage, each sent right after the head bytes before its offset.
+	std::vector<std::pair<size_t, ipc::span<const char>>> references;
+
+	// Storage of the value if it is referenced rather than copied.
+	static ipc::span<const char> reference(const ipc::value &value);
+
+	// Writes the value at offset in head, or only its prefix if it is
+	// referenced, and returns the number of bytes written.
+	size_t append(ipc::value &value, size_t offset, uint8_t version);
+
+	size_t size() const;
+	std::vector<ipc::span<const char>> parts() const;
+	void make_sendable(uint8_t version, uint8_t kind = ipc::frame_single);
+};
+
+/** Content of a batch frame: the batch uid, the number of entries and every
+ * entry prefixed with its length. The entries use the wire format of the
+ * frame, and replies come back in the order of the calls.
+ */
+struct function_call_batch {
+	uint64_t uid = 0;
+	std::vector<function_call> calls;
+
+	size_t size(uint8_t version);
+	size_t serialize(std::vector<char> &buf, size_t offset, uint8_t version);
+};
+
+struct function_call_batch_view {
+	uint64_t uid = 0;
+	std::vector<function_call_view> calls;
+
+	size_t deserialize(const std::vector<char> &buf, size_t offset, uint8_t version);
+};
+
+struct function_reply_batch {
+	uint64_t uid = 0;
+	std::vector<function_reply> replies;
+
+	size_t size(uint8_t version);
+	size_t serialize(std::vector<char> &buf, size_t offset, uint8_t version);
+	size_t deserialize(std::vector<char> &buf, size_t offset, uint8_t version);
+};
+
+/** Values the server pushed for a topic. */
+struct event {
+	ipc::value topic = ipc::value("");
+	std::vector<ipc::value> values;
+
+	size_t size(uint8_t version);
+	size_t serialize(std::vector<char> &buf, size_t offset, uint8_t version);
+	size_t deserialize(std::vector<char> &buf, size_t offset, uint8_t version);
+};
+
+/** Content of an event frame: the number of events, then the events. */
+struct event_batch {
+	std::vector<event> events;
+
+	size_t size(uint8_t version);
+	size_t serialize(std::vector<char> &buf, size_t offset, uint8_t version);
+	size_t deserialize(std::vector<char> &buf, size_t offset, uint8_t version);
 };
 }
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "ipc-client-osx.hpp"
+#include "../include/ipc-wait-slot.hpp"
+#include "../include/ipc-buffer-pool.hpp"
 
 call_return_t g_fn = NULL;
 void *g_data = NULL;
@@ -66,10 +68,10 @@ bool ipc::client_osx::call(const std::string &cname, const std::string &fname, s
 	fnc_call_msg.function_name = ipc::value(fname);
 	fnc_call_msg.arguments = std::move(args);
 
-	// Serialize
-	std::vector<char> buf(fnc_call_msg.size() + sizeof(ipc_size_t));
+	// Serialize, large arguments are written straight from the message.
+	ipc::message::gather buf;
 	try {
-		fnc_call_msg.serialize(buf, sizeof(ipc_size_t));
+		fnc_call_msg.serialize(buf, ipc::wire_v1);
 	} catch (std::exception &e) {
 		ipc::log("(write) %8llu: Failed to serialize, error %s.", fnc_call_msg.uid.value_union.ui64, e.what());
 		throw e;
@@ -81,21 +83,22 @@ bool ipc::client_osx::call(const std::string &cname, const std::string &fname, s
 		cbid = fnc_call_msg.uid.value_union.ui64;
 	}
 
-	ipc::make_sendable(buf);
+	buf.make_sendable(ipc::wire_v1);
 
 	sem_wait(m_writer_sem);
 	while (ec == os::error::Error) {
-		ec = (os::error)m_socket->write(buf.data(), buf.size(), REQUEST);
+		ec = (os::error)m_socket->write(buf.parts(), REQUEST);
 		if (ec == os::error::Error)
 			std::this_thread::sleep_for(std::chrono::milliseconds(2));
 	}
+	ipc::buffer_pool::release(std::move(buf.head));
 
 	// Reply from "Shutdown" is unreliable
 	if (m_shutting_down)
 		return true;
 
 	buffer.resize(sizeof(ipc_size_t));
-	ec = (os::error)m_socket->read(buffer.data(), buffer.size(), true, REPLY);
+	ec = (os::error)m_socket->read(buffer.data(), buffer.size(), REPLY);
 	read_callback_init(ec, buffer.size());
 	return true;
 }
@@ -103,8 +106,8 @@ bool ipc::client_osx::call(const std::string &cname, const std::string &fname, s
 std::vector<ipc::value> ipc::client_osx::call_synchronous_helper(const std::string &cname, const std::string &fname, const std::vector<ipc::value> &args)
 {
 	struct CallData {
-		sem_t *sem;
-		bool called = false;
+		ipc::wait_slot *slot = &ipc::wait_slot::local();
+		std::atomic_bool called = false;
 		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
 		std::vector<ipc::value> values;
@@ -114,34 +117,25 @@ std::vector<ipc::value> ipc::client_osx::call_synchronous_helper(const std::stri
 		CallData &cd = *static_cast<CallData *>(data);
 		cd.values.reserve(rval.size());
 		std::copy(rval.begin(), rval.end(), std::back_inserter(cd.values));
+		ipc::wait_slot *slot = cd.slot;
 		cd.called = true;
-		sem_post(cd.sem);
+		slot->signal();
 	};
 
-	int uniqueId = cname.size() + fname.size() + rand();
-	std::string sem_name = "sem-cb" + std::to_string(uniqueId);
-	std::string path = "/tmp/" + sem_name;
-	sem_unlink(path.c_str());
-	remove(path.c_str());
-	cd.sem = sem_open(path.c_str(), O_CREAT | O_EXCL, 0644, 0);
-	if (cd.sem == SEM_FAILED) {
-		return {};
-	}
-
 	int64_t cbid = 0;
 	bool success = call(cname, fname, std::move(args), cb, &cd, cbid);
 	if (!success) {
 		return {};
 	}
-	sem_wait(cd.sem);
-	sem_close(cd.sem);
-	sem_unlink(path.c_str());
-	remove(path.c_str());
+	while (!cd.called) {
+		cd.slot->wait(std::chrono::seconds(1));
+	}
 
 	if (!cd.called) {
 		cancel(cbid);
 		return {};
 	}
+	m_metrics.get(cname + "::" + fname).record(std::chrono::high_resolution_clock::now() - cd.start);
 	sem_post(m_writer_sem);
 	return std::move(cd.values);
 }
@@ -154,7 +148,7 @@ void ipc::client_osx::read_callback_init(os::error ec, size_t size)
 		ipc_size_t n_size = read_size(buffer);
 		if (n_size != 0) {
 			buffer.resize(n_size);
-			ec2 = (os::error)m_socket->read(buffer.data(), buffer.size(), false, REPLY);
+			ec2 = (os::error)m_socket->read(buffer.data(), buffer.size(), REPLY);
 			read_callback_msg(ec, buffer.size());
 		}
 	}
@@ -1,4 +1,5 @@
 #include "ipc-server-instance-osx.hpp"
+#include "../include/ipc-buffer-pool.hpp"
 
 std::shared_ptr<ipc::server_instance> ipc::server_instance::create(server *owner, std::shared_ptr<ipc::socket> socket, int call_timeout)
 {
@@ -63,7 +64,7 @@ void ipc::server_instance_osx::worker_req()
 	while ((!m_stopWorkers) && m_socket->is_connected()) {
 		sem_wait(m_reader_sem);
 		m_rbuf.resize(sizeof(ipc_size_t));
-		os::error ec = (os::error)m_socket->read(m_rbuf.data(), m_rbuf.size(), true, REQUEST);
+		os::error ec = (os::error)m_socket->read(m_rbuf.data(), m_rbuf.size(), REQUEST);
 		read_callback_init(ec, m_rbuf.size());
 	}
 }
@@ -82,7 +83,6 @@ void ipc::server_instance_osx::worker_rep()
 		ipc::message::function_call fnc_call_msg;
 		ipc::message::function_reply fnc_reply_msg;
 		bool success = false;
-		std::vector<char> write_buffer;
 
 		msg_mtx.lock();
 		fnc_call_msg = msgs.front();
@@ -100,15 +100,17 @@ void ipc::server_instance_osx::worker_rep()
 			fnc_reply_msg.error = ipc::value(proc_error);
 		}
 
-		// Serialize
-		write_buffer.resize(fnc_reply_msg.size() + sizeof(ipc_size_t));
+		// Serialize, large values are written straight from the reply.
+		ipc::message::gather frame;
 		try {
-			fnc_reply_msg.serialize(write_buffer, sizeof(ipc_size_t));
+			fnc_reply_msg.serialize(frame, ipc::wire_v1);
 		} catch (std::exception &e) {
 			ipc::log("%8llu: Serialization of Function Reply message failed with error %s.", fnc_reply_msg.uid.value_union.ui64, e.what());
 			return;
 		}
-		read_callback_msg_write(write_buffer);
+		frame.make_sendable(ipc::wire_v1);
+		m_socket->write(frame.parts(), REPLY);
+		ipc::buffer_pool::release(std::move(frame.head));
 		sem_post(m_reader_sem);
 	}
 }
@@ -121,7 +123,7 @@ void ipc::server_instance_osx::read_callback_init(os::error ec, size_t size)
 		ipc_size_t n_size = read_size(m_rbuf);
 		if (n_size > 1) {
 			m_rbuf.resize(n_size);
-			ec2 = (os::error)m_socket->read(m_rbuf.data(), m_rbuf.size(), false, REQUEST);
+			ec2 = (os::error)m_socket->read(m_rbuf.data(), m_rbuf.size(), REQUEST);
 			read_callback_msg(ec, m_rbuf.size());
 		} else {
 			sem_post(m_writer_sem);
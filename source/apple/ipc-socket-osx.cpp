@@ -1,6 +1,10 @@
 #include "ipc-socket-osx.hpp"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <algorithm>
+#include <vector>
 
 std::unique_ptr<os::apple::socket_osx> os::apple::socket_osx::create(os::create_only_t, const std::string &name)
 {
@@ -25,9 +29,6 @@ os::apple::socket_osx::socket_osx(os::create_only_t, const std::string name)
 	if (mkfifo(name_rep.c_str(), S_IRUSR | S_IWUSR) < 0)
 		throw std::exception((const std::exception &)"Could not create reply pipe");
 
-	fd_write = -1;
-	fd_read_b = -1;
-	fd_read_nb = -1;
 	created = true;
 }
 
@@ -36,125 +37,153 @@ os::apple::socket_osx::socket_osx(os::open_only_t, const std::string name)
 	this->name_req = name + "-req";
 	this->name_rep = name + "-rep";
 
-	fd_write = -1;
-	fd_read_b = -1;
-	fd_read_nb = -1;
 	connected = true;
 }
 
-os::apple::socket_osx::~socket_osx() {}
+os::apple::socket_osx::~socket_osx()
+{
+	for (pipe_end *end : {&fd_req, &fd_rep}) {
+		if (end->fd >= 0)
+			close(end->fd);
+		if (end->closing >= 0)
+			close(end->closing);
+	}
+}
 
 void os::apple::socket_osx::clean_file_descriptors()
 {
-	if (fd_write > 0)
-		close(fd_write);
-
-	if (fd_read_b > 0)
-		close(fd_read_b);
-
-	if (fd_read_nb > 0)
-		close(fd_read_nb);
+	std::unique_lock<std::mutex> ulock(fd_lock);
+	for (pipe_end *end : {&fd_req, &fd_rep}) {
+		if (end->fd < 0)
+			continue;
+		if (end->users == 0) {
+			close(end->fd);
+		} else {
+			// The last read or write using it closes it.
+			end->closing = end->fd;
+			end->closing_users = end->users;
+			end->users = 0;
+		}
+		end->fd = -1;
+	}
 
 	remove(name_req.c_str());
 	remove(name_rep.c_str());
 }
 
-uint32_t os::apple::socket_osx::read(char *buffer, size_t buffer_length, bool is_blocking, SocketType t)
+int os::apple::socket_osx::acquire_descriptor(SocketType t)
 {
-	os::error err = os::error::Error;
-	int ret = 0;
-	int sizeChunks = 8 * 1024; // 8KB
-	int offset = 0;
-	int file_descriptor = -1;
-	std::string typePipe = t == REQUEST ? "server" : "client";
+	// The client may get here before the server has created the pipes, the
+	// open is then retried on the next call.
+	std::unique_lock<std::mutex> ulock(fd_lock);
+	pipe_end &end = t == REQUEST ? fd_req : fd_rep;
+	if (end.fd < 0)
+		end.fd = open(t == REQUEST ? name_req.c_str() : name_rep.c_str(), O_RDWR | O_CLOEXEC);
+	if (end.fd >= 0)
+		end.users++;
+	return end.fd;
+}
 
-	if (is_blocking) {
-		fd_read_b = open(t == REQUEST ? name_req.c_str() : name_rep.c_str(), O_RDWR);
-		if (fd_read_b < 0) {
-			goto end;
-		}
-	} else {
-		fd_read_nb = open(t == REQUEST ? name_req.c_str() : name_rep.c_str(), O_RDWR | O_NONBLOCK);
-		if (fd_read_nb < 0) {
-			goto end;
+void os::apple::socket_osx::release_descriptor(SocketType t, int file_descriptor)
+{
+	std::unique_lock<std::mutex> ulock(fd_lock);
+	pipe_end &end = t == REQUEST ? fd_req : fd_rep;
+	if (file_descriptor == end.closing) {
+		if (--end.closing_users == 0) {
+			close(end.closing);
+			end.closing = -1;
 		}
+	} else if (file_descriptor == end.fd) {
+		end.users--;
 	}
+}
 
-	file_descriptor = is_blocking ? fd_read_b : fd_read_nb;
-
-	while (ret <= 0) {
-		ret = ::read(file_descriptor, buffer, buffer_length);
-		if (ret > 0)
-			offset += ret;
-
-		while (ret != 0 && (ret == (sizeChunks - 8) || ret == sizeChunks || ret < 0)) {
-			std::vector<char> new_chunks;
-			new_chunks.resize(sizeChunks);
-			ret = ::read(file_descriptor, new_chunks.data(), new_chunks.size());
-
-			if (ret > 0) {
-				::memcpy(buffer + offset, new_chunks.data(), ret);
-				offset += ret;
-			}
-		}
-	}
-	if (ret < 0) {
-		goto end;
+// Drops the first `done` bytes from the parts, skipping the ones that are
+// complete.
+static void advance(std::vector<struct iovec> &parts, size_t &first, size_t done)
+{
+	while (first < parts.size() && done >= parts[first].iov_len) {
+		done -= parts[first].iov_len;
+		first++;
 	}
-	err = os::error::Success;
-
-	if (!is_blocking) {
-		if (fd_read_b > 0)
-			close(fd_read_b);
-		if (fd_read_nb > 0)
-			close(fd_read_nb);
+	if (first < parts.size()) {
+		parts[first].iov_base = static_cast<char *>(parts[first].iov_base) + done;
+		parts[first].iov_len -= done;
 	}
-
-end:
-	return (uint32_t)err;
 }
 
-uint32_t os::apple::socket_osx::write(const char *buffer, size_t buffer_length, SocketType t)
+uint32_t os::apple::socket_osx::read(const struct iovec *parts, int count, SocketType t)
 {
-	os::error err = os::error::Error;
-	int ret = 0;
-	int sizeChunks = 8 * 1024; // 8KB
-	std::string typePipe = t == REQUEST ? "client" : "server";
-
-	if (fd_write > 0)
-		close(fd_write);
-
-	fd_write = open(t == REQUEST ? name_req.c_str() : name_rep.c_str(), O_WRONLY | O_DSYNC);
-	if (fd_write < 0) {
-		goto end;
+	int file_descriptor = acquire_descriptor(t);
+	if (file_descriptor < 0)
+		return (uint32_t)os::error::Error;
+
+	std::vector<struct iovec> pending(parts, parts + count);
+	size_t first = 0;
+	advance(pending, first, 0);
+	os::error ec = os::error::Success;
+	while (first < pending.size()) {
+		ssize_t ret = ::readv(file_descriptor, pending.data() + first, (int)std::min<size_t>(pending.size() - first, IOV_MAX));
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			ec = os::error::Error;
+			break;
+		}
+		advance(pending, first, (size_t)ret);
 	}
+	release_descriptor(t, file_descriptor);
+	return (uint32_t)ec;
+}
 
-	if (buffer_length <= sizeChunks) {
-		ret = ::write(fd_write, buffer, buffer_length);
-	} else {
-		int size_wrote = 0;
-		while (size_wrote < buffer_length) {
-			if (fd_write < 0)
-				fd_write = open(t == REQUEST ? name_req.c_str() : name_rep.c_str(), O_WRONLY | O_DSYNC);
-
-			bool end = (buffer_length - size_wrote) <= sizeChunks;
-			int size_to_write = end ? buffer_length - size_wrote : sizeChunks;
-			ret = ::write(fd_write, buffer + size_wrote, size_to_write);
-			if (ret < 0)
+uint32_t os::apple::socket_osx::write(const struct iovec *parts, int count, SocketType t)
+{
+	int file_descriptor = acquire_descriptor(t);
+	if (file_descriptor < 0)
+		return (uint32_t)os::error::Error;
+
+	std::vector<struct iovec> pending(parts, parts + count);
+	size_t first = 0;
+	advance(pending, first, 0);
+
+	os::error ec = os::error::Success;
+	{
+		std::unique_lock<std::mutex> ulock(write_lock);
+		while (first < pending.size()) {
+			ssize_t ret = ::writev(file_descriptor, pending.data() + first, (int)std::min<size_t>(pending.size() - first, IOV_MAX));
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret < 0) {
+				ec = os::error::Error;
 				break;
-			size_wrote += size_to_write;
-			close(fd_write);
-			fd_write = -1;
+			}
+			advance(pending, first, (size_t)ret);
 		}
 	}
+	release_descriptor(t, file_descriptor);
+	return (uint32_t)ec;
+}
 
-	if (ret < 0) {
-		goto end;
-	}
-	err = os::error::Success;
+uint32_t os::apple::socket_osx::read(char *buffer, size_t buffer_length, SocketType t)
+{
+	struct iovec part = {buffer, buffer_length};
+	return read(&part, 1, t);
+}
 
-end:
-	return (uint32_t)err;
+uint32_t os::apple::socket_osx::write(const char *buffer, size_t buffer_length, SocketType t)
+{
+	struct iovec part = {const_cast<char *>(buffer), buffer_length};
+	return write(&part, 1, t);
+}
+
+uint32_t os::apple::socket_osx::write(const std::vector<ipc::span<const char>> &parts, SocketType t)
+{
+	std::vector<struct iovec> iov;
+	iov.reserve(parts.size());
+	for (const ipc::span<const char> &part : parts) {
+		iov.push_back({const_cast<char *>(part.data()), part.size()});
+	}
+	return write(iov.data(), (int)iov.size(), t);
 }
 
 bool os::apple::socket_osx::is_created()
@@ -1,12 +1,16 @@
 #ifndef IPC_SOCKET_IPC_H
 #define IPC_SOCKET_IPC_H
 
+#include "../include/ipc.hpp"
 #include "../include/ipc-socket.hpp"
 #include "async_request.hpp"
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <atomic>
+#include <mutex>
 #include <thread>
 
 enum SocketType : uint8_t { REQUEST, REPLY };
@@ -22,8 +26,13 @@ public:
 	socket_osx(os::open_only_t, const std::string name);
 	~socket_osx();
 
-	uint32_t read(char *buffer, size_t buffer_length, bool is_blocking, SocketType t);
+	// Reads wait until every byte asked for has arrived, writes until every
+	// byte has been handed to the pipe.
+	uint32_t read(char *buffer, size_t buffer_length, SocketType t);
 	uint32_t write(const char *buffer, size_t buffer_length, SocketType t);
+	uint32_t read(const struct iovec *parts, int count, SocketType t);
+	uint32_t write(const struct iovec *parts, int count, SocketType t);
+	uint32_t write(const std::vector<ipc::span<const char>> &parts, SocketType t);
 
 	virtual void handle_accept_callback(os::error code, size_t length) override;
 	virtual bool is_created() override;
@@ -38,11 +47,27 @@ private:
 	bool connected = true;
 	std::string name_req = "";
 	std::string name_rep = "";
-	int file_req;
-	int file_rep;
-	int fd_write;
-	int fd_read_b;
-	int fd_read_nb;
+
+	// Each pipe is opened once, for reading and writing, the first time it is
+	// used and stays open until clean_file_descriptors(). Holding both ends
+	// keeps open() from waiting for the peer and reads from seeing end of file.
+	// Reads and writes count themselves as users of the descriptor while they
+	// run, so that it is only closed once the last of them is done and its
+	// number can't be reused under them.
+	struct pipe_end {
+		int fd = -1;
+		size_t users = 0;
+		int closing = -1; // taken out by clean_file_descriptors(), still in use
+		size_t closing_users = 0;
+	};
+	std::mutex fd_lock;
+	pipe_end fd_req;
+	pipe_end fd_rep;
+	int acquire_descriptor(SocketType t);
+	void release_descriptor(SocketType t, int file_descriptor);
+
+	// Messages larger than PIPE_BUF are written in several pieces.
+	std::mutex write_lock;
 };
 }
 }
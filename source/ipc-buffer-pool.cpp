@@ -0,0 +1,222 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#include "ipc-buffer-pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#define MIN_CLASS_SHIFT 8
+#define MAX_CLASS_SHIFT 22
+#define CLASS_COUNT (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1)
+
+// About this many bytes are kept per class, within the count limits.
+#define THREAD_CACHE_BYTES (256 * 1024)
+#define THREAD_CACHE_COUNT 64
+#define GLOBAL_CACHE_BYTES (4 * 1024 * 1024)
+#define GLOBAL_CACHE_COUNT 256
+
+namespace {
+typedef std::vector<std::vector<char>> freelist;
+
+struct counters {
+	std::atomic<uint64_t> hits{0};
+	std::atomic<uint64_t> misses{0};
+	std::atomic<uint64_t> dropped{0};
+	std::atomic<int64_t> in_use{0};
+	std::atomic<int64_t> high_water{0};
+};
+
+struct global_pool {
+	std::mutex lock;
+	freelist lists[CLASS_COUNT];
+};
+
+size_t class_size(size_t cls)
+{
+	return size_t(1) << (cls + MIN_CLASS_SHIFT);
+}
+
+size_t thread_limit(size_t cls)
+{
+	return std::min<size_t>(THREAD_CACHE_COUNT, std::max<size_t>(2, THREAD_CACHE_BYTES / class_size(cls)));
+}
+
+size_t global_limit(size_t cls)
+{
+	return std::min<size_t>(GLOBAL_CACHE_COUNT, std::max<size_t>(4, GLOBAL_CACHE_BYTES / class_size(cls)));
+}
+
+// Smallest class that fits the size, CLASS_COUNT if there is none.
+size_t class_for_size(size_t size)
+{
+	size_t cls = 0;
+	while ((cls < CLASS_COUNT) && (class_size(cls) < size)) {
+		cls++;
+	}
+	return cls;
+}
+
+// Largest class the capacity can serve, CLASS_COUNT if there is none.
+size_t class_for_capacity(size_t capacity)
+{
+	if (capacity < class_size(0)) {
+		return CLASS_COUNT;
+	}
+	size_t cls = 0;
+	while ((cls + 1 < CLASS_COUNT) && (class_size(cls + 1) <= capacity)) {
+		cls++;
+	}
+	return cls;
+}
+
+counters &get_counters()
+{
+	static counters instance;
+	return instance;
+}
+
+// Never destroyed, threads may still return buffers during shutdown.
+global_pool &get_global()
+{
+	static global_pool *instance = new global_pool();
+	return *instance;
+}
+
+struct thread_cache {
+	freelist lists[CLASS_COUNT];
+
+	thread_cache()
+	{
+		for (size_t cls = 0; cls < CLASS_COUNT; cls++) {
+			lists[cls].reserve(thread_limit(cls));
+		}
+	}
+
+	~thread_cache()
+	{
+		global_pool &global = get_global();
+		std::unique_lock<std::mutex> ul(global.lock);
+		for (size_t cls = 0; cls < CLASS_COUNT; cls++) {
+			while (!lists[cls].empty() && (global.lists[cls].size() < global_limit(cls))) {
+				global.lists[cls].push_back(std::move(lists[cls].back()));
+				lists[cls].pop_back();
+			}
+		}
+	}
+
+	// Moves up to half a thread cache worth of buffers from the global pool.
+	void refill(size_t cls)
+	{
+		global_pool &global = get_global();
+		std::unique_lock<std::mutex> ul(global.lock);
+		freelist &from = global.lists[cls];
+		size_t count = std::min(from.size(), std::max<size_t>(1, thread_limit(cls) / 2));
+		for (size_t idx = 0; idx < count; idx++) {
+			lists[cls].push_back(std::move(from.back()));
+			from.pop_back();
+		}
+	}
+
+	// Hands half of the buffers to the global pool, returns false if the
+	// global pool had no room for any of them.
+	bool spill(size_t cls)
+	{
+		global_pool &global = get_global();
+		std::unique_lock<std::mutex> ul(global.lock);
+		freelist &to = global.lists[cls];
+		size_t count = std::max<size_t>(1, lists[cls].size() / 2);
+		bool moved = false;
+		for (size_t idx = 0; (idx < count) && (to.size() < global_limit(cls)); idx++) {
+			to.push_back(std::move(lists[cls].back()));
+			lists[cls].pop_back();
+			moved = true;
+		}
+		return moved;
+	}
+};
+
+thread_cache &get_thread_cache()
+{
+	static thread_local thread_cache instance;
+	return instance;
+}
+}
+
+std::vector<char> ipc::buffer_pool::acquire(size_t size)
+{
+	counters &cnt = get_counters();
+	int64_t in_use = cnt.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+	int64_t high_water = cnt.high_water.load(std::memory_order_relaxed);
+	while ((in_use > high_water) && !cnt.high_water.compare_exchange_weak(high_water, in_use, std::memory_order_relaxed)) {
+	}
+
+	std::vector<char> buffer;
+	size_t cls = class_for_size(size);
+	if (cls < CLASS_COUNT) {
+		thread_cache &cache = get_thread_cache();
+		if (cache.lists[cls].empty()) {
+			cache.refill(cls);
+		}
+		if (!cache.lists[cls].empty()) {
+			buffer = std::move(cache.lists[cls].back());
+			cache.lists[cls].pop_back();
+			cnt.hits.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			buffer.reserve(class_size(cls));
+			cnt.misses.fetch_add(1, std::memory_order_relaxed);
+		}
+	} else {
+		cnt.misses.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	buffer.resize(size);
+	return buffer;
+}
+
+void ipc::buffer_pool::release(std::vector<char> &&buffer)
+{
+	counters &cnt = get_counters();
+	cnt.in_use.fetch_sub(1, std::memory_order_relaxed);
+
+	std::vector<char> local = std::move(buffer);
+	size_t cls = class_for_capacity(local.capacity());
+	if ((cls >= CLASS_COUNT) || (local.capacity() > class_size(CLASS_COUNT - 1))) {
+		cnt.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	thread_cache &cache = get_thread_cache();
+	if ((cache.lists[cls].size() >= thread_limit(cls)) && !cache.spill(cls)) {
+		cnt.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	local.clear();
+	cache.lists[cls].push_back(std::move(local));
+}
+
+ipc::buffer_pool::statistics ipc::buffer_pool::get_statistics()
+{
+	counters &cnt = get_counters();
+	statistics stats;
+	stats.hits = cnt.hits.load(std::memory_order_relaxed);
+	stats.misses = cnt.misses.load(std::memory_order_relaxed);
+	stats.dropped = cnt.dropped.load(std::memory_order_relaxed);
+	stats.in_use = uint64_t(std::max<int64_t>(0, cnt.in_use.load(std::memory_order_relaxed)));
+	stats.high_water = uint64_t(cnt.high_water.load(std::memory_order_relaxed));
+	return stats;
+}
@@ -0,0 +1,47 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ipc-cancellation.hpp"
+
+static thread_local const ipc::cancellation_token *current_token = nullptr;
+
+bool ipc::cancellation_token::is_cancelled() const
+{
+	return m_cancelled.load(std::memory_order_relaxed);
+}
+
+void ipc::cancellation_token::cancel()
+{
+	m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+const ipc::cancellation_token &ipc::cancellation_token::current()
+{
+	static const cancellation_token never;
+	return current_token ? *current_token : never;
+}
+
+ipc::cancellation_token::scope::scope(const cancellation_token *token) : m_previous(current_token)
+{
+	current_token = token;
+}
+
+ipc::cancellation_token::scope::~scope()
+{
+	current_token = m_previous;
+}
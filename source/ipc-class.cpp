@@ -38,11 +38,20 @@ bool ipc::collection::register_function(std::shared_ptr<ipc::function> func)
 	return true;
 }
 
+void ipc::collection::set_serial(bool serial)
+{
+	m_serial = serial;
+}
+
+bool ipc::collection::is_serial()
+{
+	return m_serial;
+}
+
 std::shared_ptr<ipc::function> ipc::collection::get_function(const std::string &name)
 {
-	for (auto fct : m_functions) {
-		if (fct.first.compare(name.c_str()) == 0)
-			return fct.second;
-	}
-	return nullptr;
+	auto fct = m_functions.find(name);
+	if (fct == m_functions.end())
+		return nullptr;
+	return fct->second;
 }
\ No newline at end of file
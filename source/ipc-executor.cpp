@@ -0,0 +1,249 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#include "ipc-executor.hpp"
+#include <algorithm>
+
+// Identifies the worker running on the current thread, if any.
+static thread_local ipc::executor *tl_executor = nullptr;
+static thread_local size_t tl_index = 0;
+
+ipc::executor::executor(size_t threads) : m_next(0), m_last_ticket(0), m_sleeping(0)
+{
+	if (threads == 0) {
+		threads = 1;
+	}
+
+	for (size_t lane = 0; lane < ipc::priority_count; lane++) {
+		m_queued[lane] = 0;
+		m_peak[lane] = 0;
+	}
+	for (size_t idx = 0; idx < threads; idx++) {
+		m_workers.push_back(std::make_unique<worker>());
+	}
+	for (size_t idx = 0; idx < threads; idx++) {
+		m_workers[idx]->thread = std::thread(std::bind(&ipc::executor::run, this, idx));
+	}
+}
+
+ipc::executor::~executor()
+{
+	{
+		std::unique_lock<std::mutex> ul(m_idle_lock);
+		m_stop = true;
+	}
+	m_idle_cv.notify_all();
+
+	// Workers finish the queued tasks before they exit.
+	for (auto &wrk : m_workers) {
+		if (wrk->thread.joinable()) {
+			wrk->thread.join();
+		}
+	}
+}
+
+// Share of the workers' time each lane gets while all of them have tasks.
+static const int64_t lane_weights[ipc::priority_count] = {16, 4, 1};
+
+ipc::executor::ticket_t ipc::executor::post(task_t task, ipc::priority lane)
+{
+	size_t index = (tl_executor == this) ? tl_index : (m_next++ % m_workers.size());
+	size_t idx = size_t(lane);
+
+	// Counted before it is queued, so that taking it never finds the count
+	// at zero.
+	size_t queued = ++m_queued[idx];
+	size_t peak = m_peak[idx].load(std::memory_order_relaxed);
+	while ((queued > peak) && !m_peak[idx].compare_exchange_weak(peak, queued, std::memory_order_relaxed)) {
+	}
+	ticket_t ticket = ++m_last_ticket;
+	{
+		std::unique_lock<std::mutex> ul(m_workers[index]->lock);
+		m_workers[index]->tasks[idx].push_back({ticket, std::move(task), std::chrono::steady_clock::now()});
+	}
+
+	if (m_sleeping.load() > 0) {
+		std::unique_lock<std::mutex> ul(m_idle_lock);
+		m_idle_cv.notify_one();
+	}
+	return ticket;
+}
+
+ipc::executor::ticket_t ipc::executor::post(const std::shared_ptr<strand> &serial, task_t task, ipc::priority lane)
+{
+	ticket_t ticket = ++m_last_ticket;
+	{
+		std::unique_lock<std::mutex> ul(serial->lock);
+		serial->tasks.push_back({ticket, std::move(task), std::chrono::steady_clock::now()});
+		if (serial->running) {
+			return ticket;
+		}
+		serial->running = true;
+	}
+	post(std::bind(&ipc::executor::run_strand, this, serial), lane);
+	return ticket;
+}
+
+bool ipc::executor::cancel(ticket_t ticket)
+{
+	// Outlives the locks, the task is destroyed once they are released.
+	queued_task dropped;
+	for (auto &wrk : m_workers) {
+		std::unique_lock<std::mutex> ul(wrk->lock);
+		for (size_t lane = 0; lane < ipc::priority_count; lane++) {
+			std::deque<queued_task> &tasks = wrk->tasks[lane];
+			auto found = std::find_if(tasks.begin(), tasks.end(), [ticket](const queued_task &queued) { return queued.ticket == ticket; });
+			if (found != tasks.end()) {
+				dropped = std::move(*found);
+				tasks.erase(found);
+				m_queued[lane]--;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool ipc::executor::cancel(const std::shared_ptr<strand> &serial, ticket_t ticket)
+{
+	// An emptied strand still has its runner queued, which finds nothing to do.
+	queued_task dropped;
+	std::unique_lock<std::mutex> ul(serial->lock);
+	auto found = std::find_if(serial->tasks.begin(), serial->tasks.end(), [ticket](const queued_task &queued) { return queued.ticket == ticket; });
+	if (found == serial->tasks.end()) {
+		return false;
+	}
+	dropped = std::move(*found);
+	serial->tasks.erase(found);
+	return true;
+}
+
+size_t ipc::executor::size()
+{
+	return m_workers.size();
+}
+
+ipc::lane_summary ipc::executor::get_lane_summary(ipc::priority lane)
+{
+	ipc::lane_summary summary;
+	summary.depth = m_queued[size_t(lane)].load(std::memory_order_relaxed);
+	summary.peak_depth = m_peak[size_t(lane)].load(std::memory_order_relaxed);
+	summary.queue_wait = m_wait[size_t(lane)].summarize();
+	return summary;
+}
+
+void ipc::executor::run(size_t index)
+{
+	tl_executor = this;
+	tl_index = index;
+
+	while (true) {
+		task_t task;
+		if (!take(index, task)) {
+			std::unique_lock<std::mutex> ul(m_idle_lock);
+			m_sleeping++;
+			bool found = take(index, task);
+			if (!found) {
+				if (m_stop) {
+					m_sleeping--;
+					return;
+				}
+				m_idle_cv.wait(ul);
+			}
+			m_sleeping--;
+			if (!found) {
+				continue;
+			}
+		}
+		task();
+	}
+}
+
+void ipc::executor::run_strand(std::shared_ptr<strand> serial)
+{
+	while (true) {
+		task_t task;
+		{
+			std::unique_lock<std::mutex> ul(serial->lock);
+			if (serial->tasks.size() == 0) {
+				serial->running = false;
+				return;
+			}
+			task = std::move(serial->tasks.front().task);
+			serial->tasks.pop_front();
+		}
+		task();
+	}
+}
+
+bool ipc::executor::take(size_t index, task_t &task)
+{
+	// Smooth weighted round robin over the lanes with tasks: each earns its
+	// weight, the richest one wins and pays back what all of them earned.
+	worker &own = *m_workers[index];
+	int64_t total = 0;
+	size_t best = ipc::priority_count;
+	for (size_t lane = 0; lane < ipc::priority_count; lane++) {
+		if (m_queued[lane].load() == 0) {
+			own.credit[lane] = 0;
+			continue;
+		}
+		own.credit[lane] += lane_weights[lane];
+		total += lane_weights[lane];
+		if ((best == ipc::priority_count) || (own.credit[lane] > own.credit[best])) {
+			best = lane;
+		}
+	}
+	if (best == ipc::priority_count) {
+		return false;
+	}
+	own.credit[best] -= total;
+	if (take_lane(index, best, task)) {
+		return true;
+	}
+
+	// Another worker got there first, anything else will do.
+	for (size_t lane = 0; lane < ipc::priority_count; lane++) {
+		if ((lane != best) && take_lane(index, lane, task)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ipc::executor::take_lane(size_t index, size_t lane, task_t &task)
+{
+	// Own queue first, then the other workers', always the oldest task.
+	queued_task queued;
+	bool found = false;
+	for (size_t offset = 0; !found && (offset < m_workers.size()); offset++) {
+		worker &wrk = *m_workers[(index + offset) % m_workers.size()];
+		std::unique_lock<std::mutex> ul(wrk.lock);
+		if (wrk.tasks[lane].size() > 0) {
+			queued = std::move(wrk.tasks[lane].front());
+			wrk.tasks[lane].pop_front();
+			found = true;
+		}
+	}
+
+	if (found) {
+		m_queued[lane]--;
+		m_wait[lane].record(std::chrono::steady_clock::now() - queued.posted);
+		task = std::move(queued.task);
+	}
+	return found;
+}
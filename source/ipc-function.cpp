@@ -18,6 +18,7 @@
 
 #include "ipc-function.hpp"
 #include "ipc.hpp"
+#include <algorithm>
 #include <iostream>
 
 ipc::function::function(const std::string &name, const std::vector<ipc::type> &params, call_handler_t ptr, void *data)
@@ -31,17 +32,29 @@ ipc::function::function(const std::string &name, const std::vector<ipc::type> &p
 
 ipc::function::function(const std::string &name, const std::vector<ipc::type> &params, call_handler_t ptr) : function(name, params, ptr, nullptr) {}
 
-ipc::function::function(const std::string &name, const std::vector<ipc::type> &params, void *data) : function(name, params, nullptr, data) {}
+ipc::function::function(const std::string &name, const std::vector<ipc::type> &params, void *data) : function(name, params, call_handler_t(nullptr), data) {}
 
-ipc::function::function(const std::string &name, const std::vector<ipc::type> &params) : function(name, params, nullptr, nullptr) {}
+ipc::function::function(const std::string &name, const std::vector<ipc::type> &params) : function(name, params, call_handler_t(nullptr), nullptr) {}
+
+ipc::function::function(const std::string &name, const std::vector<ipc::type> &params, call_view_handler_t ptr, void *data)
+	: function(name, params, call_handler_t(nullptr), data)
+{
+	this->m_callViewHandler = ptr;
+}
+
+ipc::function::function(const std::string &name, const std::vector<ipc::type> &params, call_view_handler_t ptr) : function(name, params, ptr, nullptr) {}
 
 ipc::function::function(const std::string &name, call_handler_t ptr, void *data) : function(name, std::vector<ipc::type>(), ptr, data) {}
 
 ipc::function::function(const std::string &name, call_handler_t ptr) : function(name, std::vector<ipc::type>(), ptr, nullptr) {}
 
-ipc::function::function(const std::string &name, void *data) : function(name, std::vector<ipc::type>(), nullptr, data) {}
+ipc::function::function(const std::string &name, call_view_handler_t ptr, void *data) : function(name, std::vector<ipc::type>(), ptr, data) {}
+
+ipc::function::function(const std::string &name, call_view_handler_t ptr) : function(name, std::vector<ipc::type>(), ptr, nullptr) {}
+
+ipc::function::function(const std::string &name, void *data) : function(name, std::vector<ipc::type>(), call_handler_t(nullptr), data) {}
 
-ipc::function::function(const std::string &name) : function(name, std::vector<ipc::type>(), nullptr, nullptr) {}
+ipc::function::function(const std::string &name) : function(name, std::vector<ipc::type>(), call_handler_t(nullptr), nullptr) {}
 
 ipc::function::~function() {}
 
@@ -59,5 +72,87 @@ void ipc::function::call(const int64_t id, const std::vector<ipc::value> &args,
 {
 	if (m_callHandler.first) {
 		return m_callHandler.first(m_callHandler.second, id, args, rval);
+	} else if (m_callViewHandler) {
+		std::vector<ipc::value_view> views(args.begin(), args.end());
+		return m_callViewHandler(m_callHandler.second, id, views, rval);
 	}
 }
+
+void ipc::function::call(const int64_t id, const std::vector<ipc::value_view> &args, std::vector<ipc::value> &rval)
+{
+	if (m_callViewHandler) {
+		return m_callViewHandler(m_callHandler.second, id, args, rval);
+	} else if (m_callHandler.first) {
+		// Handler wants owning values, copy the arguments out.
+		std::vector<ipc::value> values;
+		values.reserve(args.size());
+		for (const ipc::value_view &arg : args) {
+			values.push_back(arg.to_value());
+		}
+		return m_callHandler.first(m_callHandler.second, id, values, rval);
+	}
+}
+
+void ipc::function::set_strict(bool strict)
+{
+	m_strict = strict;
+}
+
+bool ipc::function::is_strict()
+{
+	return m_strict;
+}
+
+void ipc::function::set_cacheable(bool cacheable, const std::vector<std::string> &tags)
+{
+	m_cacheable = cacheable;
+	m_cache_tags = tags;
+}
+
+bool ipc::function::is_cacheable()
+{
+	return m_cacheable;
+}
+
+bool ipc::function::has_cache_tag(const std::string &tag)
+{
+	return std::find(m_cache_tags.begin(), m_cache_tags.end(), tag) != m_cache_tags.end();
+}
+
+void ipc::function::set_priority(ipc::priority lane)
+{
+	m_priority = lane;
+}
+
+ipc::priority ipc::function::get_priority()
+{
+	return m_priority;
+}
+
+template<typename T> bool ipc::function::check(const std::vector<T> &args, std::string &errormsg)
+{
+	if (!m_strict) {
+		return true;
+	}
+	if (args.size() != m_params.size()) {
+		errormsg = "Function '" + m_name + "' takes " + std::to_string(m_params.size()) + " arguments, got " + std::to_string(args.size()) + ".";
+		return false;
+	}
+	for (size_t idx = 0; idx < args.size(); idx++) {
+		if (args[idx].type != m_params[idx]) {
+			errormsg = "Argument " + std::to_string(idx) + " of function '" + m_name + "' has the wrong type.";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ipc::function::check_arguments(const std::vector<ipc::value_view> &args, std::string &errormsg)
+{
+	return check(args, errormsg);
+}
+
+bool ipc::function::check_arguments(const std::vector<ipc::value> &args, std::string &errormsg)
+{
+	return check(args, errormsg);
+}
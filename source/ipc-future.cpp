@@ -0,0 +1,100 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#include "ipc-future.hpp"
+#include "ipc-client.hpp"
+
+void ipc::call_future::state::complete(const std::vector<ipc::value> &rval)
+{
+	continuation_t fn;
+	std::shared_ptr<state> keep;
+	{
+		std::unique_lock<std::mutex> ul(lock);
+		if (replied) {
+			return;
+		}
+		values = rval;
+		replied = true;
+		fn = std::move(continuation);
+	}
+
+	if (fn) {
+		fn(values);
+	}
+
+	{
+		std::unique_lock<std::mutex> ul(lock);
+		ready = true;
+		keep = std::move(self);
+	}
+	cv.notify_all();
+}
+
+bool ipc::call_future::ready() const
+{
+	std::unique_lock<std::mutex> ul(m_state->lock);
+	return m_state->ready;
+}
+
+void ipc::call_future::wait() const
+{
+	std::unique_lock<std::mutex> ul(m_state->lock);
+	m_state->cv.wait(ul, [this]() { return m_state->ready; });
+}
+
+bool ipc::call_future::wait_for(std::chrono::nanoseconds timeout) const
+{
+	std::unique_lock<std::mutex> ul(m_state->lock);
+	return m_state->cv.wait_for(ul, timeout, [this]() { return m_state->ready; });
+}
+
+std::vector<ipc::value> ipc::call_future::get()
+{
+	std::unique_lock<std::mutex> ul(m_state->lock);
+	m_state->cv.wait(ul, [this]() { return m_state->ready; });
+	return std::move(m_state->values);
+}
+
+void ipc::call_future::then(continuation_t fn)
+{
+	{
+		std::unique_lock<std::mutex> ul(m_state->lock);
+		if (!m_state->replied) {
+			m_state->continuation = std::move(fn);
+			return;
+		}
+	}
+	fn(m_state->values);
+}
+
+static void complete_call(void *data, const std::vector<ipc::value> &rval)
+{
+	static_cast<ipc::call_future::state *>(data)->complete(rval);
+}
+
+ipc::call_future ipc::client::call_async(const std::string &cname, const std::string &fname, std::vector<ipc::value> args)
+{
+	std::shared_ptr<call_future::state> state = std::make_shared<call_future::state>();
+	state->self = state;
+
+	// A call that never went out completes right away without values.
+	int64_t cbid = 0;
+	if (!call(cname, fname, std::move(args), &complete_call, state.get(), cbid)) {
+		state->complete({});
+	}
+	return call_future(state);
+}
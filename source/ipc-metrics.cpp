@@ -0,0 +1,134 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#include "ipc-metrics.hpp"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+static size_t log2_floor(uint64_t value)
+{
+	size_t result = 0;
+	for (size_t shift : {32, 16, 8, 4, 2, 1}) {
+		if (value >> shift) {
+			value >>= shift;
+			result += shift;
+		}
+	}
+	return result;
+}
+
+ipc::histogram::histogram()
+{
+	for (std::atomic<uint64_t> &count : m_counts) {
+		count.store(0, std::memory_order_relaxed);
+	}
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+size_t ipc::histogram::bucket_for(uint64_t value)
+{
+	if (value < sub_buckets) {
+		return size_t(value);
+	}
+	size_t exponent = std::min(log2_floor(value), max_exponent);
+	if (exponent == max_exponent) {
+		value = std::min(value, (uint64_t(2) << max_exponent) - 1);
+	}
+	size_t sub = size_t(value >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+	return sub_buckets + (exponent - sub_bucket_bits) * sub_buckets + sub;
+}
+
+uint64_t ipc::histogram::highest_in_bucket(size_t bucket)
+{
+	if (bucket < sub_buckets) {
+		return bucket;
+	}
+	size_t exponent = (bucket - sub_buckets) / sub_buckets + sub_bucket_bits;
+	uint64_t sub = (bucket - sub_buckets) % sub_buckets;
+	uint64_t width = uint64_t(1) << (exponent - sub_bucket_bits);
+	return ((sub_buckets + sub) << (exponent - sub_bucket_bits)) + width - 1;
+}
+
+void ipc::histogram::record(std::chrono::nanoseconds duration)
+{
+	uint64_t value = uint64_t(std::max<int64_t>(0, duration.count()));
+	m_counts[bucket_for(value)].fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t max = m_max.load(std::memory_order_relaxed);
+	while ((value > max) && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+	}
+}
+
+ipc::latency_summary ipc::histogram::summarize() const
+{
+	// Work on a copy, so that calls recorded meanwhile can't shift the result.
+	std::vector<uint64_t> counts(bucket_count);
+	latency_summary summary;
+	for (size_t idx = 0; idx < bucket_count; idx++) {
+		counts[idx] = m_counts[idx].load(std::memory_order_relaxed);
+		summary.count += counts[idx];
+	}
+	summary.max = std::chrono::nanoseconds(m_max.load(std::memory_order_relaxed));
+	if (summary.count == 0) {
+		return summary;
+	}
+
+	struct target {
+		double quantile;
+		std::chrono::nanoseconds *result;
+	} targets[] = {{0.5, &summary.p50}, {0.99, &summary.p99}, {0.999, &summary.p999}};
+
+	uint64_t seen = 0;
+	size_t next = 0;
+	for (size_t idx = 0; (idx < bucket_count) && (next < 3); idx++) {
+		seen += counts[idx];
+		while ((next < 3) && (seen >= std::max<uint64_t>(1, uint64_t(targets[next].quantile * summary.count + 0.5)))) {
+			*targets[next].result = std::min(std::chrono::nanoseconds(highest_in_bucket(idx)), summary.max);
+			next++;
+		}
+	}
+	return summary;
+}
+
+ipc::histogram &ipc::metrics_registry::get(const std::string &name)
+{
+	{
+		std::shared_lock<std::shared_mutex> sl(m_lock);
+		auto found = m_histograms.find(name);
+		if (found != m_histograms.end()) {
+			return *found->second;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> ul(m_lock);
+	std::unique_ptr<histogram> &entry = m_histograms[name];
+	if (!entry) {
+		entry = std::make_unique<histogram>();
+	}
+	return *entry;
+}
+
+std::map<std::string, ipc::latency_summary> ipc::metrics_registry::snapshot()
+{
+	std::map<std::string, latency_summary> result;
+	std::shared_lock<std::shared_mutex> sl(m_lock);
+	for (auto &entry : m_histograms) {
+		result.insert(std::make_pair(entry.first, entry.second->summarize()));
+	}
+	return result;
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ipc-priority.hpp"
+
+static thread_local const ipc::priority *current_lane = nullptr;
+
+const char *ipc::priority_name(priority lane)
+{
+	switch (lane) {
+	case priority::interactive:
+		return "interactive";
+	case priority::bulk:
+		return "bulk";
+	default:
+		return "normal";
+	}
+}
+
+ipc::priority_scope::priority_scope(priority lane) : m_previous(current_lane), m_lane(lane)
+{
+	current_lane = &m_lane;
+}
+
+ipc::priority_scope::~priority_scope()
+{
+	current_lane = m_previous;
+}
+
+const ipc::priority *ipc::priority_scope::current()
+{
+	return current_lane;
+}
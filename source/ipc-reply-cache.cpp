@@ -0,0 +1,173 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ipc-reply-cache.hpp"
+#include <cstring>
+
+namespace {
+template<typename T> void append(std::string &key, const T &value, size_t size)
+{
+	key.append(reinterpret_cast<const char *>(&value), size);
+}
+
+ipc::span<const char> binary(const ipc::value &value)
+{
+	return ipc::span<const char>(value.value_bin().data(), value.value_bin().size());
+}
+
+ipc::span<const char> binary(const ipc::value_view &value)
+{
+	return value.value_bin;
+}
+
+template<typename T> std::string encode(uint32_t fid, const std::vector<T> &args)
+{
+	std::string key;
+	key.reserve(sizeof(fid) + args.size() * 9);
+	append(key, fid, sizeof(fid));
+	for (const T &arg : args) {
+		key.push_back(char(arg.type));
+		switch (arg.type) {
+		case ipc::type::Float:
+		case ipc::type::Int32:
+		case ipc::type::UInt32:
+			append(key, arg.value_union, 4);
+			break;
+		case ipc::type::Double:
+		case ipc::type::Int64:
+		case ipc::type::UInt64:
+			append(key, arg.value_union, 8);
+			break;
+		case ipc::type::String:
+			append(key, uint32_t(arg.value_str.size()), sizeof(uint32_t));
+			key.append(arg.value_str.data(), arg.value_str.size());
+			break;
+		case ipc::type::Binary:
+			append(key, uint32_t(binary(arg).size()), sizeof(uint32_t));
+			key.append(binary(arg).data(), binary(arg).size());
+			break;
+		case ipc::type::Null:
+			break;
+		}
+	}
+	return key;
+}
+}
+
+ipc::reply_cache::reply_cache(size_t capacity) : m_capacity(capacity) {}
+
+void ipc::reply_cache::set_capacity(size_t capacity)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	m_capacity = capacity;
+	while (m_entries.size() > m_capacity) {
+		erase(std::prev(m_entries.end()));
+		m_statistics.evictions++;
+	}
+}
+
+std::string ipc::reply_cache::make_key(uint32_t fid, const std::vector<ipc::value_view> &args)
+{
+	return encode(fid, args);
+}
+
+std::string ipc::reply_cache::make_key(uint32_t fid, const std::vector<ipc::value> &args)
+{
+	return encode(fid, args);
+}
+
+bool ipc::reply_cache::find(const std::string &key, std::vector<ipc::value> &rval)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	auto found = m_index.find(key);
+	if (found == m_index.end()) {
+		m_statistics.misses++;
+		return false;
+	}
+	m_entries.splice(m_entries.begin(), m_entries, found->second);
+	rval = found->second->rval;
+	m_statistics.hits++;
+	return true;
+}
+
+uint64_t ipc::reply_cache::generation()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_generation;
+}
+
+void ipc::reply_cache::insert(std::string key, uint32_t fid, const std::vector<ipc::value> &rval, uint64_t generation)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	if ((generation != m_generation) || (m_capacity == 0)) {
+		return;
+	}
+
+	auto found = m_index.find(key);
+	if (found != m_index.end()) {
+		// Another call got there first, its reply is just as good.
+		m_entries.splice(m_entries.begin(), m_entries, found->second);
+		return;
+	}
+
+	while (m_entries.size() >= m_capacity) {
+		erase(std::prev(m_entries.end()));
+		m_statistics.evictions++;
+	}
+	m_entries.push_front({key, fid, rval});
+	m_index.emplace(std::move(key), m_entries.begin());
+}
+
+uint64_t ipc::reply_cache::invalidate(uint32_t fid)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	m_generation++;
+	for (auto it = m_entries.begin(); it != m_entries.end();) {
+		auto next = std::next(it);
+		if (it->fid == fid) {
+			erase(it);
+			m_statistics.invalidations++;
+		}
+		it = next;
+	}
+	return m_generation;
+}
+
+uint64_t ipc::reply_cache::clear()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	m_generation++;
+	m_statistics.invalidations += m_entries.size();
+	m_index.clear();
+	m_entries.clear();
+	return m_generation;
+}
+
+ipc::reply_cache::statistics ipc::reply_cache::get_statistics()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	statistics result = m_statistics;
+	result.entries = m_entries.size();
+	return result;
+}
+
+void ipc::reply_cache::erase(std::list<entry>::iterator it)
+{
+	m_index.erase(it->key);
+	m_entries.erase(it);
+}
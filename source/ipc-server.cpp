@@ -17,6 +17,7 @@
 ******************************************************************************/
 
 #include "ipc-server.hpp"
+#include <algorithm>
 #include <chrono>
 #include "../include/error.hpp"
 #include "../include/tags.hpp"
@@ -25,7 +26,93 @@
 #include "windows/ipc-socket-win.hpp"
 #elif __APPLE__
 #include "apple/ipc-socket-osx.hpp"
+#elif __linux__
+#include "linux/ipc-socket-linux.hpp"
 #endif
+#ifdef __linux__
+void ipc::server::watcher()
+{
+	// Nothing is polled: sockets are queued when they are added and when their
+	// client goes away, and accepts complete on the epoll thread.
+	std::cout << "server - start watcher" << std::endl;
+	std::unique_lock<std::mutex> ul(m_watcher.lock);
+	while (!m_watcher.stop) {
+		m_watcher.cv.wait(ul, [this]() { return m_watcher.stop || !m_watcher.pending.empty(); });
+		std::deque<std::shared_ptr<ipc::socket>> pending = std::move(m_watcher.pending);
+		m_watcher.pending.clear();
+		ul.unlock();
+
+		for (auto &socket : pending) {
+			check_socket(socket);
+		}
+		ul.lock();
+	}
+}
+
+void ipc::server::watch_socket(std::shared_ptr<ipc::socket> socket)
+{
+	std::unique_lock<std::mutex> ul(m_watcher.lock);
+	m_watcher.pending.push_back(std::move(socket));
+	m_watcher.cv.notify_all();
+}
+
+void ipc::server::check_socket(std::shared_ptr<ipc::socket> socket)
+{
+	std::unique_lock<std::mutex> ul(m_sockets_mtx);
+	auto found = std::find(m_sockets.begin(), m_sockets.end(), socket);
+	if (found == m_sockets.end()) {
+		// Finalized or retired in the meantime.
+		return;
+	}
+
+	bool serving;
+	size_t listening;
+	{
+		std::unique_lock<std::mutex> ulc(m_clients_mtx);
+		if ((m_clients.count(socket) > 0) && !socket->is_connected()) {
+			kill_client(socket);
+		}
+		serving = (m_clients.count(socket) > 0);
+		listening = m_sockets.size() - m_clients.size();
+	}
+
+	if (serving) {
+		// A client took this instance, top up the ones still listening.
+		std::shared_ptr<os::linux::socket_linux> origin = std::dynamic_pointer_cast<os::linux::socket_linux>(socket);
+		for (; listening < std::max<size_t>(m_listeningInstances, 1); listening++) {
+			std::shared_ptr<ipc::socket> sibling = origin->create_sibling();
+			m_sockets.push_back(sibling);
+			listen_socket(sibling);
+		}
+	} else if (listening > std::max<size_t>(m_listeningInstances, 1)) {
+		// Its client left and there are enough others listening.
+		m_sockets.erase(found);
+	} else {
+		listen_socket(socket);
+	}
+}
+
+void ipc::server::listen_socket(std::shared_ptr<ipc::socket> socket)
+{
+	// The accept completes on the epoll thread, or right here if a client is
+	// already waiting. The socket owns the callback, so it only holds on to
+	// itself weakly.
+	std::shared_ptr<os::async_op> op;
+	std::weak_ptr<ipc::socket> weak = socket;
+	socket->accept(op, [this, weak](os::error ec, size_t length) {
+		std::shared_ptr<ipc::socket> socket = weak.lock();
+		if (socket && (ec == os::error::Connected)) {
+			spawn_client(socket);
+			watch_socket(socket);
+		}
+	});
+}
+
+void ipc::server::client_disconnected(std::shared_ptr<ipc::socket> socket)
+{
+	watch_socket(std::move(socket));
+}
+#else
 void ipc::server::watcher()
 {
 	os::error ec;
@@ -37,6 +124,8 @@ void ipc::server::watcher()
 		std::shared_ptr<ipc::socket> socket;
 #elif __APPLE__
 		std::shared_ptr<ipc::socket> socket;
+#elif __linux__
+		std::shared_ptr<ipc::socket> socket;
 #endif
 		std::chrono::high_resolution_clock::time_point start;
 
@@ -57,6 +146,8 @@ void ipc::server::watcher()
 	std::map<std::shared_ptr<ipc::socket>, pending_accept> pa_map;
 #elif __APPLE__
 	std::map<std::shared_ptr<ipc::socket>, pending_accept> pa_map;
+#elif __linux__
+	std::map<std::shared_ptr<ipc::socket>, pending_accept> pa_map;
 #endif
 
 	while (!m_watcher.stop) {
@@ -66,6 +157,8 @@ void ipc::server::watcher()
 			std::unique_lock<std::mutex> ul(m_sockets_mtx);
 			for (auto socket : m_sockets) {
 				auto pending = pa_map.find(socket);
+				// Clients may be spawned from other threads, so guard the lookup.
+				std::unique_lock<std::mutex> ulc(m_clients_mtx);
 				auto client = m_clients.find(socket);
 
 				if (client != m_clients.end()) {
@@ -75,6 +168,7 @@ void ipc::server::watcher()
 						kill_client(socket);
 					}
 				} else if (pending == pa_map.end()) {
+					ulc.unlock();
 					pending_accept pa;
 					pa.parent = this;
 					pa.start = std::chrono::high_resolution_clock::now();
@@ -103,6 +197,8 @@ void ipc::server::watcher()
 		std::vector<std::shared_ptr<ipc::socket>> idx_to_socket;
 #elif __APPLE__
 		std::vector<std::shared_ptr<ipc::socket>> idx_to_socket;
+#elif __linux__
+		std::vector<std::shared_ptr<ipc::socket>> idx_to_socket;
 #endif
 		for (auto kv : pa_map) {
 			waits.push_back(kv.second.op.get());
@@ -116,6 +212,9 @@ void ipc::server::watcher()
 	}
 }
 
+void ipc::server::client_disconnected(std::shared_ptr<ipc::socket> socket) {}
+#endif
+
 #ifdef WIN32
 void ipc::server::spawn_client(std::shared_ptr<ipc::socket> socket)
 {
@@ -140,6 +239,28 @@ void ipc::server::kill_client(std::shared_ptr<ipc::socket> socket)
 }
 #endif
 
+#ifdef __linux__
+void ipc::server::spawn_client(std::shared_ptr<ipc::socket> socket)
+{
+	std::unique_lock<std::mutex> ul(m_clients_mtx);
+	std::shared_ptr<ipc::server_instance> client = ipc::server_instance::create(this, socket, m_callTimeout);
+	if (m_handlerConnect.first) {
+		m_handlerConnect.first(m_handlerConnect.second, 0);
+	}
+	m_clients.insert_or_assign(socket, client);
+}
+
+void ipc::server::kill_client(std::shared_ptr<ipc::socket> socket)
+{
+	// Destroying the instance closes the connection, which lets the socket
+	// accept the next client.
+	m_clients.erase(socket);
+	if (m_handlerDisconnect.first) {
+		m_handlerDisconnect.first(m_handlerDisconnect.second, 0);
+	}
+}
+#endif
+
 #ifdef __APPLE__
 void ipc::server::spawn_client(std::shared_ptr<ipc::socket> socket)
 {
@@ -165,6 +286,11 @@ void ipc::server::kill_client(std::shared_ptr<ipc::socket> socket)
 
 ipc::server::server()
 {
+	// Built-in collection, lets clients trade names for function ids.
+	std::shared_ptr<ipc::collection> builtin = std::make_shared<ipc::collection>(IPC_BUILTIN_COLLECTION);
+	builtin->register_function(std::make_shared<ipc::function>(IPC_RESOLVE_FUNCTION, &ipc::server::resolve_function_handler, this));
+	register_collection(builtin);
+
 	// Start Watcher
 	m_watcher.stop = false;
 	m_watcher.worker = std::thread(std::bind(&ipc::server::watcher, this));
@@ -174,7 +300,11 @@ ipc::server::~server()
 {
 	finalize();
 
-	m_watcher.stop = true;
+	{
+		std::unique_lock<std::mutex> ul(m_watcher.lock);
+		m_watcher.stop = true;
+		m_watcher.cv.notify_all();
+	}
 	if (m_watcher.worker.joinable()) {
 		m_watcher.worker.join();
 	}
@@ -186,12 +316,27 @@ void ipc::server::initialize(std::string socketPath)
 
 	try {
 #ifdef WIN32
+		// Every pipe instance serves one client at a time.
 		std::unique_lock<std::mutex> ul(m_sockets_mtx);
-		m_sockets.insert(m_sockets.end(), std::make_shared<os::windows::socket_win>(os::create_only, socketPath, 255, os::windows::pipe_type::Byte,
-											    os::windows::pipe_read_mode::Byte, true));
+		for (size_t idx = 0; idx < std::max<size_t>(m_listeningInstances, 1); idx++) {
+			m_sockets.insert(m_sockets.end(), std::make_shared<os::windows::socket_win>(os::create_only, socketPath, 255, os::windows::pipe_type::Byte,
+												    os::windows::pipe_read_mode::Byte, idx == 0));
+		}
 #elif __APPLE__
 		std::unique_lock<std::mutex> ul(m_sockets_mtx);
 		m_sockets.insert(m_sockets.end(), std::make_shared<os::apple::socket_osx>(os::create_only, socketPath));
+#elif __linux__
+		std::unique_lock<std::mutex> ul(m_sockets_mtx);
+		// All instances share one listening socket, more are added as clients
+		// connect.
+		std::shared_ptr<os::linux::socket_linux> origin = os::linux::socket_linux::create(os::create_only, socketPath);
+		m_sockets.insert(m_sockets.end(), origin);
+		for (size_t idx = 1; idx < m_listeningInstances; idx++) {
+			m_sockets.insert(m_sockets.end(), origin->create_sibling());
+		}
+		for (auto &socket : m_sockets) {
+			watch_socket(socket);
+		}
 #endif
 	} catch (std::exception e) {
 		throw e;
@@ -226,6 +371,18 @@ void ipc::server::set_call_timeout(int callTimeout)
 	m_callTimeout = callTimeout;
 }
 
+void ipc::server::set_listening_instances(size_t count)
+{
+	m_listeningInstances = count;
+}
+
+void ipc::server::set_executor_threads(size_t threads)
+{
+	std::unique_lock<std::mutex> ul(m_strands_mtx);
+	m_strands.clear();
+	m_executor = (threads > 0) ? std::make_shared<ipc::executor>(threads) : nullptr;
+}
+
 void ipc::server::set_connect_handler(server_connect_handler_t handler, void *data)
 {
 	m_handlerConnect = std::make_pair(handler, data);
@@ -260,26 +417,224 @@ bool ipc::server::register_collection(std::shared_ptr<ipc::collection> cls)
 	return true;
 }
 
+uint32_t ipc::server::resolve_function(const std::string &cname, const std::string &fname)
+{
+	std::pair<std::string, std::string> key(cname, fname);
+	{
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		auto found = m_function_ids.find(key);
+		if (found != m_function_ids.end()) {
+			return found->second;
+		}
+	}
+
+	auto cls = m_classes.find(cname);
+	if (cls == m_classes.end()) {
+		return invalid_function_id;
+	}
+	auto fnc = cls->second->get_function(fname);
+	if (!fnc) {
+		return invalid_function_id;
+	}
+
+	// IDs are handed out on first use, so functions registered late get one too.
+	std::unique_lock<std::shared_mutex> ul(m_functions_mtx);
+	auto found = m_function_ids.find(key);
+	if (found != m_function_ids.end()) {
+		return found->second;
+	}
+	uint32_t id = uint32_t(m_functions.size());
+	m_functions.push_back({cname, fname, cls->second, fnc, std::make_shared<ipc::function_metrics>()});
+	m_function_ids.insert(std::make_pair(key, id));
+	return id;
+}
+
+void ipc::server::resolve_function_handler(void *data, const int64_t id, const std::vector<ipc::value_view> &args, std::vector<ipc::value> &rval)
+{
+	ipc::server *self = static_cast<ipc::server *>(data);
+	if ((args.size() != 2) || (args[0].type != ipc::type::String) || (args[1].type != ipc::type::String)) {
+		return;
+	}
+
+	uint32_t fid = self->resolve_function(std::string(args[0].value_str), std::string(args[1].value_str));
+	if (fid == invalid_function_id) {
+		return;
+	}
+	rval.push_back(ipc::value(fid));
+
+	std::shared_lock<std::shared_mutex> sl(self->m_functions_mtx);
+	if (self->m_functions[fid].fnc->is_cacheable()) {
+		rval.push_back(ipc::value(self->m_cache.generation()));
+	}
+}
+
+void ipc::server::publish(const std::string &topic, const std::vector<ipc::value> &values)
+{
+	// Writing may run socket callbacks, which must not find the lock taken.
+	std::vector<std::shared_ptr<event_sink>> sinks;
+	{
+		std::unique_lock<std::mutex> ul(m_subscribers_mtx);
+		auto found = m_subscribers.find(topic);
+		if (found == m_subscribers.end()) {
+			return;
+		}
+		sinks.assign(found->second.begin(), found->second.end());
+	}
+	for (std::shared_ptr<event_sink> &sink : sinks) {
+		sink->push_event(topic, values);
+	}
+}
+
+void ipc::server::subscribe(std::shared_ptr<event_sink> sink, const std::string &topic)
+{
+	std::unique_lock<std::mutex> ul(m_subscribers_mtx);
+	m_subscribers[topic].insert(sink);
+}
+
+void ipc::server::unsubscribe(std::shared_ptr<event_sink> sink, const std::string &topic)
+{
+	std::unique_lock<std::mutex> ul(m_subscribers_mtx);
+	auto found = m_subscribers.find(topic);
+	if (found == m_subscribers.end()) {
+		return;
+	}
+	found->second.erase(sink);
+	if (found->second.empty()) {
+		m_subscribers.erase(found);
+	}
+}
+
+void ipc::server::unsubscribe_all(std::shared_ptr<event_sink> sink)
+{
+	std::unique_lock<std::mutex> ul(m_subscribers_mtx);
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end();) {
+		it->second.erase(sink);
+		if (it->second.empty()) {
+			it = m_subscribers.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+ipc::priority ipc::server::call_priority(const ipc::message::function_call_view &call, const ipc::priority *requested)
+{
+	if (requested) {
+		return *requested;
+	}
+
+	std::shared_ptr<ipc::function> fnc;
+	if (call.class_name.type == ipc::type::UInt32) {
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		if (call.class_name.value_union.ui32 < m_functions.size()) {
+			fnc = m_functions[call.class_name.value_union.ui32].fnc;
+		}
+	} else {
+		auto found = m_classes.find(std::string(call.class_name.value_str));
+		if (found != m_classes.end()) {
+			fnc = found->second->get_function(std::string(call.function_name.value_str));
+		}
+	}
+	return fnc ? fnc->get_priority() : ipc::priority::normal;
+}
+
+std::shared_ptr<ipc::executor::strand> ipc::server::find_strand(const ipc::message::function_call_view &call)
+{
+	std::shared_ptr<ipc::collection> cls;
+	if (call.class_name.type == ipc::type::UInt32) {
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		if (call.class_name.value_union.ui32 < m_functions.size()) {
+			cls = m_functions[call.class_name.value_union.ui32].cls;
+		}
+	} else {
+		auto found = m_classes.find(std::string(call.class_name.value_str));
+		if (found != m_classes.end()) {
+			cls = found->second;
+		}
+	}
+	if (!cls || !cls->is_serial()) {
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> ul(m_strands_mtx);
+	std::shared_ptr<ipc::executor::strand> &serial = m_strands[cls->get_name()];
+	if (!serial) {
+		serial = std::make_shared<ipc::executor::strand>();
+	}
+	return serial;
+}
+
+ipc::executor::ticket_t ipc::server::dispatch(const ipc::message::function_call_view &call, std::function<void()> task, ipc::priority lane)
+{
+	if (!m_executor) {
+		task();
+		return 0;
+	}
+
+	std::shared_ptr<ipc::executor::strand> serial = find_strand(call);
+	return serial ? m_executor->post(serial, std::move(task), lane) : m_executor->post(std::move(task), lane);
+}
+
+bool ipc::server::withdraw(const ipc::message::function_call_view &call, ipc::executor::ticket_t ticket)
+{
+	if (!m_executor || (ticket == 0)) {
+		return false;
+	}
+
+	std::shared_ptr<ipc::executor::strand> serial = find_strand(call);
+	return serial ? m_executor->cancel(serial, ticket) : m_executor->cancel(ticket);
+}
+
 bool ipc::server::client_call_function(int64_t cid, const std::string &cname, const std::string &fname, std::vector<ipc::value> &args,
 				       std::vector<ipc::value> &rval, std::string &errormsg)
 {
-	if (m_classes.count(cname) == 0) {
+	auto cls = m_classes.find(cname);
+	if (cls == m_classes.end()) {
 		errormsg = "Class '" + cname + "' is not registered.";
 		return false;
 	}
-	auto cls = m_classes.at(cname);
 
-	auto fnc = cls->get_function(fname);
+	auto fnc = cls->second->get_function(fname);
 	if (!fnc) {
 		errormsg = "Function '" + fname + "' not found in class '" + cname + "'.";
 		return false;
 	}
+	if (!fnc->check_arguments(args, errormsg)) {
+		return false;
+	}
+
+	std::shared_ptr<ipc::function_metrics> metrics;
+	uint32_t fid = resolve_function(cname, fname);
+	if (fid != invalid_function_id) {
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		metrics = m_functions[fid].metrics;
+	}
 
 	if (m_preCallback.first) {
 		m_preCallback.first(cname, fname, args, m_preCallback.second);
 	}
 
+	std::string key;
+	uint64_t generation = 0;
+	if (fnc->is_cacheable() && (fid != invalid_function_id)) {
+		key = ipc::reply_cache::make_key(fid, args);
+		if (find_cached(key, metrics.get(), rval)) {
+			if (m_postCallback.first) {
+				m_postCallback.first(cname, fname, rval, m_postCallback.second);
+			}
+			return true;
+		}
+		generation = m_cache.generation();
+	}
+
+	auto start = std::chrono::steady_clock::now();
 	fnc->call(cid, args, rval);
+	if (metrics) {
+		metrics->handler.record(std::chrono::steady_clock::now() - start);
+	}
+	if (!key.empty()) {
+		m_cache.insert(std::move(key), fid, rval, generation);
+	}
 
 	if (m_postCallback.first) {
 		m_postCallback.first(cname, fname, rval, m_postCallback.second);
@@ -287,3 +642,212 @@ bool ipc::server::client_call_function(int64_t cid, const std::string &cname, co
 
 	return true;
 }
+
+bool ipc::server::client_call_function(int64_t cid, const ipc::message::function_call_view &call, std::vector<ipc::value> &rval, std::string &errormsg,
+				       call_timing *timing)
+{
+	uint32_t fid;
+
+	if (call.class_name.type == ipc::type::UInt32) {
+		fid = call.class_name.value_union.ui32;
+	} else {
+		// Calls by name get an id as well, it is where their metrics live.
+		std::string cname_str(call.class_name.value_str);
+		std::string fname_str(call.function_name.value_str);
+		fid = resolve_function(cname_str, fname_str);
+		if (fid == invalid_function_id) {
+			if (m_classes.find(cname_str) == m_classes.end()) {
+				errormsg = "Class '" + cname_str + "' is not registered.";
+			} else {
+				errormsg = "Function '" + fname_str + "' not found in class '" + cname_str + "'.";
+			}
+			return false;
+		}
+	}
+
+	const function_entry *entry;
+	{
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		if (fid >= m_functions.size()) {
+			errormsg = "Function id " + std::to_string(fid) + " is not known.";
+			return false;
+		}
+		// Entries are never removed, so they stay valid after unlocking.
+		entry = &m_functions[fid];
+	}
+	const std::string *cname = &entry->cname, *fname = &entry->fname;
+	const std::shared_ptr<ipc::function> &fnc = entry->fnc;
+	if (!fnc->check_arguments(call.arguments, errormsg)) {
+		return false;
+	}
+
+	if (timing) {
+		timing->metrics = entry->metrics.get();
+		if (timing->queued.time_since_epoch().count() != 0) {
+			entry->metrics->queue_wait.record(std::chrono::steady_clock::now() - timing->queued);
+		}
+	}
+	if (drop_expired(call.deadline, false)) {
+		errormsg = IPC_DEADLINE_EXCEEDED;
+		return false;
+	}
+
+	if (m_preCallback.first) {
+		// The callback takes owning values, only copy them when there is one.
+		std::vector<ipc::value> values;
+		values.reserve(call.arguments.size());
+		for (const ipc::value_view &arg : call.arguments) {
+			values.push_back(arg.to_value());
+		}
+		m_preCallback.first(*cname, *fname, values, m_preCallback.second);
+	}
+
+	std::string key;
+	uint64_t generation = 0;
+	if (fnc->is_cacheable()) {
+		key = ipc::reply_cache::make_key(fid, call.arguments);
+		if (find_cached(key, entry->metrics.get(), rval)) {
+			if (m_postCallback.first) {
+				m_postCallback.first(*cname, *fname, rval, m_postCallback.second);
+			}
+			return true;
+		}
+		generation = m_cache.generation();
+	}
+
+	auto handler_start = std::chrono::steady_clock::now();
+	fnc->call(cid, call.arguments, rval);
+	entry->metrics->handler.record(std::chrono::steady_clock::now() - handler_start);
+	if (!key.empty()) {
+		m_cache.insert(std::move(key), fid, rval, generation);
+	}
+
+	if (m_postCallback.first) {
+		m_postCallback.first(*cname, *fname, rval, m_postCallback.second);
+	}
+
+	return true;
+}
+
+ipc::server::deadline_statistics ipc::server::get_deadline_statistics()
+{
+	return {m_expired_calls.load(std::memory_order_relaxed), m_expired_replies.load(std::memory_order_relaxed)};
+}
+
+bool ipc::server::drop_expired(uint64_t deadline, bool handler_ran)
+{
+	if (!ipc::deadline_passed(deadline)) {
+		return false;
+	}
+	(handler_ran ? m_expired_replies : m_expired_calls).fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+ipc::server::cancel_statistics ipc::server::get_cancel_statistics()
+{
+	return {m_cancelled_calls.load(std::memory_order_relaxed), m_cancelled_handlers.load(std::memory_order_relaxed)};
+}
+
+void ipc::server::count_cancelled(bool handler_ran)
+{
+	(handler_ran ? m_cancelled_handlers : m_cancelled_calls).fetch_add(1, std::memory_order_relaxed);
+}
+
+std::map<std::string, ipc::function_summary> ipc::server::snapshot_metrics()
+{
+	std::map<std::string, ipc::function_summary> result;
+	std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+	for (const function_entry &entry : m_functions) {
+		ipc::function_summary summary;
+		summary.queue_wait = entry.metrics->queue_wait.summarize();
+		summary.handler = entry.metrics->handler.summarize();
+		summary.serialize = entry.metrics->serialize.summarize();
+		summary.cache_hits = entry.metrics->cache_hits.load(std::memory_order_relaxed);
+		summary.cache_misses = entry.metrics->cache_misses.load(std::memory_order_relaxed);
+		result.insert(std::make_pair(entry.cname + "::" + entry.fname, summary));
+	}
+	return result;
+}
+
+std::map<std::string, ipc::lane_summary> ipc::server::snapshot_lanes()
+{
+	std::map<std::string, ipc::lane_summary> result;
+	for (size_t lane = 0; lane < ipc::priority_count; lane++) {
+		ipc::priority prio = ipc::priority(lane);
+		result.insert(std::make_pair(ipc::priority_name(prio), m_executor ? m_executor->get_lane_summary(prio) : ipc::lane_summary()));
+	}
+	return result;
+}
+
+bool ipc::server::find_cached(const std::string &key, ipc::function_metrics *metrics, std::vector<ipc::value> &rval)
+{
+	bool found = m_cache.find(key, rval);
+	if (metrics) {
+		(found ? metrics->cache_hits : metrics->cache_misses).fetch_add(1, std::memory_order_relaxed);
+	}
+	return found;
+}
+
+void ipc::server::set_cache_capacity(size_t entries)
+{
+	m_cache.set_capacity(entries);
+}
+
+void ipc::server::invalidate(const std::string &cname, const std::string &fname)
+{
+	uint32_t fid;
+	{
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		auto found = m_function_ids.find(std::make_pair(cname, fname));
+		if (found == m_function_ids.end()) {
+			// Without an id the function was never called, nothing is cached.
+			return;
+		}
+		fid = found->second;
+	}
+	notify_invalidated(fid, m_cache.invalidate(fid));
+}
+
+void ipc::server::invalidate_tag(const std::string &tag)
+{
+	std::vector<uint32_t> fids;
+	{
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		for (size_t idx = 0; idx < m_functions.size(); idx++) {
+			if (m_functions[idx].fnc->has_cache_tag(tag)) {
+				fids.push_back(uint32_t(idx));
+			}
+		}
+	}
+	for (uint32_t fid : fids) {
+		notify_invalidated(fid, m_cache.invalidate(fid));
+	}
+}
+
+void ipc::server::invalidate_all()
+{
+	uint64_t generation = m_cache.clear();
+
+	std::vector<uint32_t> fids;
+	{
+		std::shared_lock<std::shared_mutex> sl(m_functions_mtx);
+		for (size_t idx = 0; idx < m_functions.size(); idx++) {
+			if (m_functions[idx].fnc->is_cacheable()) {
+				fids.push_back(uint32_t(idx));
+			}
+		}
+	}
+	for (uint32_t fid : fids) {
+		notify_invalidated(fid, generation);
+	}
+}
+
+void ipc::server::notify_invalidated(uint32_t fid, uint64_t generation)
+{
+	publish(IPC_INVALIDATE_TOPIC + std::to_string(fid), {ipc::value(generation)});
+}
+
+ipc::reply_cache::statistics ipc::server::cache_statistics()
+{
+	return m_cache.get_statistics();
+}
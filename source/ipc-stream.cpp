@@ -0,0 +1,341 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#include "ipc-stream.hpp"
+#include "ipc-buffer-pool.hpp"
+#include "ipc.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Credit goes back in steps, not for every read.
+#define GRANT_THRESHOLD (ipc::stream_writer::window / 4)
+
+static thread_local ipc::stream_table *current_table = nullptr;
+
+ipc::stream_writer::stream_writer(uint64_t id, send_t send) : m_id(id), m_send(std::move(send)) {}
+
+ipc::stream_writer::~stream_writer()
+{
+	if (!m_closed && !m_failed) {
+		m_send(m_id, nullptr, 0, ipc::stream_end | ipc::stream_reset);
+	}
+}
+
+bool ipc::stream_writer::write(const char *data, size_t length)
+{
+	std::unique_lock<std::mutex> sl(m_send_lock);
+	while (length > 0) {
+		size_t size;
+		{
+			std::unique_lock<std::mutex> ul(m_lock);
+			m_cv.wait(ul, [this]() { return m_credit > 0 || m_failed; });
+			if (m_failed || m_closed) {
+				return false;
+			}
+			size = std::min(std::min(length, chunk_size), m_credit);
+			m_credit -= size;
+		}
+		if (!m_send(m_id, data, size, 0)) {
+			fail();
+			return false;
+		}
+		data += size;
+		length -= size;
+	}
+	return true;
+}
+
+bool ipc::stream_writer::close()
+{
+	std::unique_lock<std::mutex> sl(m_send_lock);
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		if (m_failed || m_closed) {
+			return false;
+		}
+		m_closed = true;
+	}
+	return m_send(m_id, nullptr, 0, ipc::stream_end);
+}
+
+void ipc::stream_writer::add_credit(size_t bytes)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	m_credit += bytes;
+	m_cv.notify_all();
+}
+
+void ipc::stream_writer::fail()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	m_failed = true;
+	m_cv.notify_all();
+}
+
+void ipc::stream_writer::reset()
+{
+	bool end;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		end = !m_closed && !m_failed;
+		m_failed = true;
+		m_cv.notify_all();
+	}
+
+	// The receiver forgets the stream once this arrives. Waits for a write
+	// that is still sending, the woken up ones give up.
+	if (end) {
+		std::unique_lock<std::mutex> sl(m_send_lock);
+		m_send(m_id, nullptr, 0, ipc::stream_end | ipc::stream_reset);
+	}
+}
+
+std::shared_ptr<ipc::stream_reader> ipc::stream_reader::open(uint64_t id)
+{
+	if (!current_table) {
+		return nullptr;
+	}
+	return current_table->open(id);
+}
+
+ipc::stream_reader::stream_reader(uint64_t id, grant_t grant) : m_id(id), m_grant(std::move(grant)) {}
+
+ipc::stream_reader::~stream_reader()
+{
+	if (m_abandon && !m_ended && !m_failed) {
+		m_abandon(m_id);
+	}
+	for (chunk &item : m_chunks) {
+		ipc::buffer_pool::release(std::move(item.data));
+	}
+}
+
+size_t ipc::stream_reader::read(char *buffer, size_t length)
+{
+	size_t size = 0;
+	size_t grant = 0;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		m_cv.wait(ul, [this]() { return !m_chunks.empty() || m_ended || m_failed; });
+
+		while ((size < length) && !m_chunks.empty()) {
+			chunk &front = m_chunks.front();
+			size_t count = std::min(length - size, front.data.size() - front.offset);
+			memcpy(buffer + size, front.data.data() + front.offset, count);
+			front.offset += count;
+			size += count;
+			if (front.offset == front.data.size()) {
+				ipc::buffer_pool::release(std::move(front.data));
+				m_chunks.pop_front();
+			}
+		}
+
+		m_consumed += size;
+		if ((m_consumed >= GRANT_THRESHOLD) && !m_ended && !m_failed) {
+			grant = m_consumed;
+			m_consumed = 0;
+		}
+	}
+
+	if (grant > 0) {
+		m_grant(m_id, grant);
+	}
+	return size;
+}
+
+bool ipc::stream_reader::eof()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_chunks.empty() && (m_ended || m_failed);
+}
+
+bool ipc::stream_reader::failed()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_failed;
+}
+
+void ipc::stream_reader::push(std::vector<char> &&data, size_t offset, bool end)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	if (offset < data.size()) {
+		m_chunks.push_back({std::move(data), offset});
+	} else {
+		ipc::buffer_pool::release(std::move(data));
+	}
+	m_ended = m_ended || end;
+	m_cv.notify_all();
+}
+
+void ipc::stream_reader::fail()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	if (!m_ended) {
+		m_failed = true;
+	}
+	m_cv.notify_all();
+}
+
+ipc::stream_table::stream_table(stream_reader::grant_t grant) : m_grant(std::move(grant)) {}
+
+ipc::stream_table::entry &ipc::stream_table::find(uint64_t id, std::vector<uint64_t> &resets)
+{
+	auto found = m_readers.find(id);
+	if (found != m_readers.end()) {
+		return found->second;
+	}
+
+	// Nothing stops a client from sending chunks no handler ever opens.
+	if (m_unopened >= max_unopened) {
+		for (auto it = m_readers.begin(); it != m_readers.end(); it++) {
+			if (it->second.opened || it->second.reset) {
+				continue;
+			}
+			if (it->second.ended) {
+				m_readers.erase(it);
+			} else {
+				it->second.reset = true;
+				it->second.pending = nullptr;
+				resets.push_back(it->first);
+			}
+			m_unopened--;
+			break;
+		}
+	}
+
+	entry &created = m_readers[id];
+	created.pending = std::make_shared<stream_reader>(id, m_grant);
+	if (m_failed) {
+		created.pending->fail();
+	}
+	m_unopened++;
+	return created;
+}
+
+std::shared_ptr<ipc::stream_reader> ipc::stream_table::open(uint64_t id)
+{
+	std::vector<uint64_t> resets;
+	std::shared_ptr<stream_reader> reader;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		entry &found = find(id, resets);
+		if (found.opened) {
+			reader = found.reader.lock();
+		} else if (!found.reset) {
+			std::weak_ptr<stream_table> weak = weak_from_this();
+			reader = std::move(found.pending);
+			reader->m_abandon = [weak](uint64_t id) {
+				if (std::shared_ptr<stream_table> table = weak.lock()) {
+					table->abandon(id);
+				}
+			};
+			found.reader = reader;
+			found.opened = true;
+			m_unopened--;
+			if (found.ended) {
+				m_readers.erase(id);
+			}
+		}
+	}
+
+	for (uint64_t reset : resets) {
+		m_grant(reset, 0);
+	}
+
+	// A stream that was reset already stays failed.
+	if (!reader) {
+		reader = std::make_shared<stream_reader>(id, m_grant);
+		reader->fail();
+	}
+	return reader;
+}
+
+void ipc::stream_table::push(uint64_t id, std::vector<char> &&data, size_t offset, uint8_t flags)
+{
+	bool end = (flags & ipc::stream_end) != 0;
+	bool reset = (flags & ipc::stream_reset) != 0;
+	std::vector<uint64_t> resets;
+	std::shared_ptr<stream_reader> reader;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		entry &found = find(id, resets);
+		if (found.reset) {
+			if (end) {
+				m_readers.erase(id);
+			}
+		} else {
+			reader = found.opened ? found.reader.lock() : found.pending;
+			found.ended = end;
+			if (found.ended && found.opened) {
+				m_readers.erase(id);
+			}
+		}
+	}
+
+	for (uint64_t reset : resets) {
+		m_grant(reset, 0);
+	}
+
+	if (!reader) {
+		ipc::buffer_pool::release(std::move(data));
+		return;
+	}
+	reader->push(std::move(data), offset, end && !reset);
+	if (reset) {
+		reader->fail();
+	}
+}
+
+void ipc::stream_table::abandon(uint64_t id)
+{
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		auto found = m_readers.find(id);
+		if ((found == m_readers.end()) || found->second.ended || found->second.reset) {
+			return;
+		}
+		found->second.reset = true;
+	}
+	m_grant(id, 0);
+}
+
+void ipc::stream_table::fail_all()
+{
+	std::map<uint64_t, entry> readers;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		m_failed = true;
+		m_unopened = 0;
+		std::swap(readers, m_readers);
+	}
+	for (auto &found : readers) {
+		std::shared_ptr<stream_reader> reader = found.second.opened ? found.second.reader.lock() : found.second.pending;
+		if (reader) {
+			reader->fail();
+		}
+	}
+}
+
+ipc::stream_table::scope::scope(stream_table *table) : m_previous(current_table)
+{
+	current_table = table;
+}
+
+ipc::stream_table::scope::~scope()
+{
+	current_table = m_previous;
+}
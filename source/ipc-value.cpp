@@ -17,14 +17,42 @@
 ******************************************************************************/
 
 #include "ipc-value.hpp"
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include "ipc-varint.hpp"
+
+ipc::value_storage &ipc::value_storage::assign(const char *data, size_t size)
+{
+	// The old contents may be the source, so they are freed last.
+	char *old = is_inline() ? nullptr : heap();
+	if (old && size == m_size) {
+		memmove(old, data, size);
+		return *this;
+	}
+
+	if (size < inline_size) {
+		if (size > 0) {
+			memmove(m_bytes, data, size);
+		}
+		m_bytes[size] = 0;
+	} else {
+		char *ptr = new char[size + 1];
+		memcpy(ptr, data, size);
+		ptr[size] = 0;
+		memcpy(m_bytes, &ptr, sizeof(ptr));
+	}
+	m_size = static_cast<uint32_t>(size);
+	delete[] old;
+	return *this;
+}
 
 ipc::value::value()
 {
 	this->type = type::Null;
 }
 
-ipc::value::value(const std::vector<char> &p_value) : type(type::Binary), value_bin(p_value) {}
+ipc::value::value(const std::vector<char> &p_value) : type(type::Binary), value_str(p_value) {}
 
 ipc::value::value(const std::string &p_value) : type(type::String), value_str(p_value) {}
 
@@ -92,7 +120,7 @@ size_t ipc::value::size()
 		break;
 	case type::Binary:
 		size += sizeof(uint32_t);
-		size += this->value_bin.size();
+		size += this->value_bin().size();
 		break;
 	}
 	return size;
@@ -145,21 +173,134 @@ size_t ipc::value::serialize(std::vector<char> &buf, size_t offset)
 		noffset += this->value_str.size();
 		break;
 	case type::Binary:
-		reinterpret_cast<uint32_t &>(buf[noffset]) = static_cast<uint32_t>(this->value_bin.size());
+		reinterpret_cast<uint32_t &>(buf[noffset]) = static_cast<uint32_t>(this->value_bin().size());
 		noffset += sizeof(uint32_t);
-		if (this->value_bin.size() > 0) {
-			auto bin_begin = this->value_bin.begin();
-			auto bin_end = this->value_bin.end();
+		if (this->value_bin().size() > 0) {
+			auto bin_begin = this->value_bin().begin();
+			auto bin_end = this->value_bin().end();
 			auto buffer_begin = buf.begin() + noffset;
 			std::copy(bin_begin, bin_end, buffer_begin);
 		}
-		noffset += this->value_bin.size();
+		noffset += this->value_bin().size();
+		break;
+	}
+	return noffset - offset;
+}
+
+size_t ipc::value::size_v2()
+{
+	size_t size = 1;
+	switch (this->type) {
+	case type::Float:
+		size += sizeof(float_t);
+		break;
+	case type::Double:
+		size += sizeof(double_t);
+		break;
+	case type::Int32:
+		size += ipc::varint::size(ipc::varint::zigzag(this->value_union.i32));
+		break;
+	case type::Int64:
+		size += ipc::varint::size(ipc::varint::zigzag(this->value_union.i64));
+		break;
+	case type::UInt32:
+		size += ipc::varint::size(this->value_union.ui32);
+		break;
+	case type::UInt64:
+		size += ipc::varint::size(this->value_union.ui64);
+		break;
+	case type::String:
+		size += ipc::varint::size(this->value_str.size()) + this->value_str.size();
+		break;
+	case type::Binary:
+		size += ipc::varint::size(this->value_bin().size()) + this->value_bin().size();
+		break;
+	}
+	return size;
+}
+
+size_t ipc::value::serialize_v2(std::vector<char> &buf, size_t offset)
+{
+	if ((buf.size() - offset) < size_v2()) {
+		throw std::runtime_error("Value serialization failed, buffer too small");
+	}
+	size_t noffset = offset;
+	buf[noffset++] = char(this->type);
+	switch (this->type) {
+	case type::Float:
+		memcpy(&buf[noffset], &this->value_union.fp32, sizeof(float_t));
+		noffset += sizeof(float_t);
+		break;
+	case type::Double:
+		memcpy(&buf[noffset], &this->value_union.fp64, sizeof(double_t));
+		noffset += sizeof(double_t);
+		break;
+	case type::Int32:
+		noffset += ipc::varint::write(buf, noffset, ipc::varint::zigzag(this->value_union.i32));
+		break;
+	case type::Int64:
+		noffset += ipc::varint::write(buf, noffset, ipc::varint::zigzag(this->value_union.i64));
+		break;
+	case type::UInt32:
+		noffset += ipc::varint::write(buf, noffset, this->value_union.ui32);
+		break;
+	case type::UInt64:
+		noffset += ipc::varint::write(buf, noffset, this->value_union.ui64);
+		break;
+	case type::String:
+		noffset += ipc::varint::write(buf, noffset, this->value_str.size());
+		if (this->value_str.size() > 0) {
+			memcpy(&buf[noffset], this->value_str.data(), this->value_str.size());
+		}
+		noffset += this->value_str.size();
+		break;
+	case type::Binary:
+		noffset += ipc::varint::write(buf, noffset, this->value_bin().size());
+		if (this->value_bin().size() > 0) {
+			memcpy(&buf[noffset], this->value_bin().data(), this->value_bin().size());
+		}
+		noffset += this->value_bin().size();
 		break;
 	}
 	return noffset - offset;
 }
 
 size_t ipc::value::deserialize(const std::vector<char> &buf, size_t offset)
+{
+	ipc::value_view view;
+	size_t length = view.deserialize(buf, offset);
+	*this = view.to_value();
+	return length;
+}
+
+ipc::value_view::value_view()
+{
+	this->type = type::Null;
+	this->value_union.ui64 = 0;
+}
+
+ipc::value_view::value_view(const ipc::value &p_value)
+{
+	this->type = p_value.type;
+	memcpy(&this->value_union, &p_value.value_union, sizeof(this->value_union));
+	this->value_str = p_value.value_str.view();
+	this->value_bin = ipc::span<const char>(p_value.value_bin().data(), p_value.value_bin().size());
+}
+
+ipc::value ipc::value_view::to_value() const
+{
+	ipc::value result;
+	result.type = this->type;
+	memcpy(&result.value_union, &this->value_union, sizeof(result.value_union));
+	if (this->type == type::String) {
+		result.value_str.assign(this->value_str.data(), this->value_str.size());
+	} else if (this->type == type::Binary) {
+		result.value_bin().assign(this->value_bin.begin(), this->value_bin.end());
+	}
+	return result;
+}
+
+size_t ipc::value_view::deserialize(const std::vector<char> &buf, size_t offset)
 {
 	if ((buf.size() - offset) < sizeof(uint32_t)) {
 		abort();
@@ -194,20 +335,13 @@ size_t ipc::value::deserialize(const std::vector<char> &buf, size_t offset)
 			abort();
 			// throw std::exception((const std::exception&)"Deserialize of string value failed, length missing");
 		}
-		length = reinterpret_cast<const uint32_t &>(buf[noffset]);
+		memcpy(&length, &buf[noffset], sizeof(uint32_t));
 		noffset += sizeof(uint32_t);
 		if ((buf.size() - noffset) < length) {
 			abort();
 			// throw std::exception((const std::exception&)"Deserialize of string value failed, string missing");
 		}
-
-		this->value_str.clear();
-		this->value_str.resize(length);
-		if (length > 0) {
-			auto begin = buf.begin() + noffset;
-			auto end = buf.begin() + noffset + static_cast<size_t>(length);
-			this->value_str = std::string(begin, end);
-		}
+		this->value_str = std::string_view(buf.data() + noffset, length);
 		noffset += length;
 		break;
 	case type::Binary:
@@ -215,21 +349,78 @@ size_t ipc::value::deserialize(const std::vector<char> &buf, size_t offset)
 			abort();
 			// throw std::exception((const std::exception&)"Deserialize of buffer value failed, length missing");
 		}
-		length = reinterpret_cast<const uint32_t &>(buf[noffset]);
+		memcpy(&length, &buf[noffset], sizeof(uint32_t));
 		noffset += sizeof(uint32_t);
 		if ((buf.size() - noffset) < length) {
 			abort();
 			// throw std::exception((const std::exception&)"Deserialize of buffer value failed, buffer missing");
 		}
-		this->value_bin.clear();
-		this->value_bin.resize(length);
-		if (length > 0) {
-			auto begin = buf.begin() + noffset;
-			auto end = buf.begin() + noffset + static_cast<size_t>(length);
-			this->value_bin = std::vector<char>(begin, end);
-		}
+		this->value_bin = ipc::span<const char>(buf.data() + noffset, length);
 		noffset += length;
 		break;
 	}
 	return (noffset - offset);
 }
+
+size_t ipc::value_view::deserialize_v2(const std::vector<char> &buf, size_t offset)
+{
+	if (offset >= buf.size()) {
+		throw std::runtime_error("Value deserialization failed, type missing");
+	}
+	this->type = ipc::type(uint8_t(buf[offset]));
+	size_t noffset = offset + 1;
+	uint64_t number;
+	switch (this->type) {
+	case type::Null:
+		break;
+	case type::Float:
+		if ((buf.size() - noffset) < sizeof(float_t)) {
+			throw std::runtime_error("Value deserialization failed, float truncated");
+		}
+		memcpy(&this->value_union.fp32, &buf[noffset], sizeof(float_t));
+		noffset += sizeof(float_t);
+		break;
+	case type::Double:
+		if ((buf.size() - noffset) < sizeof(double_t)) {
+			throw std::runtime_error("Value deserialization failed, double truncated");
+		}
+		memcpy(&this->value_union.fp64, &buf[noffset], sizeof(double_t));
+		noffset += sizeof(double_t);
+		break;
+	case type::Int32:
+		noffset += ipc::varint::read(buf, noffset, number);
+		this->value_union.i32 = int32_t(ipc::varint::unzigzag(number));
+		break;
+	case type::Int64:
+		noffset += ipc::varint::read(buf, noffset, number);
+		this->value_union.i64 = ipc::varint::unzigzag(number);
+		break;
+	case type::UInt32:
+		noffset += ipc::varint::read(buf, noffset, number);
+		this->value_union.ui32 = uint32_t(number);
+		break;
+	case type::UInt64:
+		noffset += ipc::varint::read(buf, noffset, number);
+		this->value_union.ui64 = number;
+		break;
+	case type::String:
+		noffset += ipc::varint::read(buf, noffset, number);
+		if ((buf.size() - noffset) < number) {
+			throw std::runtime_error("Value deserialization failed, string truncated");
+		}
+		this->value_str = std::string_view(buf.data() + noffset, size_t(number));
+		noffset += size_t(number);
+		break;
+	case type::Binary:
+		noffset += ipc::varint::read(buf, noffset, number);
+		if ((buf.size() - noffset) < number) {
+			throw std::runtime_error("Value deserialization failed, binary truncated");
+		}
+		this->value_bin = ipc::span<const char>(buf.data() + noffset, size_t(number));
+		noffset += size_t(number);
+		break;
+	default:
+		throw std::runtime_error("Value deserialization failed, unknown type");
+	}
+	return noffset - offset;
+}
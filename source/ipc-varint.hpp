@@ -0,0 +1,80 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#pragma once
+#include <inttypes.h>
+#include <stdexcept>
+#include <vector>
+
+namespace ipc {
+// LEB128 style variable length integers used by the v2 wire format.
+namespace varint {
+inline size_t size(uint64_t value)
+{
+	size_t length = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		length++;
+	}
+	return length;
+}
+
+inline size_t write(std::vector<char> &buf, size_t offset, uint64_t value)
+{
+	size_t noffset = offset;
+	while (value >= 0x80) {
+		buf[noffset++] = char(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	buf[noffset++] = char(uint8_t(value));
+	return noffset - offset;
+}
+
+inline size_t read(const std::vector<char> &buf, size_t offset, uint64_t &value)
+{
+	// Most lengths, counts and ids fit in a single byte.
+	if ((offset < buf.size()) && ((uint8_t(buf[offset]) & 0x80) == 0)) {
+		value = uint8_t(buf[offset]);
+		return 1;
+	}
+
+	value = 0;
+	for (size_t idx = 0; idx < 10; idx++) {
+		if (offset + idx >= buf.size()) {
+			throw std::runtime_error("Varint truncated");
+		}
+		uint8_t byte = uint8_t(buf[offset + idx]);
+		value |= uint64_t(byte & 0x7F) << (7 * idx);
+		if ((byte & 0x80) == 0) {
+			return idx + 1;
+		}
+	}
+	throw std::runtime_error("Varint too long");
+}
+
+// Maps signed integers to unsigned ones so that small magnitudes stay short.
+inline uint64_t zigzag(int64_t value)
+{
+	return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value)
+{
+	return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+} // namespace varint
+} // namespace ipc
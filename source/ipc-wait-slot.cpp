@@ -0,0 +1,124 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#include "ipc-wait-slot.hpp"
+#include <thread>
+
+#ifdef WIN32
+#include <windows.h>
+#elif __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Roughly a few microseconds, about the time a reply takes on a local socket.
+#define WAIT_SLOT_SPINS 2000
+
+ipc::wait_slot &ipc::wait_slot::local()
+{
+	static thread_local wait_slot slot;
+	return slot;
+}
+
+void ipc::wait_slot::signal()
+{
+	if (m_word.exchange(signalled) == parked) {
+		wake();
+	}
+}
+
+bool ipc::wait_slot::wait(std::chrono::nanoseconds timeout)
+{
+	auto end = std::chrono::steady_clock::now() + timeout;
+
+	// Spinning only helps if the signalling thread can run meanwhile.
+	static const size_t spins = (std::thread::hardware_concurrency() > 1) ? WAIT_SLOT_SPINS : 0;
+	for (size_t spin = 0; spin < spins; spin++) {
+		if (m_word.load(std::memory_order_relaxed) == signalled) {
+			break;
+		}
+		if (spin > spins / 2) {
+			std::this_thread::yield();
+		}
+	}
+
+	while (true) {
+		uint32_t word = idle;
+		if (m_word.compare_exchange_strong(word, parked)) {
+			word = parked;
+		}
+		if (word == signalled) {
+			m_word.store(idle);
+			return true;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (now >= end) {
+			// Leave the word as it was unless a signal came in meanwhile.
+			word = parked;
+			m_word.compare_exchange_strong(word, idle);
+			if (word == signalled) {
+				m_word.store(idle);
+				return true;
+			}
+			return false;
+		}
+		park(end - now);
+	}
+}
+
+#ifdef WIN32
+bool ipc::wait_slot::park(std::chrono::nanoseconds timeout)
+{
+	uint32_t compare = parked;
+	DWORD ms = DWORD(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count()) + 1;
+	return WaitOnAddress(&m_word, &compare, sizeof(compare), ms) != FALSE;
+}
+
+void ipc::wait_slot::wake()
+{
+	WakeByAddressSingle(&m_word);
+}
+#elif __APPLE__
+bool ipc::wait_slot::park(std::chrono::nanoseconds timeout)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_cv.wait_for(ul, timeout, [this]() { return m_word.load() != parked; });
+}
+
+void ipc::wait_slot::wake()
+{
+	// Taking the lock orders the wakeup after the waiter's check.
+	std::unique_lock<std::mutex> ul(m_lock);
+	m_cv.notify_one();
+}
+#elif __linux__
+bool ipc::wait_slot::park(std::chrono::nanoseconds timeout)
+{
+	struct timespec ts;
+	ts.tv_sec = time_t(std::chrono::duration_cast<std::chrono::seconds>(timeout).count());
+	ts.tv_nsec = long((timeout - std::chrono::seconds(ts.tv_sec)).count());
+	return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_word), FUTEX_WAIT_PRIVATE, parked, &ts, nullptr, 0) == 0;
+}
+
+void ipc::wait_slot::wake()
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+#endif
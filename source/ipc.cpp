@@ -19,6 +19,9 @@
 #include "ipc.hpp"
 #include <sstream>
 #include <iostream>
+#include <stdexcept>
+#include "ipc-varint.hpp"
+#include "ipc-buffer-pool.hpp"
 
 using namespace ipc;
 
@@ -131,18 +134,22 @@ size_t ipc::message::function_call::size()
 	for (ipc::value &v : arguments) {
 		size += v.size();
 	}
+	if (deadline != 0) {
+		size += sizeof(uint64_t);
+	}
 	// std::cout << "function_call::size " << size << std::endl;
 	return size;
 }
 
 size_t ipc::message::function_call::serialize(std::vector<char> &buf, size_t offset)
 {
-	if ((buf.size() - offset) < size()) {
+	size_t full_size = size();
+	if ((buf.size() - offset) < full_size) {
 		throw std::exception((const std::exception &)"Buffer too small");
 	}
 	size_t noffset = offset;
 
-	reinterpret_cast<size_t &>(buf[noffset]) = size();
+	reinterpret_cast<size_t &>(buf[noffset]) = full_size;
 	// std::cout << "size serialized call: " << size() << std::endl;
 	noffset += sizeof(size_t);
 
@@ -156,6 +163,10 @@ size_t ipc::message::function_call::serialize(std::vector<char> &buf, size_t off
 	for (ipc::value &v : arguments) {
 		noffset += v.serialize(buf, noffset);
 	}
+	if (deadline != 0) {
+		memcpy(&buf[noffset], &deadline, sizeof(uint64_t));
+		noffset += sizeof(uint64_t);
+	}
 
 	return noffset - offset;
 }
@@ -185,6 +196,153 @@ size_t ipc::message::function_call::deserialize(std::vector<char> &buf, size_t o
 	for (size_t idx = 0; idx < cnt; idx++) {
 		noffset += this->arguments[idx].deserialize(buf, noffset);
 	}
+	this->deadline = 0;
+	if (noffset + sizeof(uint64_t) <= offset + size) {
+		memcpy(&this->deadline, &buf[noffset], sizeof(uint64_t));
+		noffset += sizeof(uint64_t);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_call_view::deserialize(const std::vector<char> &buf, size_t offset)
+{
+	if ((buf.size() - offset) < sizeof(size_t)) {
+		abort();
+	}
+
+	size_t size = reinterpret_cast<const size_t &>(buf[offset]);
+	if ((buf.size() - offset) < size) {
+		abort();
+	}
+	size_t noffset = offset + sizeof(size_t);
+	noffset += uid.deserialize(buf, noffset);
+	noffset += class_name.deserialize(buf, noffset);
+	noffset += function_name.deserialize(buf, noffset);
+
+	uint32_t cnt = reinterpret_cast<const uint32_t &>(buf[noffset]);
+	noffset += sizeof(uint32_t);
+	this->arguments.resize(cnt);
+	for (size_t idx = 0; idx < cnt; idx++) {
+		noffset += this->arguments[idx].deserialize(buf, noffset);
+	}
+	this->deadline = 0;
+	if (noffset + sizeof(uint64_t) <= offset + size) {
+		memcpy(&this->deadline, &buf[noffset], sizeof(uint64_t));
+		noffset += sizeof(uint64_t);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_call::size_v2()
+{
+	size_t size = ipc::varint::size(uid.value_union.ui64) + class_name.size_v2() + function_name.size_v2() + ipc::varint::size(arguments.size());
+	for (ipc::value &v : arguments) {
+		size += v.size_v2();
+	}
+	if (deadline != 0) {
+		size += ipc::varint::size(deadline);
+	}
+	return size;
+}
+
+size_t ipc::message::function_call::serialize_v2(std::vector<char> &buf, size_t offset)
+{
+	if ((buf.size() - offset) < size_v2()) {
+		throw std::runtime_error("Buffer too small");
+	}
+	size_t noffset = offset;
+
+	noffset += ipc::varint::write(buf, noffset, uid.value_union.ui64);
+	noffset += class_name.serialize_v2(buf, noffset);
+	noffset += function_name.serialize_v2(buf, noffset);
+	noffset += ipc::varint::write(buf, noffset, arguments.size());
+	for (ipc::value &v : arguments) {
+		noffset += v.serialize_v2(buf, noffset);
+	}
+	if (deadline != 0) {
+		noffset += ipc::varint::write(buf, noffset, deadline);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_call_view::deserialize_v2(const std::vector<char> &buf, size_t offset, size_t length)
+{
+	size_t end = (length > buf.size() - offset) ? buf.size() : offset + length;
+	size_t noffset = offset;
+	uint64_t number;
+
+	noffset += ipc::varint::read(buf, noffset, number);
+	uid.type = ipc::type::UInt64;
+	uid.value_union.ui64 = number;
+	noffset += class_name.deserialize_v2(buf, noffset);
+	noffset += function_name.deserialize_v2(buf, noffset);
+
+	noffset += ipc::varint::read(buf, noffset, number);
+	if (number > (buf.size() - noffset)) {
+		// Every argument takes at least one byte.
+		throw std::runtime_error("Argument count exceeds message");
+	}
+	this->arguments.resize(size_t(number));
+	for (ipc::value_view &v : arguments) {
+		noffset += v.deserialize_v2(buf, noffset);
+	}
+	this->deadline = 0;
+	if (noffset < end) {
+		noffset += ipc::varint::read(buf, noffset, this->deadline);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_reply::size_v2()
+{
+	size_t size = ipc::varint::size(uid.value_union.ui64) + error.size_v2() + ipc::varint::size(values.size());
+	for (ipc::value &v : values) {
+		size += v.size_v2();
+	}
+	return size;
+}
+
+size_t ipc::message::function_reply::serialize_v2(std::vector<char> &buf, size_t offset)
+{
+	if ((buf.size() - offset) < size_v2()) {
+		throw std::runtime_error("Buffer too small");
+	}
+	size_t noffset = offset;
+
+	noffset += ipc::varint::write(buf, noffset, uid.value_union.ui64);
+	noffset += error.serialize_v2(buf, noffset);
+	noffset += ipc::varint::write(buf, noffset, values.size());
+	for (ipc::value &v : values) {
+		noffset += v.serialize_v2(buf, noffset);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_reply::deserialize_v2(std::vector<char> &buf, size_t offset)
+{
+	size_t noffset = offset;
+	uint64_t number;
+	ipc::value_view view;
+
+	noffset += ipc::varint::read(buf, noffset, number);
+	uid = ipc::value(number);
+	noffset += view.deserialize_v2(buf, noffset);
+	error = view.to_value();
+
+	noffset += ipc::varint::read(buf, noffset, number);
+	if (number > (buf.size() - noffset)) {
+		throw std::runtime_error("Value count exceeds message");
+	}
+	this->values.resize(size_t(number));
+	for (ipc::value &v : values) {
+		noffset += view.deserialize_v2(buf, noffset);
+		v = view.to_value();
+	}
 
 	return noffset - offset;
 }
@@ -203,12 +361,13 @@ size_t ipc::message::function_reply::size()
 
 size_t ipc::message::function_reply::serialize(std::vector<char> &buf, size_t offset)
 {
-	if ((buf.size() - offset) < size()) {
+	size_t full_size = size();
+	if ((buf.size() - offset) < full_size) {
 		throw std::exception((const std::exception &)"Buffer too small");
 	}
 	size_t noffset = offset;
 
-	reinterpret_cast<size_t &>(buf[noffset]) = size();
+	reinterpret_cast<size_t &>(buf[noffset]) = full_size;
 
 	noffset += sizeof(size_t);
 
@@ -249,3 +408,371 @@ size_t ipc::message::function_reply::deserialize(std::vector<char> &buf, size_t
 
 	return noffset - offset;
 }
+
+void ipc::message::function_call::serialize(gather &out, uint8_t version)
+{
+	size_t full_size = (version == ipc::wire_v2) ? size_v2() : size();
+	size_t head_size = full_size;
+	for (ipc::value &v : arguments) {
+		head_size -= gather::reference(v).size();
+	}
+	out.head = ipc::buffer_pool::acquire(sizeof(ipc_size_t) + head_size);
+	out.references.clear();
+	size_t noffset = sizeof(ipc_size_t);
+
+	if (version == ipc::wire_v2) {
+		noffset += ipc::varint::write(out.head, noffset, uid.value_union.ui64);
+		noffset += class_name.serialize_v2(out.head, noffset);
+		noffset += function_name.serialize_v2(out.head, noffset);
+		noffset += ipc::varint::write(out.head, noffset, arguments.size());
+	} else {
+		// The inner length counts the referenced bytes as well.
+		reinterpret_cast<size_t &>(out.head[noffset]) = full_size;
+		noffset += sizeof(size_t);
+		noffset += uid.serialize(out.head, noffset);
+		noffset += class_name.serialize(out.head, noffset);
+		noffset += function_name.serialize(out.head, noffset);
+		reinterpret_cast<uint32_t &>(out.head[noffset]) = (uint32_t)arguments.size();
+		noffset += sizeof(uint32_t);
+	}
+	for (ipc::value &v : arguments) {
+		noffset += out.append(v, noffset, version);
+	}
+	if (deadline == 0) {
+		return;
+	}
+	if (version == ipc::wire_v2) {
+		ipc::varint::write(out.head, noffset, deadline);
+	} else {
+		memcpy(&out.head[noffset], &deadline, sizeof(uint64_t));
+	}
+}
+
+void ipc::message::function_reply::serialize(gather &out, uint8_t version)
+{
+	size_t full_size = (version == ipc::wire_v2) ? size_v2() : size();
+	size_t head_size = full_size;
+	for (ipc::value &v : values) {
+		head_size -= gather::reference(v).size();
+	}
+	out.head = ipc::buffer_pool::acquire(sizeof(ipc_size_t) + head_size);
+	out.references.clear();
+	size_t noffset = sizeof(ipc_size_t);
+
+	if (version == ipc::wire_v2) {
+		noffset += ipc::varint::write(out.head, noffset, uid.value_union.ui64);
+		noffset += error.serialize_v2(out.head, noffset);
+		noffset += ipc::varint::write(out.head, noffset, values.size());
+	} else {
+		reinterpret_cast<size_t &>(out.head[noffset]) = full_size;
+		noffset += sizeof(size_t);
+		noffset += uid.serialize(out.head, noffset);
+		noffset += error.serialize(out.head, noffset);
+		reinterpret_cast<uint32_t &>(out.head[noffset]) = (uint32_t)values.size();
+		noffset += sizeof(uint32_t);
+	}
+	for (ipc::value &v : values) {
+		noffset += out.append(v, noffset, version);
+	}
+}
+
+ipc::span<const char> ipc::message::gather::reference(const ipc::value &value)
+{
+	if ((value.type == ipc::type::String) && (value.value_str.size() >= reference_size)) {
+		return ipc::span<const char>(value.value_str.data(), value.value_str.size());
+	} else if ((value.type == ipc::type::Binary) && (value.value_bin().size() >= reference_size)) {
+		return ipc::span<const char>(value.value_bin().data(), value.value_bin().size());
+	}
+	return ipc::span<const char>();
+}
+
+size_t ipc::message::gather::append(ipc::value &value, size_t offset, uint8_t version)
+{
+	ipc::span<const char> storage = reference(value);
+	if (storage.empty()) {
+		return (version == ipc::wire_v2) ? value.serialize_v2(head, offset) : value.serialize(head, offset);
+	}
+
+	// Same prefix as value::serialize() and value::serialize_v2() write.
+	size_t noffset = offset;
+	if (version == ipc::wire_v2) {
+		head[noffset++] = char(value.type);
+		noffset += ipc::varint::write(head, noffset, storage.size());
+	} else {
+		reinterpret_cast<uint32_t &>(head[noffset]) = (uint32_t)value.type;
+		noffset += sizeof(uint32_t);
+		reinterpret_cast<uint32_t &>(head[noffset]) = static_cast<uint32_t>(storage.size());
+		noffset += sizeof(uint32_t);
+	}
+	references.push_back(std::make_pair(noffset, storage));
+	return noffset - offset;
+}
+
+size_t ipc::message::gather::size() const
+{
+	size_t size = head.size();
+	for (auto &ref : references) {
+		size += ref.second.size();
+	}
+	return size;
+}
+
+std::vector<ipc::span<const char>> ipc::message::gather::parts() const
+{
+	std::vector<ipc::span<const char>> parts;
+	parts.reserve(references.size() * 2 + 1);
+	size_t offset = 0;
+	for (auto &ref : references) {
+		if (ref.first > offset) {
+			parts.push_back(ipc::span<const char>(head.data() + offset, ref.first - offset));
+		}
+		parts.push_back(ref.second);
+		offset = ref.first;
+	}
+	if (head.size() > offset) {
+		parts.push_back(ipc::span<const char>(head.data() + offset, head.size() - offset));
+	}
+	return parts;
+}
+
+void ipc::message::gather::make_sendable(uint8_t version, uint8_t kind)
+{
+	ipc::make_sendable(head, version, kind);
+	reinterpret_cast<ipc_size_real_t &>(head[sizeof(ipc_size_real_t)]) = ipc_size_real_t(size() - sizeof(ipc_size_t));
+}
+
+size_t ipc::message::function_call_batch::size(uint8_t version)
+{
+	size_t size = ipc::varint::size(uid) + ipc::varint::size(calls.size());
+	for (function_call &call : calls) {
+		size_t length = (version == ipc::wire_v2) ? call.size_v2() : call.size();
+		size += ipc::varint::size(length) + length;
+	}
+	return size;
+}
+
+size_t ipc::message::function_call_batch::serialize(std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	if ((buf.size() - offset) < size(version)) {
+		throw std::runtime_error("Buffer too small");
+	}
+	size_t noffset = offset;
+
+	noffset += ipc::varint::write(buf, noffset, uid);
+	noffset += ipc::varint::write(buf, noffset, calls.size());
+	for (function_call &call : calls) {
+		if (version == ipc::wire_v2) {
+			noffset += ipc::varint::write(buf, noffset, call.size_v2());
+			noffset += call.serialize_v2(buf, noffset);
+		} else {
+			noffset += ipc::varint::write(buf, noffset, call.size());
+			noffset += call.serialize(buf, noffset);
+		}
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_call_batch_view::deserialize(const std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	size_t noffset = offset;
+	uint64_t number;
+
+	noffset += ipc::varint::read(buf, noffset, uid);
+	noffset += ipc::varint::read(buf, noffset, number);
+	if (number > (buf.size() - noffset)) {
+		throw std::runtime_error("Call count exceeds message");
+	}
+	calls.resize(size_t(number));
+	for (function_call_view &call : calls) {
+		noffset += ipc::varint::read(buf, noffset, number);
+		if (number > (buf.size() - noffset)) {
+			throw std::runtime_error("Call exceeds message");
+		}
+		if (version == ipc::wire_v2) {
+			call.deserialize_v2(buf, noffset, size_t(number));
+		} else {
+			call.deserialize(buf, noffset);
+		}
+		noffset += size_t(number);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_reply_batch::size(uint8_t version)
+{
+	size_t size = ipc::varint::size(uid) + ipc::varint::size(replies.size());
+	for (function_reply &reply : replies) {
+		size_t length = (version == ipc::wire_v2) ? reply.size_v2() : reply.size();
+		size += ipc::varint::size(length) + length;
+	}
+	return size;
+}
+
+size_t ipc::message::function_reply_batch::serialize(std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	if ((buf.size() - offset) < size(version)) {
+		throw std::runtime_error("Buffer too small");
+	}
+	size_t noffset = offset;
+
+	noffset += ipc::varint::write(buf, noffset, uid);
+	noffset += ipc::varint::write(buf, noffset, replies.size());
+	for (function_reply &reply : replies) {
+		if (version == ipc::wire_v2) {
+			noffset += ipc::varint::write(buf, noffset, reply.size_v2());
+			noffset += reply.serialize_v2(buf, noffset);
+		} else {
+			noffset += ipc::varint::write(buf, noffset, reply.size());
+			noffset += reply.serialize(buf, noffset);
+		}
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::function_reply_batch::deserialize(std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	size_t noffset = offset;
+	uint64_t number;
+
+	noffset += ipc::varint::read(buf, noffset, uid);
+	noffset += ipc::varint::read(buf, noffset, number);
+	if (number > (buf.size() - noffset)) {
+		throw std::runtime_error("Reply count exceeds message");
+	}
+	replies.resize(size_t(number));
+	for (function_reply &reply : replies) {
+		noffset += ipc::varint::read(buf, noffset, number);
+		if (number > (buf.size() - noffset)) {
+			throw std::runtime_error("Reply exceeds message");
+		}
+		if (version == ipc::wire_v2) {
+			reply.deserialize_v2(buf, noffset);
+		} else {
+			reply.deserialize(buf, noffset);
+		}
+		noffset += size_t(number);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::event::size(uint8_t version)
+{
+	size_t size;
+	if (version == ipc::wire_v2) {
+		size = topic.size_v2() + ipc::varint::size(values.size());
+		for (ipc::value &v : values) {
+			size += v.size_v2();
+		}
+	} else {
+		size = topic.size() + sizeof(uint32_t);
+		for (ipc::value &v : values) {
+			size += v.size();
+		}
+	}
+	return size;
+}
+
+size_t ipc::message::event::serialize(std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	if ((buf.size() - offset) < size(version)) {
+		throw std::runtime_error("Buffer too small");
+	}
+	size_t noffset = offset;
+
+	if (version == ipc::wire_v2) {
+		noffset += topic.serialize_v2(buf, noffset);
+		noffset += ipc::varint::write(buf, noffset, values.size());
+		for (ipc::value &v : values) {
+			noffset += v.serialize_v2(buf, noffset);
+		}
+	} else {
+		noffset += topic.serialize(buf, noffset);
+		reinterpret_cast<uint32_t &>(buf[noffset]) = (uint32_t)values.size();
+		noffset += sizeof(uint32_t);
+		for (ipc::value &v : values) {
+			noffset += v.serialize(buf, noffset);
+		}
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::event::deserialize(std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	size_t noffset = offset;
+
+	if (version == ipc::wire_v2) {
+		uint64_t number;
+		ipc::value_view view;
+
+		noffset += view.deserialize_v2(buf, noffset);
+		topic = view.to_value();
+		noffset += ipc::varint::read(buf, noffset, number);
+		if (number > (buf.size() - noffset)) {
+			throw std::runtime_error("Value count exceeds message");
+		}
+		values.resize(size_t(number));
+		for (ipc::value &v : values) {
+			noffset += view.deserialize_v2(buf, noffset);
+			v = view.to_value();
+		}
+	} else {
+		noffset += topic.deserialize(buf, noffset);
+		if ((buf.size() - noffset) < sizeof(uint32_t)) {
+			throw std::runtime_error("Buffer too small");
+		}
+		uint32_t cnt = reinterpret_cast<uint32_t &>(buf[noffset]);
+		noffset += sizeof(uint32_t);
+		values.resize(cnt);
+		for (ipc::value &v : values) {
+			noffset += v.deserialize(buf, noffset);
+		}
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::event_batch::size(uint8_t version)
+{
+	size_t size = ipc::varint::size(events.size());
+	for (event &e : events) {
+		size += e.size(version);
+	}
+	return size;
+}
+
+size_t ipc::message::event_batch::serialize(std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	if ((buf.size() - offset) < size(version)) {
+		throw std::runtime_error("Buffer too small");
+	}
+	size_t noffset = offset;
+
+	noffset += ipc::varint::write(buf, noffset, events.size());
+	for (event &e : events) {
+		noffset += e.serialize(buf, noffset, version);
+	}
+
+	return noffset - offset;
+}
+
+size_t ipc::message::event_batch::deserialize(std::vector<char> &buf, size_t offset, uint8_t version)
+{
+	size_t noffset = offset;
+	uint64_t number;
+
+	noffset += ipc::varint::read(buf, noffset, number);
+	if (number > (buf.size() - noffset)) {
+		throw std::runtime_error("Event count exceeds message");
+	}
+	events.resize(size_t(number));
+	for (event &e : events) {
+		noffset += e.deserialize(buf, noffset, version);
+	}
+
+	return noffset - offset;
+}
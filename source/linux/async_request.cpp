@@ -0,0 +1,144 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "async_request.hpp"
+#include "ipc-socket-linux.hpp"
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+void os::linux::async_request::set_valid(bool valid)
+{
+	std::unique_lock<std::mutex> ul(lock);
+	this->valid = valid;
+	this->complete = false;
+	this->generation++;
+	this->callback_called = false;
+	this->system.callback_called = false;
+	if (event >= 0) {
+		uint64_t value;
+		while (::read(event, &value, sizeof(value)) > 0) {
+		}
+	}
+}
+
+void os::linux::async_request::finish(os::error ec, size_t length)
+{
+	uint64_t current;
+	{
+		std::unique_lock<std::mutex> ul(lock);
+		current = generation;
+	}
+
+	call_callback(ec, length);
+
+	std::unique_lock<std::mutex> ul(lock);
+	if (current != generation) {
+		// The callback already reused this request for the next operation.
+		return;
+	}
+	complete = true;
+	if (event >= 0) {
+		uint64_t one = 1;
+		if (::write(event, &one, sizeof(one)) < 0) {
+			// The counter can't overflow with a single signal per completion.
+		}
+	}
+}
+
+void os::linux::async_request::abandon(os::error ec)
+{
+	callback_called = true;
+	system.callback_called = true;
+	finish(ec, 0);
+}
+
+void *os::linux::async_request::get_waitable()
+{
+	std::unique_lock<std::mutex> ul(lock);
+	if (event < 0) {
+		event = eventfd(complete ? 1 : 0, EFD_CLOEXEC | EFD_NONBLOCK);
+	}
+	return reinterpret_cast<void *>(intptr_t(event));
+}
+
+os::linux::async_request::~async_request()
+{
+	if (os::linux::async_request::is_valid()) {
+		os::linux::async_request::cancel();
+	}
+	if (event >= 0) {
+		close(event);
+	}
+}
+
+bool os::linux::async_request::is_valid()
+{
+	return this->valid;
+}
+
+void os::linux::async_request::invalidate()
+{
+	valid = false;
+	callback_called = true;
+}
+
+bool os::linux::async_request::is_complete()
+{
+	if (!is_valid()) {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> ul(lock);
+	return complete;
+}
+
+bool os::linux::async_request::cancel()
+{
+	if (!is_valid()) {
+		return false;
+	}
+
+	if (!is_complete()) {
+		std::shared_ptr<os::linux::socket_linux> socket = owner.lock();
+		if (socket) {
+			return socket->cancel(this);
+		}
+	}
+	return true;
+}
+
+void os::linux::async_request::call_callback()
+{
+	// Callbacks are called by the socket as soon as the operation finishes,
+	// there is no deferred result to collect here.
+}
+
+void os::linux::async_request::call_callback(os::error ec, size_t length)
+{
+	if (system.callback && !system.callback_called) {
+		system.callback_called = true;
+		auto runned_callback = system.callback;
+		runned_callback(ec, length);
+	}
+	if (callback && !callback_called) {
+		callback_called = true;
+		auto runned_callback = callback;
+		runned_callback(ec, length);
+	}
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OS_LINUX_ASYNC_REQUEST_HPP
+#define OS_LINUX_ASYNC_REQUEST_HPP
+
+#include <memory>
+#include <mutex>
+#include "async_op.hpp"
+
+namespace os {
+namespace linux {
+class socket_linux;
+
+class async_request : public os::async_op {
+	std::mutex lock;
+	// Created on demand by get_waitable(), so that operations which are
+	// never waited on do not cost an eventfd.
+	int event = -1;
+	bool complete = false;
+	// Bumped whenever the request is reused, see finish().
+	uint64_t generation = 0;
+	std::weak_ptr<os::linux::socket_linux> owner;
+
+public:
+	void set_valid(bool valid);
+
+	// Mark the operation as complete, run the callbacks and wake up waiters.
+	void finish(os::error ec, size_t length);
+
+	// Same as finish(), but without running the callbacks.
+	void abandon(os::error ec);
+
+public:
+	virtual ~async_request();
+
+	virtual bool is_valid() override;
+
+	virtual void invalidate() override;
+
+	virtual bool is_complete() override;
+
+	virtual bool cancel() override;
+
+	virtual void call_callback() override;
+
+	virtual void call_callback(os::error ec, size_t length) override;
+
+	// os::waitable
+	virtual void *get_waitable() override;
+
+public:
+	friend class os::linux::socket_linux;
+	friend class os::waitable;
+};
+} // namespace linux
+} // namespace os
+
+#endif // OS_LINUX_ASYNC_REQUEST_HPP
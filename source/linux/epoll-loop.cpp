@@ -0,0 +1,162 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "epoll-loop.hpp"
+#include <errno.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+os::linux::epoll_loop &os::linux::epoll_loop::get()
+{
+	// Intentionally never destroyed: sockets may still be released from
+	// static destructors or from the loop thread itself during exit.
+	static epoll_loop *loop = new epoll_loop();
+	return *loop;
+}
+
+os::linux::epoll_loop::epoll_loop()
+{
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll < 0) {
+		throw std::runtime_error("Creating epoll instance failed with error " + std::to_string(errno) + ".");
+	}
+
+	m_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_wake < 0) {
+		close(m_epoll);
+		throw std::runtime_error("Creating epoll wake event failed with error " + std::to_string(errno) + ".");
+	}
+
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.u64 = wake_token;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev);
+
+	m_worker = std::thread(std::bind(&os::linux::epoll_loop::worker, this));
+}
+
+os::linux::epoll_loop::~epoll_loop()
+{
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		m_stop = true;
+	}
+	uint64_t one = 1;
+	if (::write(m_wake, &one, sizeof(one)) < 0) {
+		// Nothing we can do here, the worker will still see m_stop eventually.
+	}
+	if (m_worker.joinable()) {
+		if (is_loop_thread()) {
+			m_worker.detach();
+		} else {
+			m_worker.join();
+		}
+	}
+
+	close(m_wake);
+	close(m_epoll);
+}
+
+os::error os::linux::epoll_loop::add(int fd, uint32_t events, handler_t handler)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+
+	epoll_event ev = {};
+	ev.events = events;
+	ev.data.u64 = ++m_last_token;
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		return os::error::Error;
+	}
+
+	auto previous = m_tokens.find(fd);
+	if (previous != m_tokens.end()) {
+		m_handlers.erase(previous->second);
+	}
+	m_tokens[fd] = ev.data.u64;
+	m_handlers.insert_or_assign(ev.data.u64, std::make_shared<handler_t>(std::move(handler)));
+	return os::error::Success;
+}
+
+os::error os::linux::epoll_loop::remove(int fd)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+
+	auto kv = m_tokens.find(fd);
+	if (kv != m_tokens.end()) {
+		m_handlers.erase(kv->second);
+		m_tokens.erase(kv);
+	}
+	if (epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr) < 0) {
+		return os::error::Error;
+	}
+	return os::error::Success;
+}
+
+bool os::linux::epoll_loop::is_loop_thread()
+{
+	return std::this_thread::get_id() == m_worker.get_id();
+}
+
+void os::linux::epoll_loop::worker()
+{
+	std::vector<epoll_event> events(64);
+
+	while (true) {
+		int count = epoll_wait(m_epoll, events.data(), int(events.size()), -1);
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		for (int idx = 0; idx < count; idx++) {
+			uint64_t token = events[idx].data.u64;
+			if (token == wake_token) {
+				uint64_t value;
+				while (::read(m_wake, &value, sizeof(value)) > 0) {
+				}
+				continue;
+			}
+
+			// Copy the handler so that it stays alive even if the descriptor
+			// gets removed while the handler is running. Events of a
+			// registration removed earlier in this batch find no handler,
+			// even if the descriptor number was reused since.
+			std::shared_ptr<handler_t> handler;
+			{
+				std::unique_lock<std::mutex> ul(m_lock);
+				auto kv = m_handlers.find(token);
+				if (kv == m_handlers.end()) {
+					continue;
+				}
+				handler = kv->second;
+			}
+			(*handler)(events[idx].events);
+		}
+
+		std::unique_lock<std::mutex> ul(m_lock);
+		if (m_stop) {
+			break;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OS_LINUX_EPOLL_LOOP_HPP
+#define OS_LINUX_EPOLL_LOOP_HPP
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "error.hpp"
+
+namespace os {
+namespace linux {
+class epoll_loop {
+public:
+	typedef std::function<void(uint32_t events)> handler_t;
+
+	/** Process-wide loop shared by every socket.
+	 *
+	 * The loop is started on first use and runs until the process exits.
+	 * It blocks in epoll_wait() while idle, so it does not wake up unless
+	 * one of the registered descriptors becomes ready.
+	 */
+	static epoll_loop &get();
+
+	epoll_loop();
+	~epoll_loop();
+
+	/** Register a descriptor.
+	 *
+	 * The handler is called on the loop thread with the epoll event mask.
+	 * Handlers must not block for long, as every descriptor shares the thread.
+	 */
+	os::error add(int fd, uint32_t events, handler_t handler);
+
+	/** Unregister a descriptor. Must be called before the descriptor is closed. */
+	os::error remove(int fd);
+
+	bool is_loop_thread();
+
+private:
+	int m_epoll = -1;
+	int m_wake = -1;
+	bool m_stop = false;
+	std::thread m_worker;
+
+	// Handlers by registration token, which epoll hands back with every
+	// event. Tokens are never reused, unlike descriptor numbers.
+	static const uint64_t wake_token = 0;
+	std::mutex m_lock;
+	uint64_t m_last_token = wake_token;
+	std::map<int, uint64_t> m_tokens;
+	std::map<uint64_t, std::shared_ptr<handler_t>> m_handlers;
+
+	void worker();
+};
+} // namespace linux
+} // namespace os
+
+#endif // OS_LINUX_EPOLL_LOOP_HPP
@@ -0,0 +1,860 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "ipc-client-linux.hpp"
+#include "../include/ipc-buffer-pool.hpp"
+#include "../include/ipc-wait-slot.hpp"
+#include "../ipc-varint.hpp"
+
+call_return_t g_fn = NULL;
+void *g_data = NULL;
+int64_t g_cbid = 0;
+
+using namespace std::placeholders;
+
+// Calls and batches share one uid space, so a reply can never be taken for
+// the wrong one.
+static uint64_t next_uid()
+{
+	static std::mutex mtx;
+	static uint64_t timestamp = 0;
+	std::unique_lock<std::mutex> ulock(mtx);
+	return ++timestamp;
+}
+
+std::shared_ptr<ipc::client> ipc::client::create(const std::string &socketPath, call_on_disconnect_t disconnectionCallback)
+{
+	return std::make_unique<ipc::client_linux>(socketPath, disconnectionCallback);
+}
+
+std::shared_ptr<ipc::client> ipc::client::create(std::string socketPath)
+{
+	return std::make_unique<ipc::client_linux>(socketPath);
+}
+
+ipc::client_linux::client_linux(const std::string &socketPath, call_on_disconnect_t disconnectionCallback)
+	: m_socketPath(socketPath), m_disconnectionCallback(disconnectionCallback)
+{
+	start();
+}
+
+ipc::client_linux::client_linux(std::string socketPath) : m_socketPath(socketPath)
+{
+	start();
+}
+
+ipc::client_linux::~client_linux()
+{
+	stop();
+	if (m_rbuf.capacity() > 0) {
+		ipc::buffer_pool::release(std::move(m_rbuf));
+	}
+}
+
+void ipc::client_linux::start()
+{
+	if (m_stop.exchange(false)) {
+		m_socket = os::linux::socket_linux::create(os::open_only, m_socketPath);
+		read_header();
+	}
+}
+
+void ipc::client_linux::stop()
+{
+	if (!m_stop.exchange(true)) {
+		m_socket->disconnect();
+		flush_callbacks();
+		m_socket = nullptr;
+	}
+}
+
+bool ipc::client_linux::call(const std::string &cname, const std::string &fname, std::vector<ipc::value> args, call_return_t fn, void *data, int64_t &cbid)
+{
+	return send_call(cname, fname, std::move(args), 0, fn, data, cbid);
+}
+
+bool ipc::client_linux::call_with_deadline(const std::string &cname, const std::string &fname, std::vector<ipc::value> args,
+					   std::chrono::steady_clock::time_point deadline, call_return_t fn, void *data, int64_t &cbid)
+{
+	uint64_t wire_deadline = (m_socket && m_socket->is_deadline_supported()) ? ipc::make_deadline(deadline) : 0;
+	return send_call(cname, fname, std::move(args), wire_deadline, fn, data, cbid);
+}
+
+bool ipc::client_linux::send_call(const std::string &cname, const std::string &fname, std::vector<ipc::value> args, uint64_t deadline, call_return_t fn,
+				  void *data, int64_t &cbid)
+{
+	os::error ec;
+	std::shared_ptr<os::async_op> write_op;
+	ipc::message::function_call fnc_call_msg;
+
+	if (!m_socket)
+		return false;
+
+	// Set
+	int64_t fid = find_function_id(cname, fname);
+
+	// Cached replies are handed out right here, misses put their reply into
+	// the cache on the way to |fn|.
+	cached_call *cached = nullptr;
+	if ((fid >= 0) && (fn != nullptr) && is_cacheable(uint32_t(fid))) {
+		std::string key = ipc::reply_cache::make_key(uint32_t(fid), args);
+		std::vector<ipc::value> rval;
+		if (m_cache.find(key, rval)) {
+			fn(data, rval);
+			return true;
+		}
+		cached = new cached_call{this, std::move(key), uint32_t(fid), m_cache.generation(), fn, data};
+		fn = &cache_callback;
+		data = cached;
+	}
+
+	fnc_call_msg.uid = ipc::value(next_uid());
+	if (fid >= 0) {
+		fnc_call_msg.class_name = ipc::value(uint32_t(fid));
+		fnc_call_msg.function_name = ipc::value();
+	} else {
+		fnc_call_msg.class_name = ipc::value(cname);
+		fnc_call_msg.function_name = ipc::value(fname);
+	}
+	fnc_call_msg.arguments = std::move(args);
+	fnc_call_msg.deadline = deadline;
+
+	// Serialize into a frame owned by the write itself, so that the call
+	// only has to be queued and any number of calls can be in flight. Large
+	// arguments are sent straight from the message, which the write keeps.
+	uint8_t version = m_socket->get_wire_version();
+	auto frame = std::make_shared<gathered_call>();
+	frame->call = std::move(fnc_call_msg);
+	try {
+		frame->call.serialize(frame->out, version);
+	} catch (std::exception &e) {
+		ipc::log("(write) %8llu: Failed to serialize, error %s.", frame->call.uid.value_union.ui64, e.what());
+		throw e;
+	}
+	uint64_t uid = frame->call.uid.value_union.ui64;
+
+	if (fn != nullptr) {
+		std::unique_lock<std::mutex> ulock(m_lock);
+		m_cb.insert(std::make_pair(uid, std::make_pair(fn, data)));
+		cbid = uid;
+	}
+
+	// Replies are matched by uid in read_callback_msg. A failed write also
+	// fails the pending read, which flushes the callbacks. Without a scope
+	// the call is written as normal, whatever lane the server gives it.
+	frame->out.make_sendable(version);
+	const ipc::priority *requested = ipc::priority_scope::current();
+	if (requested) {
+		ipc::set_priority(frame->out.head, *requested);
+	}
+	int lane = int(requested ? *requested : ipc::priority::normal);
+	auto release = [frame](os::error ec, size_t size) { ipc::buffer_pool::release(std::move(frame->out.head)); };
+	if (frame->out.references.empty()) {
+		ec = m_socket->write(frame->out.head.data(), frame->out.head.size(), write_op, release, lane);
+	} else {
+		ec = m_socket->write(frame->out.parts(), write_op, release, lane);
+	}
+	if (ec != os::error::Success && ec != os::error::Pending) {
+		// A write that is refused right away never calls back.
+		if (ec == os::error::Disconnected) {
+			ipc::buffer_pool::release(std::move(frame->out.head));
+		}
+		// Only this call's own callback, cbid may be shared.
+		if (fn != nullptr) {
+			cancel(uid);
+		}
+		return false;
+	}
+
+	return true;
+}
+
+struct resolve_request {
+	ipc::client_linux *client;
+	std::string key;
+};
+
+int64_t ipc::client_linux::find_function_id(const std::string &cname, const std::string &fname)
+{
+	if (cname == IPC_BUILTIN_COLLECTION) {
+		return -1;
+	}
+
+	std::string key = cname + "::" + fname;
+	{
+		std::unique_lock<std::mutex> ulock(m_ids_lock);
+		auto found = m_ids.find(key);
+		if (found != m_ids.end()) {
+			return found->second;
+		}
+		m_ids.insert(std::make_pair(key, -1));
+	}
+
+	// First call to this function: it still goes out by name, while the id
+	// is requested in the background for the calls after it.
+	int64_t cbid = 0;
+	resolve_request *rq = new resolve_request{this, key};
+	if (!call(IPC_BUILTIN_COLLECTION, IPC_RESOLVE_FUNCTION, {ipc::value(cname), ipc::value(fname)}, &resolve_callback, rq, cbid)) {
+		delete rq;
+	}
+	return -1;
+}
+
+void ipc::client_linux::resolve_callback(void *data, const std::vector<ipc::value> &rval)
+{
+	std::unique_ptr<resolve_request> rq(static_cast<resolve_request *>(data));
+
+	// Servers without ids answer with an error, keep using names with those.
+	if (rval.empty() || (rval[0].type != ipc::type::UInt32)) {
+		return;
+	}
+	uint32_t fid = rval[0].value_union.ui32;
+	{
+		std::unique_lock<std::mutex> ulock(rq->client->m_ids_lock);
+		rq->client->m_ids[rq->key] = fid;
+	}
+
+	// Replies of cacheable functions are only kept once the server sends
+	// their invalidation notices, so that none can be missed. This runs on
+	// the reply thread, which can not wait for the subscription.
+	if ((rval.size() == 2) && (rval[1].type == ipc::type::UInt64)) {
+		std::string topic = IPC_INVALIDATE_TOPIC + std::to_string(fid);
+		{
+			std::unique_lock<std::mutex> ulock(rq->client->m_lock);
+			rq->client->m_subscriptions[topic] = std::make_pair(&invalidated, rq->client);
+		}
+		int64_t cbid = 0;
+		std::pair<client_linux *, uint32_t> *sub = new std::pair<client_linux *, uint32_t>(rq->client, fid);
+		if (!rq->client->call(IPC_BUILTIN_COLLECTION, IPC_SUBSCRIBE_FUNCTION, {ipc::value(topic)}, &cache_subscribed, sub, cbid)) {
+			delete sub;
+		}
+	}
+}
+
+bool ipc::client_linux::is_cacheable(uint32_t fid)
+{
+	std::unique_lock<std::mutex> ulock(m_ids_lock);
+	return m_cacheable.count(fid) != 0;
+}
+
+void ipc::client_linux::cache_subscribed(void *data, const std::vector<ipc::value> &rval)
+{
+	std::unique_ptr<std::pair<client_linux *, uint32_t>> sub(static_cast<std::pair<client_linux *, uint32_t> *>(data));
+	if ((rval.size() == 1) && (rval[0].type == ipc::type::String)) {
+		std::unique_lock<std::mutex> ulock(sub->first->m_ids_lock);
+		sub->first->m_cacheable.insert(sub->second);
+	}
+}
+
+void ipc::client_linux::cache_callback(void *data, const std::vector<ipc::value> &rval)
+{
+	std::unique_ptr<cached_call> cached(static_cast<cached_call *>(data));
+
+	// Errors, including a lost connection, are not kept.
+	bool failed = rval.empty() || ((rval[0].type == ipc::type::Null) && !rval[0].value_str.empty());
+	if (!failed) {
+		cached->client->m_cache.insert(std::move(cached->key), cached->fid, rval, cached->generation);
+	}
+	cached->fn(cached->data, rval);
+}
+
+void ipc::client_linux::invalidated(void *data, const std::string &topic, const std::vector<ipc::value> &values)
+{
+	client_linux *self = static_cast<client_linux *>(data);
+	uint32_t fid = uint32_t(std::strtoul(topic.c_str() + strlen(IPC_INVALIDATE_TOPIC), nullptr, 10));
+	self->m_cache.invalidate(fid);
+}
+
+void ipc::client_linux::set_cache_capacity(size_t entries)
+{
+	m_cache.set_capacity(entries);
+}
+
+ipc::reply_cache::statistics ipc::client_linux::cache_statistics()
+{
+	return m_cache.get_statistics();
+}
+
+std::vector<ipc::value> ipc::client_linux::call_synchronous_helper(const std::string &cname, const std::string &fname, const std::vector<ipc::value> &args)
+{
+	return wait_call(cname, fname, args, nullptr);
+}
+
+std::vector<ipc::value> ipc::client_linux::call_synchronous_with_deadline(const std::string &cname, const std::string &fname,
+									  const std::vector<ipc::value> &args, std::chrono::steady_clock::time_point deadline)
+{
+	return wait_call(cname, fname, args, &deadline);
+}
+
+std::vector<ipc::value> ipc::client_linux::wait_call(const std::string &cname, const std::string &fname, const std::vector<ipc::value> &args,
+						     const std::chrono::steady_clock::time_point *deadline)
+{
+	// Set up call reference data.
+	struct CallData {
+		ipc::wait_slot *slot = &ipc::wait_slot::local();
+		std::atomic_bool called = false;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		std::vector<ipc::value> values;
+	} cd;
+
+	auto cb = [](void *data, const std::vector<ipc::value> &rval) {
+		CallData &cd = *static_cast<CallData *>(data);
+
+		// This copies the data off of the reply thread to the main thread.
+		cd.values.reserve(rval.size());
+		std::copy(rval.begin(), rval.end(), std::back_inserter(cd.values));
+
+		// The waiter may return as soon as it sees the flag.
+		ipc::wait_slot *slot = cd.slot;
+		cd.called = true;
+		slot->signal();
+	};
+
+	int64_t cbid = 0;
+	bool success = deadline ? call_with_deadline(cname, fname, std::move(args), *deadline, cb, &cd, cbid) : call(cname, fname, std::move(args), cb, &cd, cbid);
+	if (!success) {
+		return {};
+	}
+
+	static std::chrono::nanoseconds freez_timeout = std::chrono::seconds(1);
+	bool freez_flagged = false;
+	bool expired = false;
+	while (!cd.called) {
+		std::chrono::nanoseconds timeout = freez_timeout;
+		if (deadline) {
+			auto now = std::chrono::steady_clock::now();
+			if (now < *deadline) {
+				timeout = std::min<std::chrono::nanoseconds>(timeout, *deadline - now);
+			} else if (cancel(cbid)) {
+				// The reply, if any, finds no callback anymore.
+				send_cancel(uint64_t(cbid));
+				expired = true;
+				break;
+			}
+			// Otherwise the callback is already running.
+		}
+		if (cd.slot->wait(timeout) || freez_flagged || (std::chrono::high_resolution_clock::now() - cd.start < freez_timeout))
+			continue;
+		freez_flagged = true;
+
+		int t = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - cd.start).count();
+
+		if (freez_cb)
+			freez_cb(true, app_state_path, cname + "::" + fname, t);
+	}
+	if (freez_flagged) {
+		int t = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - cd.start).count();
+		if (freez_cb)
+			freez_cb(false, app_state_path, cname + "::" + fname, t);
+	}
+	if (expired) {
+		std::vector<ipc::value> rval(1);
+		rval[0].value_str = IPC_DEADLINE_EXCEEDED;
+		return rval;
+	}
+	if (!cd.called) {
+		cancel(cbid);
+		return {};
+	}
+	m_metrics.get(cname + "::" + fname).record(std::chrono::high_resolution_clock::now() - cd.start);
+	return std::move(cd.values);
+}
+
+std::vector<std::vector<ipc::value>> ipc::client_linux::call_batch(std::vector<call_spec> calls)
+{
+	if (!m_socket)
+		return {};
+
+	// Servers from before batches get the calls one by one.
+	if (calls.empty() || !m_socket->is_batch_supported()) {
+		return ipc::client::call_batch(std::move(calls));
+	}
+
+	struct BatchData {
+		ipc::wait_slot *slot = &ipc::wait_slot::local();
+		std::atomic_bool called = false;
+		size_t count = 0;
+
+		std::vector<std::vector<ipc::value>> values;
+	} bd;
+	bd.count = calls.size();
+
+	auto cb = [](void *data, std::vector<std::vector<ipc::value>> &rvals) {
+		BatchData &bd = *static_cast<BatchData *>(data);
+
+		if (rvals.size() == bd.count) {
+			std::swap(bd.values, rvals);
+		} else {
+			// Lost the connection, or the server did not answer every call.
+			bd.values.resize(bd.count);
+			for (std::vector<ipc::value> &rval : bd.values) {
+				rval.resize(1);
+				rval[0].type = ipc::type::Null;
+				rval[0].value_str = "Lost IPC Connection";
+			}
+		}
+		ipc::wait_slot *slot = bd.slot;
+		bd.called = true;
+		slot->signal();
+	};
+
+	// Every entry is a regular call, the uid of an entry is its position.
+	ipc::message::function_call_batch batch_msg;
+	batch_msg.uid = next_uid();
+	batch_msg.calls.resize(calls.size());
+	for (size_t idx = 0; idx < calls.size(); idx++) {
+		ipc::message::function_call &fnc_call_msg = batch_msg.calls[idx];
+		fnc_call_msg.uid = ipc::value(uint64_t(idx));
+		int64_t fid = find_function_id(calls[idx].cname, calls[idx].fname);
+		if (fid >= 0) {
+			fnc_call_msg.class_name = ipc::value(uint32_t(fid));
+			fnc_call_msg.function_name = ipc::value();
+		} else {
+			fnc_call_msg.class_name = ipc::value(calls[idx].cname);
+			fnc_call_msg.function_name = ipc::value(calls[idx].fname);
+		}
+		fnc_call_msg.arguments = std::move(calls[idx].args);
+	}
+
+	uint8_t version = m_socket->get_wire_version();
+	std::shared_ptr<std::vector<char>> buf;
+	try {
+		buf = std::make_shared<std::vector<char>>(ipc::buffer_pool::acquire(batch_msg.size(version) + sizeof(ipc_size_t)));
+		batch_msg.serialize(*buf, sizeof(ipc_size_t), version);
+	} catch (std::exception &e) {
+		ipc::log("(write) %8llu: Failed to serialize batch, error %s.", (unsigned long long)batch_msg.uid, e.what());
+		throw e;
+	}
+
+	{
+		std::unique_lock<std::mutex> ulock(m_lock);
+		m_batches.insert(std::make_pair(batch_msg.uid, std::make_pair(batch_return_t(cb), static_cast<void *>(&bd))));
+	}
+
+	std::shared_ptr<os::async_op> write_op;
+	ipc::make_sendable(*buf, version, ipc::frame_batch);
+	const ipc::priority *requested = ipc::priority_scope::current();
+	if (requested) {
+		ipc::set_priority(*buf, *requested);
+	}
+	int lane = int(requested ? *requested : ipc::priority::normal);
+	auto release = [buf](os::error ec, size_t size) { ipc::buffer_pool::release(std::move(*buf)); };
+	os::error ec = m_socket->write(buf->data(), buf->size(), write_op, release, lane);
+	if (ec != os::error::Success && ec != os::error::Pending) {
+		if (ec == os::error::Disconnected) {
+			ipc::buffer_pool::release(std::move(*buf));
+		}
+		std::unique_lock<std::mutex> ulock(m_lock);
+		if (m_batches.erase(batch_msg.uid) != 0) {
+			return {};
+		}
+	}
+
+	while (!bd.called) {
+		bd.slot->wait(std::chrono::seconds(1));
+	}
+	return std::move(bd.values);
+}
+
+bool ipc::client_linux::subscribe(const std::string &topic, event_handler_t fn, void *data)
+{
+	// Registered first, the server may publish before the reply is read.
+	{
+		std::unique_lock<std::mutex> ulock(m_lock);
+		m_subscriptions[topic] = std::make_pair(fn, data);
+	}
+
+	std::vector<ipc::value> rval = call_synchronous_helper(IPC_BUILTIN_COLLECTION, IPC_SUBSCRIBE_FUNCTION, {ipc::value(topic)});
+	if ((rval.size() == 1) && (rval[0].type == ipc::type::String)) {
+		return true;
+	}
+
+	std::unique_lock<std::mutex> ulock(m_lock);
+	m_subscriptions.erase(topic);
+	return false;
+}
+
+bool ipc::client_linux::unsubscribe(const std::string &topic)
+{
+	{
+		std::unique_lock<std::mutex> ulock(m_lock);
+		if (m_subscriptions.erase(topic) == 0) {
+			return false;
+		}
+	}
+
+	std::vector<ipc::value> rval = call_synchronous_helper(IPC_BUILTIN_COLLECTION, IPC_UNSUBSCRIBE_FUNCTION, {ipc::value(topic)});
+	return (rval.size() == 1) && (rval[0].type == ipc::type::String);
+}
+
+std::shared_ptr<ipc::stream_writer> ipc::client_linux::open_stream()
+{
+	if (!m_socket || !m_socket->is_stream_supported()) {
+		return nullptr;
+	}
+
+	// Every chunk is a frame of its own, so calls keep going in between.
+	std::weak_ptr<os::linux::socket_linux> weak = m_socket;
+	auto send = [weak](uint64_t id, const char *data, size_t length, uint8_t flags) {
+		std::shared_ptr<os::linux::socket_linux> socket = weak.lock();
+		if (!socket) {
+			return false;
+		}
+
+		auto buf = std::make_shared<std::vector<char>>(ipc::buffer_pool::acquire(sizeof(ipc_size_t) + ipc::varint::size(id) + 1 + length));
+		size_t offset = sizeof(ipc_size_t);
+		offset += ipc::varint::write(*buf, offset, id);
+		(*buf)[offset++] = char(flags);
+		if (length > 0) {
+			memcpy(buf->data() + offset, data, length);
+		}
+
+		std::shared_ptr<os::async_op> write_op;
+		ipc::make_sendable(*buf, socket->get_wire_version(), ipc::frame_stream);
+		os::error ec = socket->write(buf->data(), buf->size(), write_op, [buf](os::error ec, size_t size) { ipc::buffer_pool::release(std::move(*buf)); });
+		if (ec == os::error::Disconnected) {
+			ipc::buffer_pool::release(std::move(*buf));
+		}
+		return (ec == os::error::Success) || (ec == os::error::Pending);
+	};
+	std::shared_ptr<ipc::stream_writer> writer = std::make_shared<ipc::stream_writer>(next_uid(), send);
+
+	std::unique_lock<std::mutex> ulock(m_lock);
+	for (auto it = m_stream_writers.begin(); it != m_stream_writers.end();) {
+		it = it->second.expired() ? m_stream_writers.erase(it) : std::next(it);
+	}
+	m_stream_writers.insert(std::make_pair(writer->id(), writer));
+	return writer;
+}
+
+void ipc::client::set_freez_callback(call_on_freez_t cb, std::string app_state)
+{
+	freez_cb = cb;
+	app_state_path = app_state;
+}
+
+void ipc::client_linux::read_header()
+{
+	if (m_rbuf.capacity() == 0) {
+		m_rbuf = ipc::buffer_pool::acquire(sizeof(ipc_size_t));
+	}
+	m_rbuf.resize(sizeof(ipc_size_t));
+	os::error ec = m_socket->read(m_rbuf.data(), m_rbuf.size(), m_rop, std::bind(&ipc::client_linux::read_callback_init, this, _1, _2));
+	if (ec != os::error::Pending && ec != os::error::Success && ec != os::error::Disconnected) {
+		ipc::log("Reading reply header failed with error %d.", static_cast<int>(ec));
+	}
+}
+
+void ipc::client_linux::read_callback_init(os::error ec, size_t size)
+{
+	os::error ec2 = os::error::Success;
+
+	m_rop->invalidate();
+
+	if (ec == os::error::Success || ec == os::error::MoreData) {
+		ipc_size_t n_size = read_size(m_rbuf);
+		m_rversion = ipc::read_version(m_rbuf);
+		m_rkind = ipc::read_kind(m_rbuf);
+		if (n_size != 0) {
+			if (n_size > m_rbuf.capacity()) {
+				ipc::buffer_pool::release(std::move(m_rbuf));
+				m_rbuf = ipc::buffer_pool::acquire(n_size);
+			}
+			m_rbuf.resize(n_size);
+			ec2 = m_socket->read(m_rbuf.data(), m_rbuf.size(), m_rop, std::bind(&ipc::client_linux::read_callback_msg, this, _1, _2));
+			if (ec2 != os::error::Pending && ec2 != os::error::Success && ec2 != os::error::Disconnected) {
+				ipc::log("Reading reply failed with error %d.", static_cast<int>(ec2));
+			}
+		} else {
+			read_header();
+		}
+	} else if (ec == os::error::Disconnected) {
+		// Lost the server, call any remaining callbacks.
+		flush_callbacks();
+		if (m_disconnectionCallback) {
+			m_disconnectionCallback();
+		}
+	}
+}
+
+void ipc::client_linux::read_callback_msg(os::error ec, size_t size)
+{
+	std::pair<call_return_t, void *> cb;
+	ipc::message::function_reply fnc_reply_msg;
+
+	m_rop->invalidate();
+
+	if (ec != os::error::Success) {
+		read_callback_init(ec, size);
+		return;
+	}
+
+	if (m_rkind == ipc::frame_batch) {
+		read_batch_reply();
+		return;
+	} else if (m_rkind == ipc::frame_event) {
+		read_events();
+		return;
+	} else if (m_rkind == ipc::frame_credit) {
+		read_credit();
+		return;
+	}
+
+	try {
+		if (m_rversion == ipc::wire_v2) {
+			fnc_reply_msg.deserialize_v2(m_rbuf, 0);
+		} else {
+			fnc_reply_msg.deserialize(m_rbuf, 0);
+		}
+	} catch (std::exception &e) {
+		ipc::log("Deserialize failed with error %s.", e.what());
+		drop_connection();
+		return;
+	}
+	read_header();
+
+	// Find the callback function.
+	{
+		std::unique_lock<std::mutex> ulock(m_lock);
+		auto cb2 = m_cb.find(fnc_reply_msg.uid.value_union.ui64);
+		if (cb2 == m_cb.end()) {
+			return;
+		}
+		cb = cb2->second;
+
+		// Remove cb entry
+		m_cb.erase(cb2);
+	}
+
+	// Decode return values or errors.
+	if (fnc_reply_msg.error.value_str.size() > 0) {
+		fnc_reply_msg.values.resize(1);
+		fnc_reply_msg.values.at(0).type = ipc::type::Null;
+		fnc_reply_msg.values.at(0).value_str = fnc_reply_msg.error.value_str;
+	}
+
+	// Call Callback
+	cb.first(cb.second, fnc_reply_msg.values);
+}
+
+void ipc::client_linux::read_batch_reply()
+{
+	std::pair<batch_return_t, void *> cb;
+	ipc::message::function_reply_batch batch_msg;
+
+	try {
+		batch_msg.deserialize(m_rbuf, 0, m_rversion);
+	} catch (std::exception &e) {
+		ipc::log("Deserialize batch failed with error %s.", e.what());
+		drop_connection();
+		return;
+	}
+	read_header();
+
+	{
+		std::unique_lock<std::mutex> ulock(m_lock);
+		auto cb2 = m_batches.find(batch_msg.uid);
+		if (cb2 == m_batches.end()) {
+			return;
+		}
+		cb = cb2->second;
+		m_batches.erase(cb2);
+	}
+
+	// Same error convention as single replies, per entry.
+	std::vector<std::vector<ipc::value>> rvals(batch_msg.replies.size());
+	for (size_t idx = 0; idx < batch_msg.replies.size(); idx++) {
+		ipc::message::function_reply &fnc_reply_msg = batch_msg.replies[idx];
+		if (fnc_reply_msg.error.value_str.size() > 0) {
+			fnc_reply_msg.values.resize(1);
+			fnc_reply_msg.values.at(0).type = ipc::type::Null;
+			fnc_reply_msg.values.at(0).value_str = fnc_reply_msg.error.value_str;
+		}
+		std::swap(rvals[idx], fnc_reply_msg.values);
+	}
+
+	cb.first(cb.second, rvals);
+}
+
+void ipc::client_linux::read_events()
+{
+	ipc::message::event_batch events_msg;
+
+	try {
+		events_msg.deserialize(m_rbuf, 0, m_rversion);
+	} catch (std::exception &e) {
+		ipc::log("Deserialize events failed with error %s.", e.what());
+		drop_connection();
+		return;
+	}
+	read_header();
+
+	for (ipc::message::event &event : events_msg.events) {
+		std::pair<event_handler_t, void *> handler;
+		{
+			std::unique_lock<std::mutex> ulock(m_lock);
+			auto found = m_subscriptions.find(event.topic.value_str);
+			if (found == m_subscriptions.end()) {
+				continue;
+			}
+			handler = found->second;
+		}
+		handler.first(handler.second, event.topic.value_str, event.values);
+	}
+
+	// Ready for more, see ipc::event_ack.
+	std::shared_ptr<std::vector<char>> buf = std::make_shared<std::vector<char>>(ipc::buffer_pool::acquire(sizeof(ipc_size_t) + 1));
+	(*buf)[sizeof(ipc_size_t)] = char(ipc::event_ack);
+	ipc::make_sendable(*buf, m_rversion, ipc::frame_event);
+	std::shared_ptr<os::async_op> write_op;
+	os::error ec = m_socket->write(buf->data(), buf->size(), write_op, [buf](os::error ec, size_t size) { ipc::buffer_pool::release(std::move(*buf)); });
+	if (ec == os::error::Disconnected) {
+		ipc::buffer_pool::release(std::move(*buf));
+	}
+}
+
+void ipc::client_linux::read_credit()
+{
+	uint64_t id, bytes;
+	try {
+		size_t offset = ipc::varint::read(m_rbuf, 0, id);
+		ipc::varint::read(m_rbuf, offset, bytes);
+	} catch (std::exception &e) {
+		ipc::log("Deserialize credit failed with error %s.", e.what());
+		drop_connection();
+		return;
+	}
+	read_header();
+
+	// No credit at all means the server dropped the stream.
+	std::shared_ptr<ipc::stream_writer> writer;
+	{
+		std::unique_lock<std::mutex> ulock(m_lock);
+		auto found = m_stream_writers.find(id);
+		if (found == m_stream_writers.end()) {
+			return;
+		}
+		writer = found->second.lock();
+		if (!writer || (bytes == 0)) {
+			m_stream_writers.erase(found);
+		}
+	}
+	if (!writer) {
+		return;
+	} else if (bytes == 0) {
+		writer->reset();
+	} else {
+		writer->add_credit(size_t(bytes));
+	}
+}
+
+void ipc::client_linux::drop_connection()
+{
+	// Runs on the epoll thread, a server sending garbage must not take the
+	// process down.
+	m_socket->disconnect();
+	flush_callbacks();
+	if (m_disconnectionCallback) {
+		m_disconnectionCallback();
+	}
+}
+
+void ipc::client_linux::flush_callbacks()
+{
+	std::vector<ipc::value> proc_rval;
+	proc_rval.resize(1);
+	proc_rval[0].type = ipc::type::Null;
+	proc_rval[0].value_str = "Lost IPC Connection";
+
+	// Callbacks may issue the next call, which takes the lock again, so they
+	// run once everything pending has been taken out.
+	std::map<int64_t, std::pair<call_return_t, void *>> calls;
+	std::map<int64_t, std::pair<batch_return_t, void *>> batches;
+	std::map<uint64_t, std::weak_ptr<ipc::stream_writer>> writers;
+	{
+		std::unique_lock<std::mutex> ulock(m_lock);
+		calls.swap(m_cb);
+		batches.swap(m_batches);
+		writers.swap(m_stream_writers);
+	}
+
+	for (auto &cb : calls) {
+		cb.second.first(cb.second.second, proc_rval);
+	}
+
+	std::vector<std::vector<ipc::value>> lost;
+	for (auto &cb : batches) {
+		cb.second.first(cb.second.second, lost);
+	}
+
+	for (auto &writer : writers) {
+		if (std::shared_ptr<ipc::stream_writer> locked = writer.second.lock()) {
+			locked->fail();
+		}
+	}
+
+	// No more invalidation notices will arrive.
+	m_cache.clear();
+	std::unique_lock<std::mutex> idlock(m_ids_lock);
+	m_cacheable.clear();
+}
+
+bool ipc::client_linux::cancel_call(int64_t cbid)
+{
+	if (!cancel(cbid)) {
+		return false;
+	}
+	send_cancel(uint64_t(cbid));
+	return true;
+}
+
+void ipc::client_linux::send_cancel(uint64_t uid)
+{
+	if (!m_socket || !m_socket->is_cancel_supported()) {
+		return;
+	}
+
+	uint8_t version = m_socket->get_wire_version();
+	std::shared_ptr<std::vector<char>> buf = std::make_shared<std::vector<char>>(ipc::buffer_pool::acquire(sizeof(ipc_size_t) + ipc::varint::size(uid)));
+	ipc::varint::write(*buf, sizeof(ipc_size_t), uid);
+	ipc::make_sendable(*buf, version, ipc::frame_cancel);
+	std::shared_ptr<os::async_op> write_op;
+	os::error ec = m_socket->write(buf->data(), buf->size(), write_op, [buf](os::error ec, size_t size) { ipc::buffer_pool::release(std::move(*buf)); });
+	if (ec == os::error::Disconnected) {
+		ipc::buffer_pool::release(std::move(*buf));
+	}
+}
+
+bool ipc::client_linux::cancel(int64_t const &id)
+{
+	std::unique_lock<std::mutex> ulock(m_lock);
+	auto found = m_cb.find(id);
+	if (found == m_cb.end()) {
+		return false;
+	}
+	if (found->second.first == &cache_callback) {
+		delete static_cast<cached_call *>(found->second.second);
+	}
+	m_cb.erase(found);
+	return true;
+}
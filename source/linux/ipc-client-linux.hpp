@@ -0,0 +1,133 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../include/ipc-client.hpp"
+#include "../include/error.hpp"
+#include "ipc-socket-linux.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <set>
+
+namespace ipc {
+class client_linux : public ipc::client {
+public:
+	client_linux(const std::string &socketPath, call_on_disconnect_t disconnectionCallback);
+	client_linux(std::string socketPath);
+	~client_linux();
+
+public:
+	void start();
+	void stop() override;
+
+	virtual bool call(const std::string &cname, const std::string &fname, std::vector<ipc::value> args, call_return_t fn = g_fn, void *data = g_data,
+			  int64_t &cbid = g_cbid) override;
+
+	virtual std::vector<ipc::value> call_synchronous_helper(const std::string &cname, const std::string &fname,
+								const std::vector<ipc::value> &args) override;
+
+	virtual bool call_with_deadline(const std::string &cname, const std::string &fname, std::vector<ipc::value> args,
+					std::chrono::steady_clock::time_point deadline, call_return_t fn = g_fn, void *data = g_data, int64_t &cbid = g_cbid) override;
+	virtual std::vector<ipc::value> call_synchronous_with_deadline(const std::string &cname, const std::string &fname, const std::vector<ipc::value> &args,
+								       std::chrono::steady_clock::time_point deadline) override;
+
+	virtual bool cancel_call(int64_t cbid) override;
+
+	virtual std::vector<std::vector<ipc::value>> call_batch(std::vector<call_spec> calls) override;
+
+	virtual bool subscribe(const std::string &topic, event_handler_t fn, void *data) override;
+	virtual bool unsubscribe(const std::string &topic) override;
+
+	virtual std::shared_ptr<ipc::stream_writer> open_stream() override;
+
+	virtual void set_cache_capacity(size_t entries) override;
+	virtual ipc::reply_cache::statistics cache_statistics() override;
+
+private:
+	std::string m_socketPath;
+	call_on_disconnect_t m_disconnectionCallback;
+	std::shared_ptr<os::linux::socket_linux> m_socket;
+	std::shared_ptr<os::async_op> m_rop;
+	std::atomic_bool m_stop = true;
+	std::vector<char> m_rbuf;
+	uint8_t m_rversion = ipc::wire_v1;
+
+	std::mutex m_lock;
+	std::map<int64_t, std::pair<call_return_t, void *>> m_cb;
+
+	// A call and the frame pointing into its arguments, alive until written.
+	struct gathered_call {
+		ipc::message::function_call call;
+		ipc::message::gather out;
+	};
+
+	// Pending batches by uid. The callback gets one reply per call, or none
+	// at all if the connection was lost.
+	typedef void (*batch_return_t)(void *data, std::vector<std::vector<ipc::value>> &rvals);
+	std::map<int64_t, std::pair<batch_return_t, void *>> m_batches;
+	uint8_t m_rkind = ipc::frame_single;
+	void read_batch_reply();
+
+	std::map<std::string, std::pair<event_handler_t, void *>> m_subscriptions;
+	void read_events();
+
+	// Open streams, for the credit the server hands out.
+	std::map<uint64_t, std::weak_ptr<ipc::stream_writer>> m_stream_writers;
+	void read_credit();
+
+	// Function ids by "collection::function", -1 while unknown or unsupported.
+	std::mutex m_ids_lock;
+	std::map<std::string, int64_t> m_ids;
+	int64_t find_function_id(const std::string &cname, const std::string &fname);
+	static void resolve_callback(void *data, const std::vector<ipc::value> &rval);
+
+	// Ids of cacheable functions whose invalidation notices the client is
+	// subscribed to, under m_ids_lock. Only their replies are cached.
+	std::set<uint32_t> m_cacheable;
+	ipc::reply_cache m_cache;
+	struct cached_call {
+		client_linux *client;
+		std::string key;
+		uint32_t fid;
+		uint64_t generation;
+		call_return_t fn;
+		void *data;
+	};
+	bool is_cacheable(uint32_t fid);
+	static void cache_callback(void *data, const std::vector<ipc::value> &rval);
+	static void cache_subscribed(void *data, const std::vector<ipc::value> &rval);
+	static void invalidated(void *data, const std::string &topic, const std::vector<ipc::value> &values);
+
+	// Common part of the calls with and without deadline, 0 for none.
+	bool send_call(const std::string &cname, const std::string &fname, std::vector<ipc::value> args, uint64_t deadline, call_return_t fn, void *data,
+		       int64_t &cbid);
+	std::vector<ipc::value> wait_call(const std::string &cname, const std::string &fname, const std::vector<ipc::value> &args,
+					  const std::chrono::steady_clock::time_point *deadline);
+
+	void read_header();
+	void read_callback_init(os::error ec, size_t size);
+	void read_callback_msg(os::error ec, size_t size);
+	void flush_callbacks();
+	// Gives up on a server that sent a frame the client can't parse.
+	void drop_connection();
+	bool cancel(int64_t const &id);
+	// Tells the server to stop a call, see ipc::frame_cancel.
+	void send_cancel(uint64_t uid);
+};
+}
@@ -0,0 +1,613 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ipc-server-instance-linux.hpp"
+#include "../include/ipc-buffer-pool.hpp"
+#include "../ipc-varint.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+using namespace std::placeholders;
+
+std::shared_ptr<ipc::server_instance> ipc::server_instance::create(server *owner, std::shared_ptr<ipc::socket> socket, int call_timeout)
+{
+	return std::make_unique<ipc::server_instance_linux>(owner, socket, call_timeout);
+}
+
+ipc::server_instance_linux::server_instance_linux(server *owner, std::shared_ptr<ipc::socket> socket, int call_timeout)
+{
+	m_parent = owner;
+	m_clientId = 0;
+	m_socket = std::dynamic_pointer_cast<os::linux::socket_linux>(socket);
+	m_event_queue = std::make_shared<event_queue>(m_socket);
+
+	// Readers may outlive the instance, so credit goes straight to the socket.
+	// A credit of zero resets the stream.
+	std::weak_ptr<os::linux::socket_linux> weak = m_socket;
+	m_streams = std::make_shared<ipc::stream_table>([weak](uint64_t id, size_t bytes) {
+		std::shared_ptr<os::linux::socket_linux> socket = weak.lock();
+		if (!socket) {
+			return;
+		}
+		auto buffer = std::make_shared<std::vector<char>>(ipc::buffer_pool::acquire(sizeof(ipc_size_t) + ipc::varint::size(id) + ipc::varint::size(bytes)));
+		size_t offset = sizeof(ipc_size_t);
+		offset += ipc::varint::write(*buffer, offset, id);
+		ipc::varint::write(*buffer, offset, bytes);
+
+		std::shared_ptr<os::async_op> wop;
+		ipc::make_sendable(*buffer, socket->get_wire_version(), ipc::frame_credit);
+		os::error ec = socket->write(buffer->data(), buffer->size(), wop, [buffer](os::error ec, size_t size) { ipc::buffer_pool::release(std::move(*buffer)); });
+		if (ec == os::error::Disconnected) {
+			ipc::buffer_pool::release(std::move(*buffer));
+		}
+	});
+
+	if (call_timeout)
+		m_watchdog_thread = std::thread(std::bind(&server_instance_linux::watchdog_callbacks, this, call_timeout));
+
+	read_header();
+}
+
+ipc::server_instance_linux::~server_instance_linux()
+{
+	// Closing the connection waits for the request that is currently being
+	// executed, after that no more callbacks will reach this instance.
+	m_parent->unsubscribe_all(m_event_queue);
+	m_event_queue->close();
+	m_stopWorkers = true;
+	m_socket->disconnect();
+	m_streams->fail_all(); // wakes up handlers waiting for more of a stream
+	{
+		// Calls still queued on the executor are skipped, but they hold on to this instance.
+		std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+		m_idle_cv.wait(lock, [this]() { return m_in_flight == 0; });
+	}
+	if (m_watchdog_thread.joinable())
+		m_watchdog_thread.join();
+	if (m_rbuf.capacity() > 0) {
+		ipc::buffer_pool::release(std::move(m_rbuf));
+	}
+}
+
+ipc::server_instance_linux::call_task::~call_task()
+{
+	ipc::buffer_pool::release(std::move(buffer));
+}
+
+ipc::server_instance_linux::batch_task::~batch_task()
+{
+	ipc::buffer_pool::release(std::move(buffer));
+}
+
+void ipc::server_instance_linux::watchdog_callbacks(int call_timeout)
+{
+	while (!m_stopWorkers) {
+		std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+		if (m_in_flight > 0) {
+			if (std::chrono::steady_clock::now() - m_last_write_time > std::chrono::seconds(call_timeout)) {
+				throw std::runtime_error("No write in " + std::to_string(call_timeout) + " seconds");
+			}
+		}
+		lock.unlock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+}
+
+void ipc::server_instance_linux::close_connection()
+{
+	m_socket->set_connected(false);
+	m_parent->client_disconnected(m_socket);
+}
+
+void ipc::server_instance_linux::read_header()
+{
+	// The previous buffer went to the call, start over with a pooled one.
+	if (m_rbuf.capacity() == 0) {
+		m_rbuf = ipc::buffer_pool::acquire(sizeof(ipc_size_t));
+	}
+	m_rbuf.resize(sizeof(ipc_size_t));
+	os::error ec = m_socket->read(m_rbuf.data(), m_rbuf.size(), m_rop, std::bind(&ipc::server_instance_linux::read_callback_init, this, _1, _2));
+	if (ec == os::error::Disconnected) {
+		close_connection();
+	} else if (ec != os::error::Pending && ec != os::error::Success) {
+		ipc::log("Reading request header failed with error %d.", static_cast<int>(ec));
+	}
+}
+
+void ipc::server_instance_linux::read_callback_init(os::error ec, size_t size)
+{
+	os::error ec2 = os::error::Success;
+
+	m_rop->invalidate();
+
+	if (ec == os::error::Success || ec == os::error::MoreData) {
+		ipc_size_t n_size = read_size(m_rbuf);
+		m_rversion = ipc::read_version(m_rbuf);
+		m_rkind = ipc::read_kind(m_rbuf);
+		m_rprioritized = ipc::read_priority(m_rbuf, m_rpriority);
+		if (n_size != 0) {
+			if (n_size > m_rbuf.capacity()) {
+				ipc::buffer_pool::release(std::move(m_rbuf));
+				m_rbuf = ipc::buffer_pool::acquire(n_size);
+			}
+			m_rbuf.resize(n_size);
+			ec2 = m_socket->read(m_rbuf.data(), m_rbuf.size(), m_rop, std::bind(&ipc::server_instance_linux::read_callback_msg, this, _1, _2));
+			if (ec2 == os::error::Disconnected) {
+				close_connection();
+			} else if (ec2 != os::error::Pending && ec2 != os::error::Success) {
+				ipc::log("Reading request failed with error %d.", static_cast<int>(ec2));
+			}
+		} else {
+			read_header();
+		}
+	} else {
+		close_connection();
+	}
+}
+
+void ipc::server_instance_linux::read_callback_msg(os::error ec, size_t size)
+{
+	m_rop->invalidate();
+
+	if (ec != os::error::Success) {
+		close_connection();
+		return;
+	}
+
+	if (m_rkind == ipc::frame_batch) {
+		read_batch();
+		return;
+	} else if (m_rkind == ipc::frame_event) {
+		m_event_queue->acknowledge();
+		read_header();
+		return;
+	} else if (m_rkind == ipc::frame_stream) {
+		read_stream();
+		return;
+	} else if (m_rkind == ipc::frame_cancel) {
+		read_cancel();
+		return;
+	}
+
+	// The call is parsed in place, so the task takes over the receive buffer
+	// and keeps it alive until the handler is done with the arguments.
+	std::shared_ptr<call_task> task = std::make_shared<call_task>();
+	task->buffer = std::move(m_rbuf);
+	task->version = m_rversion;
+	task->queued = std::chrono::steady_clock::now();
+	try {
+		if (task->version == ipc::wire_v2) {
+			task->call.deserialize_v2(task->buffer, 0);
+		} else {
+			task->call.deserialize(task->buffer, 0);
+		}
+	} catch (std::exception &e) {
+		ipc::log("????????: Deserialization of Function Call message failed with error %s.", e.what());
+		close_connection();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+		if (m_in_flight++ == 0) {
+			m_last_write_time = std::chrono::steady_clock::now();
+		}
+	}
+	{
+		std::unique_lock<std::mutex> lock(m_calls_lock);
+		m_calls[task->call.uid.value_union.ui64] = task;
+	}
+
+	// The reply carries the uid of the call, so calls may finish in any order.
+	// Calls that are already too late skip the queue, they only get an error.
+	task->lane = m_parent->call_priority(task->call, m_rprioritized ? &m_rpriority : nullptr);
+	if (ipc::deadline_passed(task->call.deadline)) {
+		execute(*task);
+	} else {
+		task->ticket = m_parent->dispatch(task->call, [this, task]() { execute(*task); }, task->lane);
+	}
+	read_header();
+}
+
+void ipc::server_instance_linux::execute(call_task &task)
+{
+	if (task.cancel.is_cancelled()) {
+		// The client forgot about the call while it was queued.
+		m_parent->count_cancelled(false);
+		finish_call(task);
+		return;
+	}
+
+	ipc::message::function_call_view &fnc_call_msg = task.call;
+	uint8_t version = task.version;
+	ipc::server::call_timing timing;
+	timing.queued = task.queued;
+	/// Processing
+	std::vector<ipc::value> proc_rval;
+	std::string proc_error;
+
+	// The reply stays alive until written, large values are sent from it.
+	auto frame = std::make_shared<gathered_reply>();
+	ipc::message::function_reply &fnc_reply_msg = frame->reply;
+
+	if (!m_stopWorkers) {
+		// Execute
+		ipc::stream_table::scope streams(m_streams.get());
+		ipc::cancellation_token::scope cancel(&task.cancel);
+		bool success = is_subscription(fnc_call_msg) ? subscription_call(fnc_call_msg, proc_rval, proc_error)
+							     : m_parent->client_call_function(m_clientId, fnc_call_msg, proc_rval, proc_error, &timing);
+		if (task.cancel.is_cancelled()) {
+			// Nobody is left to read the reply.
+			m_parent->count_cancelled(true);
+			finish_call(task);
+			return;
+		}
+		if (success && m_parent->drop_expired(fnc_call_msg.deadline, true)) {
+			// Nobody waits for the values anymore, a short error will do.
+			proc_rval.clear();
+			proc_error = IPC_DEADLINE_EXCEEDED;
+			success = false;
+		}
+
+		// Set
+		fnc_reply_msg.uid = fnc_call_msg.uid.to_value();
+		std::swap(proc_rval, fnc_reply_msg.values); // Fast "copy" of parameters.
+		if (!success) {
+			fnc_reply_msg.error = ipc::value(proc_error);
+		}
+
+		// Serialize
+		auto serialize_start = std::chrono::steady_clock::now();
+		try {
+			fnc_reply_msg.serialize(frame->out, version);
+			if (timing.metrics) {
+				timing.metrics->serialize.record(std::chrono::steady_clock::now() - serialize_start);
+			}
+			write_reply(frame, version, task.lane);
+		} catch (std::exception &e) {
+			ipc::log("%8llu: Serialization of Function Reply message failed with error %s.", fnc_reply_msg.uid.value_union.ui64, e.what());
+			close_connection();
+		}
+	}
+
+	finish_call(task);
+}
+
+void ipc::server_instance_linux::finish_call(call_task &task)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_calls_lock);
+		m_calls.erase(task.call.uid.value_union.ui64);
+	}
+
+	std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+	m_last_write_time = std::chrono::steady_clock::now();
+	if (--m_in_flight == 0) {
+		m_idle_cv.notify_all();
+	}
+}
+
+void ipc::server_instance_linux::read_batch()
+{
+	std::shared_ptr<batch_task> task = std::make_shared<batch_task>();
+	task->buffer = std::move(m_rbuf);
+	task->version = m_rversion;
+	task->prioritized = m_rprioritized;
+	task->lane = m_rpriority;
+	try {
+		task->batch.deserialize(task->buffer, 0, task->version);
+	} catch (std::exception &e) {
+		ipc::log("????????: Deserialization of Function Call batch failed with error %s.", e.what());
+		close_connection();
+		return;
+	}
+	task->reply.uid = task->batch.uid;
+	task->reply.replies.resize(task->batch.calls.size());
+
+	{
+		std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+		if (m_in_flight++ == 0) {
+			m_last_write_time = std::chrono::steady_clock::now();
+		}
+	}
+
+	run_batch(task);
+	read_header();
+}
+
+void ipc::server_instance_linux::read_stream()
+{
+	uint64_t id;
+	size_t offset;
+	try {
+		offset = ipc::varint::read(m_rbuf, 0, id);
+		if (offset >= m_rbuf.size()) {
+			throw std::runtime_error("Missing stream flags");
+		}
+	} catch (std::exception &e) {
+		ipc::log("????????: Deserialization of Stream chunk failed with error %s.", e.what());
+		close_connection();
+		return;
+	}
+
+	// The reader keeps the receive buffer until the chunk has been read.
+	uint8_t flags = uint8_t(m_rbuf[offset]);
+	m_streams->push(id, std::move(m_rbuf), offset + 1, flags);
+	read_header();
+}
+
+void ipc::server_instance_linux::read_cancel()
+{
+	uint64_t uid;
+	try {
+		ipc::varint::read(m_rbuf, 0, uid);
+	} catch (std::exception &e) {
+		ipc::log("????????: Deserialization of Cancel message failed with error %s.", e.what());
+		close_connection();
+		return;
+	}
+	read_header();
+
+	std::shared_ptr<call_task> task;
+	{
+		std::unique_lock<std::mutex> lock(m_calls_lock);
+		auto found = m_calls.find(uid);
+		if (found == m_calls.end()) {
+			return; // already answered
+		}
+		task = found->second.lock();
+	}
+	if (!task) {
+		return;
+	}
+	task->cancel.cancel();
+	if (m_parent->withdraw(task->call, task->ticket)) {
+		// Taken off the queue before it started, which also frees the
+		// receive buffer once the last reference is gone.
+		m_parent->count_cancelled(false);
+		finish_call(*task);
+	}
+}
+
+void ipc::server_instance_linux::run_batch(std::shared_ptr<batch_task> task)
+{
+	// A call either finishes inside dispatch() or later on the executor.
+	// Whichever comes second, dispatch() returning or the call finishing,
+	// moves on to the next call. That keeps the stack flat when the calls
+	// run inline and still never runs two calls of a batch at once.
+	while (task->next < task->batch.calls.size()) {
+		task->step = 0;
+		task->queued = std::chrono::steady_clock::now();
+		ipc::message::function_call_view &call = task->batch.calls[task->next];
+		ipc::priority lane = m_parent->call_priority(call, task->prioritized ? &task->lane : nullptr);
+		m_parent->dispatch(call, [this, task]() {
+			execute_batch_call(*task);
+			if (task->step.exchange(1) == 2) {
+				run_batch(task);
+			}
+		}, lane);
+		if (task->step.exchange(2) == 0) {
+			return;
+		}
+	}
+	finish_batch(*task);
+}
+
+void ipc::server_instance_linux::execute_batch_call(batch_task &task)
+{
+	ipc::message::function_call_view &fnc_call_msg = task.batch.calls[task.next];
+	ipc::message::function_reply &fnc_reply_msg = task.reply.replies[task.next];
+	task.next++;
+
+	if (m_stopWorkers) {
+		return;
+	}
+
+	ipc::server::call_timing timing;
+	timing.queued = task.queued;
+	std::string proc_error;
+	ipc::stream_table::scope streams(m_streams.get());
+	bool success = is_subscription(fnc_call_msg) ? subscription_call(fnc_call_msg, fnc_reply_msg.values, proc_error)
+						     : m_parent->client_call_function(m_clientId, fnc_call_msg, fnc_reply_msg.values, proc_error, &timing);
+	fnc_reply_msg.uid = fnc_call_msg.uid.to_value();
+	if (!success) {
+		fnc_reply_msg.error = ipc::value(proc_error);
+	}
+}
+
+void ipc::server_instance_linux::finish_batch(batch_task &task)
+{
+	std::vector<char> write_buffer;
+
+	if (!m_stopWorkers) {
+		try {
+			write_buffer = ipc::buffer_pool::acquire(task.reply.size(task.version) + sizeof(ipc_size_t));
+			task.reply.serialize(write_buffer, sizeof(ipc_size_t), task.version);
+			read_callback_msg_write(write_buffer, task.version, ipc::frame_batch, int(task.lane));
+		} catch (std::exception &e) {
+			ipc::log("%8llu: Serialization of Function Reply batch failed with error %s.", (unsigned long long)task.reply.uid, e.what());
+			close_connection();
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+	m_last_write_time = std::chrono::steady_clock::now();
+	if (--m_in_flight == 0) {
+		m_idle_cv.notify_all();
+	}
+}
+
+void ipc::server_instance_linux::read_callback_msg_write(std::vector<char> &write_buffer, uint8_t version, uint8_t kind, int lane)
+{
+	if (write_buffer.size() == 0) {
+		return;
+	}
+
+	// The socket queues writes itself, the callback only has to keep the
+	// buffer alive until it has been sent.
+	auto buffer = std::make_shared<std::vector<char>>(std::move(write_buffer));
+	std::shared_ptr<os::async_op> wop;
+	ipc::make_sendable(*buffer, version, kind);
+	auto written = [this, buffer](os::error ec, size_t size) {
+		ipc::buffer_pool::release(std::move(*buffer));
+		write_callback(ec, size);
+	};
+	os::error ec = m_socket->write(buffer->data(), buffer->size(), wop, written, lane);
+	if (ec == os::error::Disconnected) {
+		// Refused right away, the callback will not run.
+		ipc::buffer_pool::release(std::move(*buffer));
+	} else if (ec != os::error::Pending && ec != os::error::Success) {
+		ipc::log("Write buffer operation failed with error %d.", static_cast<int>(ec));
+	}
+}
+
+void ipc::server_instance_linux::write_reply(std::shared_ptr<gathered_reply> frame, uint8_t version, ipc::priority lane)
+{
+	if (frame->out.references.empty()) {
+		// Nothing referenced, the head holds the whole frame.
+		read_callback_msg_write(frame->out.head, version, ipc::frame_single, int(lane));
+		return;
+	}
+
+	std::shared_ptr<os::async_op> wop;
+	frame->out.make_sendable(version);
+	auto written = [this, frame](os::error ec, size_t size) {
+		ipc::buffer_pool::release(std::move(frame->out.head));
+		write_callback(ec, size);
+	};
+	os::error ec = m_socket->write(frame->out.parts(), wop, written, int(lane));
+	if (ec == os::error::Disconnected) {
+		ipc::buffer_pool::release(std::move(frame->out.head));
+	} else if (ec != os::error::Pending && ec != os::error::Success) {
+		ipc::log("Write buffer operation failed with error %d.", static_cast<int>(ec));
+	}
+}
+
+void ipc::server_instance_linux::write_callback(os::error ec, size_t size)
+{
+	if (ec != os::error::Success) {
+		close_connection();
+	}
+}
+
+bool ipc::server_instance_linux::is_subscription(const ipc::message::function_call_view &call)
+{
+	return (call.class_name.type == ipc::type::String) && (call.class_name.value_str == IPC_BUILTIN_COLLECTION) &&
+	       ((call.function_name.value_str == IPC_SUBSCRIBE_FUNCTION) || (call.function_name.value_str == IPC_UNSUBSCRIBE_FUNCTION));
+}
+
+bool ipc::server_instance_linux::subscription_call(const ipc::message::function_call_view &call, std::vector<ipc::value> &rval, std::string &errormsg)
+{
+	if ((call.arguments.size() != 1) || (call.arguments[0].type != ipc::type::String)) {
+		errormsg = "Expected a String topic";
+		return false;
+	}
+
+	std::string topic(call.arguments[0].value_str);
+	if (call.function_name.value_str == IPC_SUBSCRIBE_FUNCTION) {
+		m_parent->subscribe(m_event_queue, topic);
+	} else {
+		m_parent->unsubscribe(m_event_queue, topic);
+	}
+	rval.push_back(ipc::value(topic));
+	return true;
+}
+
+void ipc::server_instance_linux::event_queue::push_event(const std::string &topic, const std::vector<ipc::value> &values)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (m_closed) {
+			return;
+		}
+		m_events[topic] = values;
+		if (m_writing) {
+			return;
+		}
+		m_writing = true;
+	}
+	write();
+}
+
+void ipc::server_instance_linux::event_queue::acknowledge()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (m_events.empty() || m_closed) {
+			m_writing = false;
+			return;
+		}
+	}
+	write();
+}
+
+void ipc::server_instance_linux::event_queue::close()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_closed = true;
+	m_events.clear();
+}
+
+void ipc::server_instance_linux::event_queue::write()
+{
+	std::shared_ptr<os::linux::socket_linux> socket = m_socket.lock();
+	ipc::message::event_batch events_msg;
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (m_events.empty() || m_closed || !socket) {
+			m_writing = false;
+			return;
+		}
+		events_msg.events.reserve(m_events.size());
+		for (auto &entry : m_events) {
+			events_msg.events.push_back({ipc::value(entry.first), std::move(entry.second)});
+		}
+		m_events.clear();
+	}
+
+	uint8_t version = socket->get_wire_version();
+	std::shared_ptr<std::vector<char>> buffer;
+	try {
+		buffer = std::make_shared<std::vector<char>>(ipc::buffer_pool::acquire(events_msg.size(version) + sizeof(ipc_size_t)));
+		events_msg.serialize(*buffer, sizeof(ipc_size_t), version);
+	} catch (std::exception &e) {
+		ipc::log("Serialization of Event message failed with error %s.", e.what());
+		close();
+		return;
+	}
+
+	// The next frame only goes out once the client acknowledged this one,
+	// whatever is published meanwhile is merged into it. A failed write is
+	// noticed by the instance reading the connection.
+	std::shared_ptr<event_queue> self = shared_from_this();
+	std::shared_ptr<os::async_op> wop;
+	ipc::make_sendable(*buffer, version, ipc::frame_event);
+	os::error ec = socket->write(buffer->data(), buffer->size(), wop, [self, buffer](os::error ec, size_t size) {
+		ipc::buffer_pool::release(std::move(*buffer));
+		if (ec != os::error::Success) {
+			self->close();
+		}
+	});
+	if (ec == os::error::Disconnected) {
+		ipc::buffer_pool::release(std::move(*buffer));
+		close();
+	} else if (ec != os::error::Pending && ec != os::error::Success) {
+		ipc::log("Write event operation failed with error %d.", static_cast<int>(ec));
+	}
+}
@@ -0,0 +1,159 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../include/ipc-server-instance.hpp"
+#include "../include/error.hpp"
+#include "../include/ipc-cancellation.hpp"
+#include "../include/ipc-stream.hpp"
+#include "ipc-socket-linux.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace ipc {
+class server;
+
+/** Server side of a single connection.
+ *
+ * There is no worker thread: requests are read and decoded from the socket
+ * callbacks on the shared epoll loop, then handed to server::dispatch(), which
+ * runs them either inline or on the server's executor.
+ */
+class server_instance_linux : public server_instance {
+private:
+	// A decoded call together with the buffer its arguments point into. The
+	// reply goes out in the wire format the call came in.
+	struct call_task {
+		std::vector<char> buffer;
+		ipc::message::function_call_view call;
+		uint8_t version = ipc::wire_v1;
+		std::chrono::steady_clock::time_point queued;
+		ipc::cancellation_token cancel;
+		ipc::priority lane = ipc::priority::normal;
+		// Set on the reading thread once queued, which is also where cancel
+		// frames are read.
+		ipc::executor::ticket_t ticket = 0;
+
+		~call_task();
+	};
+
+	// A decoded batch. Its calls run one after the other, each through
+	// server::dispatch() so that serial collections stay in order, and the
+	// replies go out together once the last call is done.
+	struct batch_task {
+		std::vector<char> buffer;
+		ipc::message::function_call_batch_view batch;
+		ipc::message::function_reply_batch reply;
+		uint8_t version = ipc::wire_v1;
+		std::chrono::steady_clock::time_point queued;
+		// Lane the client asked for, if any, each call runs in its own.
+		bool prioritized = false;
+		ipc::priority lane = ipc::priority::normal;
+		size_t next = 0;
+		std::atomic<int> step = 0;
+
+		~batch_task();
+	};
+
+	// A reply and the frame pointing into its values.
+	struct gathered_reply {
+		ipc::message::function_reply reply;
+		ipc::message::gather out;
+	};
+	void write_reply(std::shared_ptr<gathered_reply> frame, uint8_t version, ipc::priority lane);
+
+	std::shared_ptr<os::linux::socket_linux> m_socket;
+	std::shared_ptr<os::async_op> m_rop;
+	std::vector<char> m_rbuf;
+	uint8_t m_rversion = ipc::wire_v1;
+	uint8_t m_rkind = ipc::frame_single;
+	bool m_rprioritized = false;
+	ipc::priority m_rpriority = ipc::priority::normal;
+	server *m_parent = nullptr;
+	int64_t m_clientId;
+
+	std::atomic_bool m_stopWorkers = false;
+	std::thread m_watchdog_thread;
+	std::mutex m_watchdog_mutex;
+	void watchdog_callbacks(int call_timeout);
+	std::chrono::steady_clock::time_point m_last_write_time;
+	std::condition_variable m_idle_cv;
+	size_t m_in_flight = 0;
+
+	// Marks the connection dead and lets the server reap this instance.
+	void close_connection();
+
+	// Events waiting to be sent, only the latest values of a topic are kept.
+	// At most one event frame is unacknowledged at a time.
+	class event_queue : public ipc::event_sink, public std::enable_shared_from_this<event_queue> {
+		std::weak_ptr<os::linux::socket_linux> m_socket;
+		std::mutex m_lock;
+		std::map<std::string, std::vector<ipc::value>> m_events;
+		bool m_writing = false;
+		bool m_closed = false;
+
+		void write();
+
+	public:
+		event_queue(std::shared_ptr<os::linux::socket_linux> socket) : m_socket(socket) {}
+
+		void push_event(const std::string &topic, const std::vector<ipc::value> &values) override;
+		void acknowledge();
+		void close();
+	};
+	std::shared_ptr<event_queue> m_event_queue;
+
+	// Single calls not yet finished by uid, so that the client can cancel them.
+	std::mutex m_calls_lock;
+	std::unordered_map<uint64_t, std::weak_ptr<call_task>> m_calls;
+	void read_cancel();
+
+	// Streams the client sends, handlers find them through the call they run for.
+	std::shared_ptr<ipc::stream_table> m_streams;
+	void read_stream();
+
+	// Subscriptions belong to the connection, so they are answered here
+	// instead of by the server's collections.
+	bool is_subscription(const ipc::message::function_call_view &call);
+	bool subscription_call(const ipc::message::function_call_view &call, std::vector<ipc::value> &rval, std::string &errormsg);
+
+public:
+	server_instance_linux(server *owner, std::shared_ptr<ipc::socket> socket, int call_timeout);
+	~server_instance_linux();
+
+public:
+	void read_header();
+	void read_callback_init(os::error ec, size_t size);
+	void read_callback_msg(os::error ec, size_t size);
+	void execute(call_task &task);
+	void finish_call(call_task &task);
+	void read_batch();
+	void run_batch(std::shared_ptr<batch_task> task);
+	void execute_batch_call(batch_task &task);
+	void finish_batch(batch_task &task);
+	// Frames other than replies keep their place in the write queue.
+	void read_callback_msg_write(std::vector<char> &write_buffer, uint8_t version, uint8_t kind = ipc::frame_single,
+				     int lane = os::linux::socket_linux::in_order);
+	void write_callback(os::error ec, size_t size);
+};
+}
@@ -0,0 +1,887 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "ipc-socket-linux.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../include/ipc.hpp"
+
+#define SOCKET_EVENTS (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET)
+
+#define HELLO_MAGIC 0x4f4c4548 // 'HELO'
+#define HELLO_VERSION 1
+#define HELLO_SHM 0x1
+#define HELLO_WIRE_V2 0x2
+#define HELLO_BATCH 0x4
+#define HELLO_STREAM 0x8
+#define HELLO_DEADLINE 0x10
+#define HELLO_CANCEL 0x20
+
+// First message on every connection, client to server and back.
+struct hello {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t flags;
+	uint32_t reserved;
+};
+static_assert(sizeof(hello) == 16, "Handshake message must be 16 bytes.");
+
+static std::atomic<size_t> g_shm_capacity(os::linux::shm_channel::default_capacity);
+static std::atomic<uint8_t> g_wire_version(ipc::wire_v2);
+
+inline sockaddr_un make_address(const std::string &name)
+{
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+
+	if (name.length() == 0) {
+		throw std::invalid_argument("'name' can't be empty.");
+	} else if (name.length() >= sizeof(addr.sun_path)) {
+		throw std::invalid_argument("'name' can't be longer than " + std::to_string(sizeof(addr.sun_path) - 1) + " characters.");
+	}
+
+	memcpy(addr.sun_path, name.c_str(), name.length());
+	return addr;
+}
+
+os::linux::listener::listener(const std::string &path) : path(path)
+{
+	sockaddr_un addr = make_address(path);
+
+	fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		throw std::runtime_error("Creating Unix socket failed with error code " + std::to_string(errno) + ".");
+	}
+
+	// A previous server may have left its socket file behind. Only a file
+	// nobody listens on is removed, a running server keeps its path just like
+	// the first pipe instance does on Windows.
+	int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int err = ((probe >= 0) && (connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)) ? errno : 0;
+	if (probe >= 0) {
+		close(probe);
+	}
+	if ((err != ECONNREFUSED) && (err != ENOENT)) {
+		close(fd);
+		throw std::runtime_error("Unix socket '" + path + "' is already in use" + (err ? " (error code " + std::to_string(err) + ")." : "."));
+	}
+	if (err == ECONNREFUSED) {
+		unlink(path.c_str());
+	}
+
+	struct stat st;
+	if ((bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) || (listen(fd, SOMAXCONN) < 0) || (stat(path.c_str(), &st) < 0)) {
+		err = errno;
+		close(fd);
+		throw std::runtime_error("Binding Unix socket failed with error code " + std::to_string(err) + ".");
+	}
+	dev = st.st_dev;
+	ino = st.st_ino;
+}
+
+os::linux::listener::~listener()
+{
+	if (registered) {
+		epoll_loop::get().remove(fd);
+	}
+	if (fd >= 0) {
+		close(fd);
+		// Someone else may have taken over the path since.
+		struct stat st;
+		if ((stat(path.c_str(), &st) == 0) && (st.st_dev == dev) && (st.st_ino == ino)) {
+			unlink(path.c_str());
+		}
+	}
+}
+
+void os::linux::listener::wait(const std::shared_ptr<socket_linux> &socket)
+{
+	std::unique_lock<std::mutex> ul(lock);
+	waiting.push_back(std::make_pair(socket.get(), std::weak_ptr<socket_linux>(socket)));
+
+	if (!registered) {
+		std::weak_ptr<listener> weak = weak_from_this();
+		epoll_loop::get().add(fd, EPOLLIN | EPOLLET, [weak](uint32_t events) {
+			std::shared_ptr<listener> self = weak.lock();
+			if (self) {
+				self->notify();
+			}
+		});
+		registered = true;
+	}
+}
+
+void os::linux::listener::stop_waiting(socket_linux *socket)
+{
+	std::unique_lock<std::mutex> ul(lock);
+	// Locking the entries here could end up destroying one of them.
+	for (auto it = waiting.begin(); it != waiting.end();) {
+		if ((it->first == socket) || it->second.expired()) {
+			it = waiting.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+void os::linux::listener::notify()
+{
+	std::vector<std::shared_ptr<socket_linux>> sockets;
+	{
+		std::unique_lock<std::mutex> ul(lock);
+		for (auto &entry : waiting) {
+			std::shared_ptr<socket_linux> socket = entry.second.lock();
+			if (socket) {
+				sockets.push_back(std::move(socket));
+			}
+		}
+	}
+
+	// Without the lock, accepting calls back into stop_waiting().
+	for (auto &socket : sockets) {
+		socket->process(0);
+	}
+}
+
+std::shared_ptr<os::linux::socket_linux> os::linux::socket_linux::create(os::create_only_t, const std::string &name)
+{
+	return std::make_shared<os::linux::socket_linux>(os::create_only, name);
+}
+
+std::shared_ptr<os::linux::socket_linux> os::linux::socket_linux::create(os::open_only_t, const std::string &name)
+{
+	std::shared_ptr<os::linux::socket_linux> socket = std::make_shared<os::linux::socket_linux>(os::open_only, name);
+	std::unique_lock<std::mutex> ul(socket->m_lock);
+	socket->attach(socket->m_fd);
+	socket->send_hello();
+	return socket;
+}
+
+void os::linux::socket_linux::set_shared_memory(size_t capacity)
+{
+	g_shm_capacity = capacity;
+}
+
+void os::linux::socket_linux::set_wire_version(uint8_t version)
+{
+	g_wire_version = version;
+}
+
+os::linux::socket_linux::socket_linux(os::create_only_t, const std::string &name) : socket_linux(std::make_shared<listener>(name)) {}
+
+os::linux::socket_linux::socket_linux(std::shared_ptr<listener> listener)
+{
+	m_listener = std::move(listener);
+	created = true;
+}
+
+std::shared_ptr<os::linux::socket_linux> os::linux::socket_linux::create_sibling()
+{
+	if (!m_listener) {
+		return nullptr;
+	}
+	return std::make_shared<os::linux::socket_linux>(m_listener);
+}
+
+os::linux::socket_linux::socket_linux(os::open_only_t, const std::string &name)
+{
+	sockaddr_un addr = make_address(name);
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		throw std::runtime_error("Creating Unix socket failed with error code " + std::to_string(errno) + ".");
+	}
+
+	if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+		int err = errno;
+		close(fd);
+		throw std::runtime_error("Connecting to Unix socket failed with error code " + std::to_string(err) + ".");
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	m_fd = fd;
+	connected = true;
+}
+
+os::linux::socket_linux::~socket_linux()
+{
+	reset_connection();
+	if (m_listener) {
+		m_listener->stop_waiting(this);
+	}
+}
+
+void os::linux::socket_linux::attach(int fd)
+{
+	std::weak_ptr<socket_linux> weak = weak_from_this();
+
+	m_fd = fd;
+	connected = true;
+	epoll_loop::get().add(m_fd, SOCKET_EVENTS, [weak](uint32_t events) {
+		std::shared_ptr<socket_linux> self = weak.lock();
+		if (self) {
+			self->process(events);
+		}
+	});
+}
+
+void os::linux::socket_linux::reset_connection()
+{
+	if (m_shm) {
+		epoll_loop::get().remove(m_shm->get_wake());
+		m_shm = nullptr;
+	}
+	m_shm_offer = nullptr;
+	for (int fd : m_hs_fds) {
+		close(fd);
+	}
+	m_hs_fds.clear();
+	m_handshake = handshake::None;
+	m_hs_done = 0;
+	m_hangup = false;
+	m_wire_version = ipc::wire_v1;
+	m_batch = false;
+	m_stream = false;
+	m_deadline = false;
+	m_cancel = false;
+
+	if (m_fd >= 0) {
+		epoll_loop::get().remove(m_fd);
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+void os::linux::socket_linux::send_hello()
+{
+	hello msg = {HELLO_MAGIC, HELLO_VERSION, HELLO_BATCH | HELLO_STREAM | HELLO_DEADLINE | HELLO_CANCEL, 0};
+	if (g_wire_version >= ipc::wire_v2) {
+		msg.flags |= HELLO_WIRE_V2;
+	}
+	int fds[3];
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+
+	iovec iov = {&msg, sizeof(msg)};
+	msghdr mh = {};
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+
+	if (g_shm_capacity > 0) {
+		m_shm_offer = os::linux::shm_channel::create(g_shm_capacity);
+	}
+	if (m_shm_offer) {
+		m_shm_offer->get_descriptors(fds);
+		mh.msg_control = control;
+		mh.msg_controllen = sizeof(control);
+		cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+		cm->cmsg_level = SOL_SOCKET;
+		cm->cmsg_type = SCM_RIGHTS;
+		cm->cmsg_len = CMSG_LEN(sizeof(fds));
+		memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+		msg.flags |= HELLO_SHM;
+	}
+
+	// The connection is brand new, so the message always fits into the socket buffer.
+	ssize_t ret;
+	do {
+		ret = sendmsg(m_fd, &mh, MSG_NOSIGNAL);
+	} while ((ret < 0) && (errno == EINTR));
+	if (ret != ssize_t(sizeof(msg))) {
+		throw std::runtime_error("Sending handshake failed with error code " + std::to_string(errno) + ".");
+	}
+	m_handshake = handshake::AwaitAck;
+}
+
+void os::linux::socket_linux::use_channel(std::shared_ptr<os::linux::shm_channel> channel)
+{
+	std::weak_ptr<socket_linux> weak = weak_from_this();
+
+	m_shm = channel;
+	// The handler holds on to the channel, so a wake up racing with
+	// disconnect() never touches a closed descriptor.
+	epoll_loop::get().add(channel->get_wake(), EPOLLIN | EPOLLET, [weak, channel](uint32_t events) {
+		channel->drain_wake();
+		std::shared_ptr<socket_linux> self = weak.lock();
+		if (self) {
+			self->process(0);
+		}
+	});
+}
+
+std::shared_ptr<os::linux::async_request> os::linux::socket_linux::prepare(std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb,
+										  os::async_op_cb_t system_cb)
+{
+	std::shared_ptr<os::linux::async_request> ar = std::static_pointer_cast<os::linux::async_request>(op);
+	if (!ar) {
+		ar = std::make_shared<os::linux::async_request>();
+		op = std::static_pointer_cast<os::async_op>(ar);
+	}
+	ar->set_callback(cb);
+	ar->set_system_callback(system_cb);
+	ar->set_valid(true);
+	return ar;
+}
+
+os::error os::linux::socket_linux::read(char *buffer, size_t buffer_length, std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb)
+{
+	if (!is_connected()) {
+		return os::error::Disconnected;
+	}
+
+	std::shared_ptr<os::linux::async_request> ar = prepare(op, cb);
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		ar->owner = weak_from_this();
+		m_reads.push_back({ar, buffer, buffer_length, 0});
+	}
+
+	process(0);
+	return ar->is_complete() ? os::error::Success : os::error::Pending;
+}
+
+os::error os::linux::socket_linux::write(const char *buffer, size_t buffer_length, std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb, int lane)
+{
+	if (!is_connected()) {
+		return os::error::Disconnected;
+	}
+
+	request rq = {prepare(op, cb), const_cast<char *>(buffer), buffer_length, 0};
+	rq.lane = lane;
+	std::shared_ptr<os::linux::async_request> ar = rq.op;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		ar->owner = weak_from_this();
+		enqueue_write(std::move(rq));
+	}
+
+	// Try to send right away, most messages fit into the socket buffer.
+	process(0);
+	return ar->is_complete() ? os::error::Success : os::error::Pending;
+}
+
+os::error os::linux::socket_linux::write(const std::vector<ipc::span<const char>> &parts, std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb, int lane)
+{
+	if (!is_connected()) {
+		return os::error::Disconnected;
+	}
+
+	request rq = {prepare(op, cb), nullptr, 0, 0};
+	rq.lane = lane;
+	rq.parts.reserve(parts.size());
+	for (const ipc::span<const char> &part : parts) {
+		if (!part.empty()) {
+			rq.parts.push_back({const_cast<char *>(part.data()), part.size()});
+			rq.length += part.size();
+		}
+	}
+
+	std::shared_ptr<os::linux::async_request> ar = rq.op;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		ar->owner = weak_from_this();
+		enqueue_write(std::move(rq));
+	}
+
+	process(0);
+	return ar->is_complete() ? os::error::Success : os::error::Pending;
+}
+
+void os::linux::socket_linux::enqueue_write(request rq)
+{
+	size_t pos = m_writes.size();
+	if (rq.lane != in_order) {
+		while (pos > 0) {
+			const request &prev = m_writes[pos - 1];
+			if ((prev.lane == in_order) || (prev.lane <= rq.lane) || (prev.done > 0) || (prev.overtaken >= max_overtaken)) {
+				break;
+			}
+			pos--;
+		}
+		for (size_t idx = pos; idx < m_writes.size(); idx++) {
+			m_writes[idx].overtaken++;
+		}
+	}
+	m_writes.insert(m_writes.begin() + pos, std::move(rq));
+}
+
+void os::linux::socket_linux::process(uint32_t events)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	m_events |= events;
+	m_dirty = true;
+
+	// Only one thread drives the state machine at a time. Anyone arriving
+	// while it runs (including callbacks issuing new operations) just asks
+	// for another pass, which keeps the callback chain from recursing.
+	if (m_processing) {
+		return;
+	}
+	m_processing = true;
+	m_processing_thread = std::this_thread::get_id();
+
+	std::vector<completion> done;
+	while (m_dirty) {
+		m_dirty = false;
+		uint32_t ev = m_events;
+		m_events = 0;
+		if (ev & (EPOLLRDHUP | EPOLLHUP)) {
+			m_hangup = true;
+		}
+
+		progress_accept(done);
+		progress_handshake(done);
+		progress_read(done);
+		progress_write(done);
+		if ((ev & EPOLLERR) && (m_fd >= 0)) {
+			fail_all(done, os::error::Disconnected);
+		}
+
+		if (done.size() > 0) {
+			ul.unlock();
+			for (completion &c : done) {
+				c.op->finish(c.ec, c.length);
+			}
+			done.clear();
+			ul.lock();
+		}
+	}
+
+	m_processing = false;
+	m_cv.notify_all();
+}
+
+void os::linux::socket_linux::progress_accept(std::vector<completion> &done)
+{
+	if (!m_accept || (m_fd >= 0)) {
+		return;
+	}
+
+	while (true) {
+		int fd = accept4(m_listener->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd >= 0) {
+			m_listener->stop_waiting(this);
+			attach(fd);
+			m_handshake = handshake::AwaitHello;
+			done.push_back({std::move(m_accept), os::error::Connected, 0});
+			m_accept = nullptr;
+			return;
+		}
+
+		if (errno == EINTR || errno == ECONNABORTED) {
+			continue;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return;
+		}
+
+		m_listener->stop_waiting(this);
+		done.push_back({std::move(m_accept), os::error::Error, 0});
+		m_accept = nullptr;
+		return;
+	}
+}
+
+void os::linux::socket_linux::progress_handshake(std::vector<completion> &done)
+{
+	if ((m_handshake == handshake::None) || (m_fd < 0)) {
+		return;
+	}
+
+	while (m_hs_done < sizeof(hello)) {
+		int fds[3];
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+		iovec iov = {m_hs_buffer + m_hs_done, sizeof(hello) - m_hs_done};
+		msghdr mh = {};
+		mh.msg_iov = &iov;
+		mh.msg_iovlen = 1;
+		mh.msg_control = control;
+		mh.msg_controllen = sizeof(control);
+
+		ssize_t ret = recvmsg(m_fd, &mh, MSG_CMSG_CLOEXEC);
+		if (ret > 0) {
+			m_hs_done += size_t(ret);
+			for (cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm != nullptr; cm = CMSG_NXTHDR(&mh, cm)) {
+				if ((cm->cmsg_level == SOL_SOCKET) && (cm->cmsg_type == SCM_RIGHTS)) {
+					size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+					int *received = reinterpret_cast<int *>(CMSG_DATA(cm));
+					m_hs_fds.insert(m_hs_fds.end(), received, received + count);
+				}
+			}
+		} else if (ret == 0) {
+			fail_all(done, os::error::Disconnected);
+			return;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return;
+		} else {
+			fail_all(done, os::error::Disconnected);
+			return;
+		}
+	}
+
+	hello msg;
+	memcpy(&msg, m_hs_buffer, sizeof(msg));
+	std::vector<int> fds = std::move(m_hs_fds);
+	m_hs_fds.clear();
+	handshake state = m_handshake;
+	m_handshake = handshake::None;
+
+	if ((msg.magic != HELLO_MAGIC) || (msg.version != HELLO_VERSION)) {
+		ipc::log("Unexpected handshake message, closing connection.");
+		for (int fd : fds) {
+			close(fd);
+		}
+		fail_all(done, os::error::Disconnected);
+		return;
+	}
+
+	if (state == handshake::AwaitHello) {
+		std::shared_ptr<os::linux::shm_channel> channel;
+		if ((msg.flags & HELLO_SHM) && (fds.size() == 3) && (g_shm_capacity > 0)) {
+			channel = os::linux::shm_channel::open(fds[0], fds[1], fds[2]);
+		} else {
+			for (int fd : fds) {
+				close(fd);
+			}
+		}
+
+		hello ack = {HELLO_MAGIC, HELLO_VERSION, channel ? HELLO_SHM : 0u, 0};
+		if ((msg.flags & HELLO_WIRE_V2) && (g_wire_version >= ipc::wire_v2)) {
+			ack.flags |= HELLO_WIRE_V2;
+			m_wire_version = ipc::wire_v2;
+		}
+		if (msg.flags & HELLO_BATCH) {
+			ack.flags |= HELLO_BATCH;
+			m_batch = true;
+		}
+		if (msg.flags & HELLO_STREAM) {
+			ack.flags |= HELLO_STREAM;
+			m_stream = true;
+		}
+		if (msg.flags & HELLO_DEADLINE) {
+			ack.flags |= HELLO_DEADLINE;
+			m_deadline = true;
+		}
+		if (msg.flags & HELLO_CANCEL) {
+			ack.flags |= HELLO_CANCEL;
+			m_cancel = true;
+		}
+		if (::send(m_fd, &ack, sizeof(ack), MSG_NOSIGNAL) != ssize_t(sizeof(ack))) {
+			fail_all(done, os::error::Disconnected);
+			return;
+		}
+		if (channel) {
+			use_channel(channel);
+		}
+	} else {
+		if ((msg.flags & HELLO_SHM) && m_shm_offer) {
+			use_channel(m_shm_offer);
+		}
+		if (msg.flags & HELLO_WIRE_V2) {
+			m_wire_version = ipc::wire_v2;
+		}
+		m_batch = (msg.flags & HELLO_BATCH) != 0;
+		m_stream = (msg.flags & HELLO_STREAM) != 0;
+		m_deadline = (msg.flags & HELLO_DEADLINE) != 0;
+		m_cancel = (msg.flags & HELLO_CANCEL) != 0;
+		m_shm_offer = nullptr;
+	}
+}
+
+void os::linux::socket_linux::progress_read(std::vector<completion> &done)
+{
+	if (m_handshake != handshake::None) {
+		return;
+	}
+
+	while ((m_reads.size() > 0) && (m_fd >= 0)) {
+		request &rq = m_reads.front();
+		if ((rq.done < rq.length) && m_shm) {
+			size_t count = m_shm->read(rq.buffer + rq.done, rq.length - rq.done);
+			if (count > 0) {
+				rq.done += count;
+			} else if (m_shm->is_broken()) {
+				// Nothing the peer sends can be trusted anymore. Closing
+				// the socket tells it, whatever its side of the rings says.
+				fail_all(done, os::error::Disconnected);
+				reset_connection();
+				return;
+			} else if (m_hangup) {
+				fail_all(done, os::error::Disconnected);
+				return;
+			} else {
+				return;
+			}
+		} else if (rq.done < rq.length) {
+			ssize_t ret = ::recv(m_fd, rq.buffer + rq.done, rq.length - rq.done, 0);
+			if (ret > 0) {
+				rq.done += size_t(ret);
+			} else if (ret == 0) {
+				fail_all(done, os::error::Disconnected);
+				return;
+			} else if (errno == EINTR) {
+				continue;
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				return;
+			} else {
+				fail_all(done, os::error::Disconnected);
+				return;
+			}
+		}
+
+		if (rq.done == rq.length) {
+			done.push_back({std::move(rq.op), os::error::Success, rq.length});
+			m_reads.pop_front();
+		}
+	}
+}
+
+void os::linux::socket_linux::consume(request &rq, size_t count)
+{
+	rq.done += count;
+	while ((count > 0) && (rq.part < rq.parts.size())) {
+		struct iovec &part = rq.parts[rq.part];
+		size_t step = std::min(count, part.iov_len);
+		part.iov_base = static_cast<char *>(part.iov_base) + step;
+		part.iov_len -= step;
+		count -= step;
+		if (part.iov_len == 0) {
+			rq.part++;
+		}
+	}
+}
+
+void os::linux::socket_linux::progress_write(std::vector<completion> &done)
+{
+	if (m_handshake != handshake::None) {
+		return;
+	}
+
+	while ((m_writes.size() > 0) && (m_fd >= 0)) {
+		request &rq = m_writes.front();
+		if ((rq.done < rq.length) && m_shm) {
+			if (m_hangup) {
+				fail_all(done, os::error::Disconnected);
+				return;
+			}
+			size_t count = rq.parts.empty() ? m_shm->write(rq.buffer + rq.done, rq.length - rq.done)
+							: m_shm->write(static_cast<const char *>(rq.parts[rq.part].iov_base), rq.parts[rq.part].iov_len);
+			if (count > 0) {
+				consume(rq, count);
+			} else if (m_shm->is_broken()) {
+				fail_all(done, os::error::Disconnected);
+				reset_connection();
+				return;
+			} else {
+				return;
+			}
+		} else if (rq.done < rq.length) {
+			ssize_t ret;
+			if (rq.parts.empty()) {
+				ret = ::send(m_fd, rq.buffer + rq.done, rq.length - rq.done, MSG_NOSIGNAL);
+			} else {
+				msghdr mh = {};
+				mh.msg_iov = rq.parts.data() + rq.part;
+				mh.msg_iovlen = std::min<size_t>(rq.parts.size() - rq.part, IOV_MAX);
+				ret = sendmsg(m_fd, &mh, MSG_NOSIGNAL);
+			}
+			if (ret >= 0) {
+				consume(rq, size_t(ret));
+			} else if (errno == EINTR) {
+				continue;
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				return;
+			} else {
+				fail_all(done, os::error::Disconnected);
+				return;
+			}
+		}
+
+		if (rq.done == rq.length) {
+			done.push_back({std::move(rq.op), os::error::Success, rq.length});
+			m_writes.pop_front();
+		}
+	}
+}
+
+void os::linux::socket_linux::fail_all(std::vector<completion> &done, os::error ec)
+{
+	connected = false;
+	for (request &rq : m_reads) {
+		done.push_back({std::move(rq.op), ec, rq.done});
+	}
+	m_reads.clear();
+	for (request &rq : m_writes) {
+		done.push_back({std::move(rq.op), ec, rq.done});
+	}
+	m_writes.clear();
+}
+
+void os::linux::socket_linux::disconnect()
+{
+	std::vector<std::shared_ptr<os::linux::async_request>> dropped;
+
+	std::unique_lock<std::mutex> ul(m_lock);
+	connected = false;
+	for (request &rq : m_reads) {
+		dropped.push_back(std::move(rq.op));
+	}
+	m_reads.clear();
+	for (request &rq : m_writes) {
+		dropped.push_back(std::move(rq.op));
+	}
+	m_writes.clear();
+	reset_connection();
+
+	// Wait for callbacks that are still running elsewhere, unless we are
+	// being called from one of them.
+	m_cv.wait(ul, [this]() { return !m_processing || (m_processing_thread == std::this_thread::get_id()); });
+	ul.unlock();
+
+	// Wake up anyone still waiting on the dropped operations.
+	for (auto &op : dropped) {
+		op->abandon(os::error::Disconnected);
+	}
+}
+
+bool os::linux::socket_linux::cancel(os::linux::async_request *op)
+{
+	std::shared_ptr<os::linux::async_request> found;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		if (m_accept.get() == op) {
+			found = std::move(m_accept);
+			m_accept = nullptr;
+		}
+		for (auto *queue : {&m_reads, &m_writes}) {
+			for (auto it = queue->begin(); it != queue->end(); it++) {
+				// Partially transferred messages can't be taken back.
+				if ((it->op.get() == op) && (it->done == 0)) {
+					found = std::move(it->op);
+					queue->erase(it);
+					break;
+				}
+			}
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+	found->abandon(os::error::Error);
+	return true;
+}
+
+bool os::linux::socket_linux::is_shared_memory()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_shm != nullptr;
+}
+
+uint8_t os::linux::socket_linux::get_wire_version()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_wire_version;
+}
+
+bool os::linux::socket_linux::is_batch_supported()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_batch;
+}
+
+bool os::linux::socket_linux::is_stream_supported()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_stream;
+}
+
+bool os::linux::socket_linux::is_deadline_supported()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_deadline;
+}
+
+bool os::linux::socket_linux::is_cancel_supported()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return m_cancel;
+}
+
+bool os::linux::socket_linux::is_created()
+{
+	return created;
+}
+
+bool os::linux::socket_linux::is_connected()
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	return connected;
+}
+
+void os::linux::socket_linux::set_connected(bool is_connected)
+{
+	std::unique_lock<std::mutex> ul(m_lock);
+	connected = is_connected;
+}
+
+void os::linux::socket_linux::handle_accept_callback(os::error code, size_t length)
+{
+	if (code == os::error::Connected || code == os::error::Success) {
+		set_connected(true);
+	} else {
+		set_connected(false);
+	}
+}
+
+os::error os::linux::socket_linux::accept(std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb)
+{
+	if (!is_created()) {
+		return os::error::Error;
+	}
+
+	std::shared_ptr<os::linux::async_request> ar;
+	{
+		std::unique_lock<std::mutex> ul(m_lock);
+		if (m_fd >= 0) {
+			return os::error::Connected;
+		} else if (m_accept) {
+			// Already waiting for a client.
+			return os::error::Pending;
+		}
+
+		ar = prepare(op, cb, std::bind(&os::linux::socket_linux::handle_accept_callback, this, std::placeholders::_1, std::placeholders::_2));
+		ar->owner = weak_from_this();
+		m_accept = ar;
+		m_listener->wait(shared_from_this());
+	}
+
+	process(0);
+	return ar->is_complete() ? os::error::Connected : os::error::Pending;
+}
@@ -0,0 +1,221 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef SOCKET_LINUX_H
+#define SOCKET_LINUX_H
+
+#include "../include/ipc.hpp"
+#include "../include/ipc-socket.hpp"
+#include "async_request.hpp"
+#include "epoll-loop.hpp"
+#include "shm-channel.hpp"
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace os {
+namespace linux {
+class socket_linux;
+
+/** Listening Unix domain socket, shared by every server side instance.
+ *
+ * It is registered with the epoll loop once, and wakes every instance that
+ * waits for a client when a connection comes in. Whichever instance accepts
+ * it first gets it, the others keep waiting.
+ */
+struct listener : public std::enable_shared_from_this<listener> {
+	int fd = -1;
+	std::string path;
+	// Identity of the socket file, so only our own is removed.
+	dev_t dev = 0;
+	ino_t ino = 0;
+
+	listener(const std::string &path);
+	~listener();
+
+	void wait(const std::shared_ptr<socket_linux> &socket);
+	void stop_waiting(socket_linux *socket);
+
+private:
+	std::mutex lock;
+	bool registered = false;
+	// Raw pointers for comparing, they are never dereferenced.
+	std::vector<std::pair<socket_linux *, std::weak_ptr<socket_linux>>> waiting;
+
+	void notify();
+};
+
+/** Stream socket over an AF_UNIX SOCK_STREAM connection.
+ *
+ * All I/O is non-blocking and driven by the shared epoll loop in edge
+ * triggered mode. Operations complete in the order they were issued and their
+ * callbacks are called from whichever thread finishes them, which is usually
+ * the loop thread. Instances must be created through create() since the loop
+ * only holds weak references to them.
+ *
+ * Every connection starts with a small handshake in which the client may offer
+ * a shared memory channel. If the server maps it, all further data goes through
+ * the shared rings and the stream only serves to detect the peer going away.
+ * Otherwise both sides keep using the stream.
+ */
+class socket_linux : public ipc::socket, public std::enable_shared_from_this<socket_linux> {
+public:
+	static std::shared_ptr<os::linux::socket_linux> create(os::create_only_t, const std::string &name);
+	static std::shared_ptr<os::linux::socket_linux> create(os::open_only_t, const std::string &name);
+
+	/** Size of each shared memory ring offered by clients and accepted by
+	 * servers, 0 disables the shared memory transport. Affects connections
+	 * established afterwards.
+	 */
+	static void set_shared_memory(size_t capacity);
+
+	// Newest wire format offered by clients and accepted by servers.
+	static void set_wire_version(uint8_t version);
+
+	socket_linux(os::create_only_t, const std::string &name);
+	socket_linux(os::open_only_t, const std::string &name);
+	socket_linux(std::shared_ptr<listener> listener);
+	~socket_linux();
+
+	// Another server side instance accepting clients on the same path.
+	std::shared_ptr<os::linux::socket_linux> create_sibling();
+
+	/** Writes go out in order, except that a frame written with a lane, see
+	 * ipc::priority, moves ahead of the queued frames of lower lanes that
+	 * did not start yet. It never passes a frame written in_order, and each
+	 * frame is passed at most max_overtaken times so lower lanes still move.
+	 */
+	static const int in_order = -1;
+	static const size_t max_overtaken = 64;
+
+	os::error read(char *buffer, size_t buffer_length, std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb);
+	os::error write(const char *buffer, size_t buffer_length, std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb, int lane = in_order);
+
+	// Gathered write of the parts in order, they have to stay valid until the
+	// callback runs.
+	os::error write(const std::vector<ipc::span<const char>> &parts, std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb, int lane = in_order);
+
+	// Drop the connection and any pending operation without calling their
+	// callbacks. Waits for callbacks currently running on other threads.
+	void disconnect();
+
+	bool cancel(os::linux::async_request *op);
+
+	// Whether the connection negotiated the shared memory transport.
+	bool is_shared_memory();
+
+	// Wire format both sides agreed on. Clients use ipc::wire_v1 until the
+	// server has answered the handshake.
+	uint8_t get_wire_version();
+
+	// Whether the peer takes batch frames, see ipc::frame_batch.
+	bool is_batch_supported();
+
+	// Whether the peer takes stream and credit frames, see ipc::frame_stream.
+	bool is_stream_supported();
+
+	// Whether the peer takes calls with a deadline, see function_call::deadline.
+	bool is_deadline_supported();
+
+	// Whether the peer takes cancel frames, see ipc::frame_cancel.
+	bool is_cancel_supported();
+
+	virtual void handle_accept_callback(os::error code, size_t length) override;
+	virtual bool is_created() override;
+	virtual bool is_connected() override;
+	virtual void set_connected(bool is_connected) override;
+	virtual os::error accept(std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb) override;
+
+private:
+	struct request {
+		std::shared_ptr<os::linux::async_request> op;
+		char *buffer;
+		size_t length;
+		size_t done;
+		// Set for gathered writes instead of buffer, the parts already sent
+		// are dropped from the front.
+		std::vector<struct iovec> parts;
+		size_t part = 0;
+		int lane = in_order;
+		size_t overtaken = 0;
+	};
+	struct completion {
+		std::shared_ptr<os::linux::async_request> op;
+		os::error ec;
+		size_t length;
+	};
+
+	enum class handshake { None, AwaitHello, AwaitAck };
+
+	std::shared_ptr<listener> m_listener;
+	int m_fd = -1;
+	bool created = false;
+	bool connected = false;
+
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+	bool m_processing = false;
+	bool m_dirty = false;
+	uint32_t m_events = 0;
+	bool m_hangup = false;
+	std::thread::id m_processing_thread;
+
+	handshake m_handshake = handshake::None;
+	char m_hs_buffer[16];
+	size_t m_hs_done = 0;
+	std::vector<int> m_hs_fds;
+	std::shared_ptr<os::linux::shm_channel> m_shm_offer;
+	std::shared_ptr<os::linux::shm_channel> m_shm;
+	uint8_t m_wire_version = ipc::wire_v1;
+	bool m_batch = false;
+	bool m_stream = false;
+	bool m_deadline = false;
+	bool m_cancel = false;
+
+	std::shared_ptr<os::linux::async_request> m_accept;
+	std::deque<request> m_reads;
+	std::deque<request> m_writes;
+	void enqueue_write(request rq);
+
+	void attach(int fd);
+	void process(uint32_t events);
+	void send_hello();
+
+	friend struct listener;
+	void use_channel(std::shared_ptr<os::linux::shm_channel> channel);
+	void reset_connection();
+	void progress_accept(std::vector<completion> &done);
+	void progress_handshake(std::vector<completion> &done);
+	void progress_read(std::vector<completion> &done);
+	void progress_write(std::vector<completion> &done);
+	static void consume(request &rq, size_t count);
+	void fail_all(std::vector<completion> &done, os::error ec);
+	static std::shared_ptr<os::linux::async_request> prepare(std::shared_ptr<os::async_op> &op, os::async_op_cb_t cb,
+								 os::async_op_cb_t system_cb = nullptr);
+};
+}
+}
+
+#endif
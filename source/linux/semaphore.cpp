@@ -0,0 +1,62 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "semaphore.hpp"
+#include <errno.h>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+os::linux::semaphore::semaphore(int32_t initial_count /*= 0*/, int32_t maximum_count /*= INT32_MAX*/)
+{
+	if (initial_count > maximum_count) {
+		throw std::invalid_argument("initial_count can't be larger than maximum_count");
+	} else if (maximum_count == 0) {
+		throw std::invalid_argument("maximum_count can't be 0");
+	}
+
+	handle = eventfd(uint32_t(initial_count), EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+	if (handle < 0) {
+		throw std::runtime_error("Semaphore creation failed with error code " + std::to_string(errno) + ".");
+	}
+}
+
+os::linux::semaphore::~semaphore()
+{
+	if (handle >= 0) {
+		close(handle);
+	}
+}
+
+os::error os::linux::semaphore::signal(uint32_t count /*= 1*/)
+{
+	uint64_t value = count;
+	if (::write(handle, &value, sizeof(value)) < 0) {
+		if (errno == EAGAIN) {
+			return os::error::TooMuchData;
+		}
+		return os::error::Error;
+	}
+	return os::error::Success;
+}
+
+void *os::linux::semaphore::get_waitable()
+{
+	return reinterpret_cast<void *>(intptr_t(handle));
+}
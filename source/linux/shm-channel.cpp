@@ -0,0 +1,276 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#include "shm-channel.hpp"
+#include <algorithm>
+#include <errno.h>
+#include <new>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/ipc.hpp"
+
+#define SHM_MAGIC 0x4d48534c // 'LSHM'
+#define SHM_VERSION 1
+
+struct os::linux::shm_channel::ring {
+	// Total bytes ever written and read. Each counter has a single writer.
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+	// Set by the consumer before it sleeps on an empty ring, and by the
+	// producer before it sleeps on a full ring.
+	alignas(64) std::atomic<uint32_t> reader_waiting;
+	alignas(64) std::atomic<uint32_t> writer_waiting;
+};
+
+struct os::linux::shm_channel::layout {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	ring rings[2];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared rings need address free 64-bit atomics.");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared rings need address free 32-bit atomics.");
+
+// Ring data starts on its own page after the control block.
+static const size_t data_offset = 4096;
+
+inline void close_descriptor(int &fd)
+{
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+std::shared_ptr<os::linux::shm_channel> os::linux::shm_channel::create(size_t capacity)
+{
+	if ((capacity == 0) || ((capacity & (capacity - 1)) != 0)) {
+		ipc::log("Shared memory ring capacity %zu is not a power of two.", capacity);
+		return nullptr;
+	}
+
+	std::shared_ptr<shm_channel> channel(new shm_channel());
+	channel->m_capacity = capacity;
+	channel->m_size = data_offset + capacity * 2;
+
+	channel->m_memory = memfd_create("lib-streamlabs-ipc", MFD_CLOEXEC);
+	if (channel->m_memory < 0) {
+		ipc::log("Creating shared memory failed with error %d.", errno);
+		return nullptr;
+	}
+	if (ftruncate(channel->m_memory, off_t(channel->m_size)) < 0) {
+		ipc::log("Resizing shared memory failed with error %d.", errno);
+		return nullptr;
+	}
+
+	channel->m_server_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	channel->m_client_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if ((channel->m_server_wake < 0) || (channel->m_client_wake < 0)) {
+		ipc::log("Creating shared memory events failed with error %d.", errno);
+		return nullptr;
+	}
+
+	if (!channel->map(false)) {
+		return nullptr;
+	}
+
+	layout *header = new (channel->m_base) layout();
+	header->magic = SHM_MAGIC;
+	header->version = SHM_VERSION;
+	header->capacity = capacity;
+	return channel;
+}
+
+std::shared_ptr<os::linux::shm_channel> os::linux::shm_channel::open(int memory, int server_wake, int client_wake)
+{
+	std::shared_ptr<shm_channel> channel(new shm_channel());
+	channel->m_memory = memory;
+	channel->m_server_wake = server_wake;
+	channel->m_client_wake = client_wake;
+
+	struct stat st;
+	if ((memory < 0) || (server_wake < 0) || (client_wake < 0) || (fstat(memory, &st) < 0) || (size_t(st.st_size) <= data_offset)) {
+		return nullptr;
+	}
+
+	channel->m_size = size_t(st.st_size);
+	channel->m_capacity = (channel->m_size - data_offset) / 2;
+	if (!channel->map(true)) {
+		return nullptr;
+	}
+
+	layout *header = reinterpret_cast<layout *>(channel->m_base);
+	if ((header->magic != SHM_MAGIC) || (header->version != SHM_VERSION) || (header->capacity != channel->m_capacity) ||
+	    ((channel->m_capacity & (channel->m_capacity - 1)) != 0)) {
+		ipc::log("Received shared memory region is not valid.");
+		return nullptr;
+	}
+	return channel;
+}
+
+os::linux::shm_channel::~shm_channel()
+{
+	if (m_base) {
+		munmap(m_base, m_size);
+	}
+	close_descriptor(m_memory);
+	close_descriptor(m_server_wake);
+	close_descriptor(m_client_wake);
+}
+
+bool os::linux::shm_channel::map(bool is_server)
+{
+	static_assert(sizeof(layout) <= data_offset, "Control block must fit in front of the ring data.");
+
+	void *base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_memory, 0);
+	if (base == MAP_FAILED) {
+		ipc::log("Mapping shared memory failed with error %d.", errno);
+		return false;
+	}
+
+	m_base = base;
+	m_is_server = is_server;
+
+	layout *header = reinterpret_cast<layout *>(m_base);
+	char *data = reinterpret_cast<char *>(m_base) + data_offset;
+	size_t tx = is_server ? 1 : 0;
+	size_t rx = is_server ? 0 : 1;
+	m_tx = &header->rings[tx];
+	m_tx_data = data + tx * m_capacity;
+	m_rx = &header->rings[rx];
+	m_rx_data = data + rx * m_capacity;
+	m_wake = is_server ? m_server_wake : m_client_wake;
+	m_peer = is_server ? m_client_wake : m_server_wake;
+	return true;
+}
+
+void os::linux::shm_channel::signal_peer()
+{
+	uint64_t one = 1;
+	if (::write(m_peer, &one, sizeof(one)) < 0) {
+		// The counter is drained on every wake up, it can't overflow.
+	}
+}
+
+bool os::linux::shm_channel::check_used(uint64_t used)
+{
+	// The counters live in memory the peer can write to. If they are more
+	// than a ring apart, copying would run past the ring.
+	if (used > m_capacity) {
+		if (!m_broken) {
+			ipc::log("Shared memory ring counters are out of range, dropping the connection.");
+		}
+		m_broken = true;
+	}
+	return !m_broken;
+}
+
+size_t os::linux::shm_channel::write(const char *buffer, size_t length)
+{
+	uint64_t head = m_tx->head.load(std::memory_order_relaxed);
+	uint64_t used = head - m_tx->tail.load(std::memory_order_acquire);
+	if (!check_used(used)) {
+		return 0;
+	}
+	size_t space = m_capacity - size_t(used);
+	if (space == 0) {
+		// Announce that we are going to sleep, then check again so that a
+		// consumer which didn't see the flag yet can't be missed.
+		m_tx->writer_waiting.store(1);
+		used = head - m_tx->tail.load();
+		if (!check_used(used)) {
+			return 0;
+		}
+		space = m_capacity - size_t(used);
+		if (space == 0) {
+			return 0;
+		}
+	}
+
+	size_t count = std::min(length, space);
+	size_t offset = size_t(head) & (m_capacity - 1);
+	size_t first = std::min(count, m_capacity - offset);
+	memcpy(m_tx_data + offset, buffer, first);
+	memcpy(m_tx_data, buffer + first, count - first);
+	m_tx->head.store(head + count);
+
+	if (m_tx->reader_waiting.load() && m_tx->reader_waiting.exchange(0)) {
+		signal_peer();
+	}
+	return count;
+}
+
+size_t os::linux::shm_channel::read(char *buffer, size_t length)
+{
+	uint64_t tail = m_rx->tail.load(std::memory_order_relaxed);
+	uint64_t available = m_rx->head.load(std::memory_order_acquire) - tail;
+	if (!check_used(available)) {
+		return 0;
+	}
+	if (available == 0) {
+		m_rx->reader_waiting.store(1);
+		available = m_rx->head.load() - tail;
+		if (!check_used(available) || (available == 0)) {
+			return 0;
+		}
+	}
+
+	size_t count = std::min(length, size_t(available));
+	size_t offset = size_t(tail) & (m_capacity - 1);
+	size_t first = std::min(count, m_capacity - offset);
+	memcpy(buffer, m_rx_data + offset, first);
+	memcpy(buffer + first, m_rx_data, count - first);
+	m_rx->tail.store(tail + count);
+
+	if (m_rx->writer_waiting.load() && m_rx->writer_waiting.exchange(0)) {
+		signal_peer();
+	}
+	return count;
+}
+
+bool os::linux::shm_channel::is_broken()
+{
+	return m_broken;
+}
+
+int os::linux::shm_channel::get_wake()
+{
+	return m_wake;
+}
+
+void os::linux::shm_channel::drain_wake()
+{
+	uint64_t value;
+	while (::read(m_wake, &value, sizeof(value)) > 0) {
+	}
+}
+
+void os::linux::shm_channel::get_descriptors(int (&fds)[3])
+{
+	fds[0] = m_memory;
+	fds[1] = m_server_wake;
+	fds[2] = m_client_wake;
+}
+
+size_t os::linux::shm_channel::get_capacity()
+{
+	return m_capacity;
+}
@@ -0,0 +1,101 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+#ifndef OS_LINUX_SHM_CHANNEL_HPP
+#define OS_LINUX_SHM_CHANNEL_HPP
+
+#include <atomic>
+#include <inttypes.h>
+#include <memory>
+#include <stddef.h>
+
+namespace os {
+namespace linux {
+/** Pair of single producer/single consumer byte rings in shared memory.
+ *
+ * The client creates the region with memfd_create() and hands the descriptors
+ * to the server over the Unix socket. The client produces into the first ring
+ * and the server into the second one. Both sides have an eventfd which the
+ * other side writes to, but only when the owner announced that it is about to
+ * sleep on an empty (read) or full (write) ring. Busy connections therefore
+ * move data without any system call.
+ */
+class shm_channel {
+public:
+	// Default size of each ring, a power of two.
+	static const size_t default_capacity = 1024 * 1024;
+
+	// Create a new region as the client. Returns nullptr if shared memory is not available.
+	static std::shared_ptr<shm_channel> create(size_t capacity);
+
+	// Map a region received from a client. Takes ownership of the descriptors
+	// in any case, returns nullptr if they don't describe a valid region.
+	static std::shared_ptr<shm_channel> open(int memory, int server_wake, int client_wake);
+
+	~shm_channel();
+
+	// Copy up to length bytes into the outgoing ring, returns the number of bytes copied.
+	size_t write(const char *buffer, size_t length);
+
+	// Copy up to length bytes out of the incoming ring, returns the number of bytes copied.
+	size_t read(char *buffer, size_t length);
+
+	// Whether the peer left the ring counters in a state no valid peer can,
+	// read() and write() copy nothing from then on.
+	bool is_broken();
+
+	// Descriptor signaled when this side has something to do.
+	int get_wake();
+
+	// Reset the wake descriptor after it was signaled.
+	void drain_wake();
+
+	// Descriptors for open(): memory, server wake and client wake.
+	void get_descriptors(int (&fds)[3]);
+
+	size_t get_capacity();
+
+private:
+	struct ring;
+	struct layout;
+
+	int m_memory = -1;
+	int m_server_wake = -1;
+	int m_client_wake = -1;
+	bool m_is_server = false;
+
+	void *m_base = nullptr;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+	bool m_broken = false;
+
+	ring *m_tx = nullptr;
+	char *m_tx_data = nullptr;
+	ring *m_rx = nullptr;
+	char *m_rx_data = nullptr;
+	int m_wake = -1;
+	int m_peer = -1;
+
+	shm_channel() = default;
+	bool map(bool is_server);
+	void signal_peer();
+	bool check_used(uint64_t used);
+};
+} // namespace linux
+} // namespace os
+
+#endif // OS_LINUX_SHM_CHANNEL_HPP
@@ -0,0 +1,154 @@
+/******************************************************************************
+    Copyright (C) 2016-2019 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "async_op.hpp"
+#include "waitable.hpp"
+#include <errno.h>
+#include <poll.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <unistd.h>
+
+static inline int to_fd(os::waitable *item)
+{
+	return int(reinterpret_cast<intptr_t>(item->get_waitable()));
+}
+
+// Async operations stay signalled once complete (like a manual reset event),
+// everything else is a counting semaphore and needs to be decremented.
+static inline bool try_acquire(os::waitable *item, int fd)
+{
+	if (dynamic_cast<os::async_op *>(item)) {
+		return true;
+	}
+
+	uint64_t value;
+	return ::read(fd, &value, sizeof(value)) == sizeof(value);
+}
+
+static inline int remaining_ms(std::chrono::steady_clock::time_point deadline, bool infinite)
+{
+	if (infinite) {
+		return -1;
+	}
+
+	auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+	if (left < 0) {
+		left = 0;
+	}
+	return int(left);
+}
+
+os::error os::waitable::wait(waitable *item, std::chrono::nanoseconds timeout)
+{
+	os::async_op *aop = dynamic_cast<os::async_op *>(item);
+	if (aop && aop->is_complete()) {
+		aop->call_callback();
+		return os::error::Success;
+	}
+
+	int fd = to_fd(item);
+	bool infinite = timeout.count() < 0;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+
+	while (true) {
+		pollfd pfd = {fd, POLLIN, 0};
+		int result = poll(&pfd, 1, remaining_ms(deadline, infinite));
+		if (result < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return os::error::Error;
+		} else if (result == 0) {
+			return os::error::TimedOut;
+		}
+
+		if (try_acquire(item, fd)) {
+			if (aop) {
+				aop->call_callback();
+			}
+			return os::error::Success;
+		}
+		// Someone else took the count, keep waiting.
+	}
+}
+
+os::error os::waitable::wait(waitable *item)
+{
+	return wait(item, std::chrono::nanoseconds(-1));
+}
+
+os::error os::waitable::wait_any(waitable **items, size_t items_count, size_t &signalled_index, std::chrono::nanoseconds timeout)
+{
+	if (items == nullptr) {
+		throw std::invalid_argument("'items' can't be nullptr.");
+	}
+
+	std::vector<pollfd> fds;
+	std::vector<size_t> idxToTrueIdx;
+	fds.reserve(items_count);
+	idxToTrueIdx.reserve(items_count);
+	for (size_t idx = 0; idx < items_count; idx++) {
+		waitable *obj = items[idx];
+		if (!obj) {
+			continue;
+		}
+
+		os::async_op *aop = dynamic_cast<os::async_op *>(obj);
+		if (aop && aop->is_complete()) {
+			signalled_index = idx;
+			aop->call_callback();
+			return os::error::Success;
+		}
+
+		fds.push_back({to_fd(obj), POLLIN, 0});
+		idxToTrueIdx.push_back(idx);
+	}
+
+	bool infinite = timeout.count() < 0;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+
+	while (true) {
+		int result = poll(fds.data(), nfds_t(fds.size()), remaining_ms(deadline, infinite));
+		if (result < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return os::error::Error;
+		} else if (result == 0) {
+			signalled_index = -1;
+			return os::error::TimedOut;
+		}
+
+		for (size_t idx = 0; idx < fds.size(); idx++) {
+			if ((fds[idx].revents & POLLIN) == 0) {
+				continue;
+			}
+
+			waitable *obj = items[idxToTrueIdx[idx]];
+			if (try_acquire(obj, fds[idx].fd)) {
+				signalled_index = idxToTrueIdx[idx];
+				os::async_op *aop = dynamic_cast<os::async_op *>(obj);
+				if (aop) {
+					aop->call_callback();
+				}
+				return os::error::Success;
+			}
+		}
+	}
+}
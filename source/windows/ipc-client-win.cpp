@@ -3,6 +3,8 @@
 #include <set>
 
 #include "ipc-client-win.hpp"
+#include "../include/ipc-buffer-pool.hpp"
+#include "../include/ipc-wait-slot.hpp"
 #include "semaphore.hpp"
 
 call_return_t g_fn = NULL;
@@ -79,11 +81,12 @@ bool ipc::client_win::call(const std::string &cname, const std::string &fname, s
 	fnc_call_msg.arguments = std::move(args);
 
 	// Serialize
-	std::vector<char> buf(fnc_call_msg.size() + sizeof(ipc_size_t));
+	std::vector<char> buf = ipc::buffer_pool::acquire(fnc_call_msg.size() + sizeof(ipc_size_t));
 	try {
 		fnc_call_msg.serialize(buf, sizeof(ipc_size_t));
 	} catch (std::exception &e) {
 		ipc::log("(write) %8llu: Failed to serialize, error %s.", fnc_call_msg.uid.value_union.ui64, e.what());
+		ipc::buffer_pool::release(std::move(buf));
 		throw e;
 	}
 
@@ -98,6 +101,7 @@ bool ipc::client_win::call(const std::string &cname, const std::string &fname, s
 	if (ec != os::error::Success && ec != os::error::Pending) {
 		cancel(cbid);
 		//write_op->cancel();
+		ipc::buffer_pool::release(std::move(buf));
 		return false;
 	}
 
@@ -112,6 +116,8 @@ bool ipc::client_win::call(const std::string &cname, const std::string &fname, s
 		return false;
 	}
 
+	// Only reused once the write is known to be done with it.
+	ipc::buffer_pool::release(std::move(buf));
 	return true;
 }
 
@@ -119,8 +125,8 @@ std::vector<ipc::value> ipc::client_win::call_synchronous_helper(const std::stri
 {
 	// Set up call reference data.
 	struct CallData {
-		std::shared_ptr<os::windows::semaphore> sgn = std::make_shared<os::windows::semaphore>();
-		bool called = false;
+		ipc::wait_slot *slot = &ipc::wait_slot::local();
+		std::atomic_bool called = false;
 		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
 		std::vector<ipc::value> values;
@@ -133,8 +139,10 @@ std::vector<ipc::value> ipc::client_win::call_synchronous_helper(const std::stri
 		cd.values.reserve(rval.size());
 		std::copy(rval.begin(), rval.end(), std::back_inserter(cd.values));
 
+		// The waiter may return as soon as it sees the flag.
+		ipc::wait_slot *slot = cd.slot;
 		cd.called = true;
-		cd.sgn->signal();
+		slot->signal();
 	};
 
 	int64_t cbid = 0;
@@ -145,8 +153,8 @@ std::vector<ipc::value> ipc::client_win::call_synchronous_helper(const std::stri
 
 	static std::chrono::nanoseconds freez_timeout = std::chrono::seconds(1);
 	bool freez_flagged = false;
-	while (cd.sgn->wait(freez_timeout) == os::error::TimedOut) {
-		if (freez_flagged)
+	while (!cd.called) {
+		if (cd.slot->wait(freez_timeout) || freez_flagged)
 			continue;
 		freez_flagged = true;
 
@@ -164,6 +172,7 @@ std::vector<ipc::value> ipc::client_win::call_synchronous_helper(const std::stri
 		cancel(cbid);
 		return {};
 	}
+	m_metrics.get(cname + "::" + fname).record(std::chrono::high_resolution_clock::now() - cd.start);
 	return std::move(cd.values);
 }
 
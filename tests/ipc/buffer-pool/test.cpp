@@ -0,0 +1,103 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include "ipc-buffer-pool.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Runs synchronous calls with growing payloads and reports how the buffer
+// pool served them, together with the number of heap allocations per call
+// left in the whole call path.
+
+#ifdef _WIN32
+#define CONN "BufferPoolIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-buffer-pool"
+#endif
+#define CALLS 2000
+
+static std::atomic<uint64_t> g_allocations(0);
+
+void *operator new(size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	void *ptr = malloc(size ? size : 1);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept
+{
+	free(ptr);
+}
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static size_t run(std::shared_ptr<ipc::client> client, size_t payload)
+{
+	std::vector<char> data(payload, 'x');
+
+	// Warm up the caches and the function id.
+	for (size_t idx = 0; idx < 16; idx++) {
+		client->call_synchronous_helper("Bench", "Echo", {ipc::value(data)});
+	}
+
+	ipc::buffer_pool::statistics before = ipc::buffer_pool::get_statistics();
+	uint64_t allocations = g_allocations.load();
+	size_t errors = 0;
+	for (size_t idx = 0; idx < CALLS; idx++) {
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Echo", {ipc::value(data)});
+		if ((rval.size() != 2) || (rval[1].value_bin() != data)) {
+			errors++;
+		}
+	}
+	allocations = g_allocations.load() - allocations;
+	ipc::buffer_pool::statistics after = ipc::buffer_pool::get_statistics();
+
+	printf("%8zu | %8llu %8llu | %8llu | %10.2f | %6zu\n", payload, (unsigned long long)(after.hits - before.hits),
+	       (unsigned long long)(after.misses - before.misses), (unsigned long long)after.high_water, double(allocations) / CALLS, errors);
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{ipc::type::Binary}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	size_t errors = 0;
+	printf(" Payload |     Hits   Misses | HighWater | Allocs/call | Errors\n");
+	for (size_t payload : {16, 1024, 64 * 1024, 1024 * 1024}) {
+		errors += run(client, payload);
+	}
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
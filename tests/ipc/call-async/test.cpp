@@ -0,0 +1,97 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// One thread keeps a window of call_async() futures in flight and collects
+// them in order. Width 1 is the same pattern as call_synchronous_helper().
+
+#ifdef _WIN32
+#define CONN "CallAsyncIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-call-async"
+#endif
+#define DURATION std::chrono::seconds(1)
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static size_t run_sync(std::shared_ptr<ipc::client> client)
+{
+	size_t completed = 0, errors = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	while (std::chrono::high_resolution_clock::now() < start + DURATION) {
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Echo", {ipc::value(uint64_t(completed))});
+		errors += (rval.size() == 2 && rval[1].value_union.ui64 == completed) ? 0 : 1;
+		completed++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf(" sync | %12.0f | %6zu\n", completed / seconds, errors);
+	return errors;
+}
+
+static size_t run_async(std::shared_ptr<ipc::client> client, size_t width)
+{
+	std::deque<ipc::call_future> window;
+	size_t issued = 0, completed = 0, errors = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto end = start + DURATION;
+	while (std::chrono::high_resolution_clock::now() < end || !window.empty()) {
+		if (window.size() < width && std::chrono::high_resolution_clock::now() < end) {
+			window.push_back(client->call_async("Bench", "Echo", {ipc::value(uint64_t(issued++))}));
+			continue;
+		}
+		std::vector<ipc::value> rval = window.front().get();
+		window.pop_front();
+		errors += (rval.size() == 2 && rval[1].value_union.ui64 == completed) ? 0 : 1;
+		completed++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("%5zu | %12.0f | %6zu\n", width, completed / seconds, errors);
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{ipc::type::UInt64}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	printf("Width |      Calls/s | Errors\n");
+	size_t errors = run_sync(client);
+	for (size_t width : {1, 4, 16, 64, 256}) {
+		errors += run_async(client, width);
+	}
+
+	// Continuations run on the reply thread.
+	size_t chained = 0;
+	ipc::call_future future = client->call_async("Bench", "Echo", {ipc::value(uint64_t(7))});
+	future.then([&chained](std::vector<ipc::value> &rval) { chained = rval.size() == 2 ? rval[1].value_union.ui64 : 0; });
+	future.wait();
+	printf("\nContinuation %s\n", chained == 7 ? "ok" : "failed");
+	errors += (chained == 7) ? 0 : 1;
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
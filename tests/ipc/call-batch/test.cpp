@@ -0,0 +1,109 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Compares N synchronous calls made one after the other with the same N calls
+// sent as a single batch. One call of every batch targets a function that does
+// not exist, so its entry must hold an error while the others succeed.
+
+#ifdef _WIN32
+#define CONN "CallBatchIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-call-batch"
+#endif
+#define ROUNDS 200
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static std::vector<ipc::client::call_spec> make_calls(size_t count)
+{
+	std::vector<ipc::client::call_spec> calls;
+	for (size_t idx = 0; idx < count; idx++) {
+		if (idx == count / 2) {
+			calls.push_back({"Bench", "Missing", {ipc::value(uint64_t(idx))}});
+		} else {
+			calls.push_back({"Bench", "Echo", {ipc::value(uint64_t(idx))}});
+		}
+	}
+	return calls;
+}
+
+// Counts the entries that do not look like the reply to their call.
+static size_t check(const std::vector<std::vector<ipc::value>> &results, size_t count)
+{
+	size_t errors = (results.size() == count) ? 0 : 1;
+	for (size_t idx = 0; idx < results.size(); idx++) {
+		const std::vector<ipc::value> &rval = results[idx];
+		if (idx == count / 2) {
+			errors += (rval.size() == 1 && rval[0].type == ipc::type::Null && rval[0].value_str.size() > 0) ? 0 : 1;
+		} else {
+			errors += (rval.size() == 2 && rval[1].value_union.ui64 == idx) ? 0 : 1;
+		}
+	}
+	return errors;
+}
+
+static size_t run(std::shared_ptr<ipc::client> client, size_t count)
+{
+	size_t errors = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t round = 0; round < ROUNDS; round++) {
+		std::vector<std::vector<ipc::value>> results;
+		for (ipc::client::call_spec &spec : make_calls(count)) {
+			results.push_back(client->call_synchronous_helper(spec.cname, spec.fname, spec.args));
+		}
+		errors += check(results, count);
+	}
+	double serial = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t round = 0; round < ROUNDS; round++) {
+		errors += check(client->call_batch(make_calls(count)), count);
+	}
+	double batched = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+	printf("%5zu | %11.1f | %10.1f | %7.2fx | %6zu\n", count, serial, batched, serial / batched, errors);
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{ipc::type::UInt64}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	// Settles the connection handshake and the function ids before measuring.
+	client->call_synchronous_helper("Bench", "Echo", {ipc::value(uint64_t(0))});
+	client->call_synchronous_helper("Bench", "Echo", {ipc::value(uint64_t(0))});
+
+	size_t errors = 0;
+	printf("Calls | Serial (us) | Batch (us) | Speedup | Errors\n");
+	for (size_t count : {1, 10, 50, 100, 200}) {
+		errors += run(client, count);
+	}
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include "ipc-cancellation.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Long running enumerations the client abandons shortly after starting them.
+// Without cancellation the server finishes every one of them, with it the
+// queued ones are dropped and the running ones stop at their next check.
+// Work is counted in slices of handler time.
+
+#ifdef _WIN32
+#define CONN "CallCancelIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-call-cancel"
+#endif
+#define CALLS 16
+#define SLICES 100
+#define SLICE_TIME std::chrono::microseconds(500)
+#define ABANDON_AFTER std::chrono::milliseconds(5)
+
+static std::atomic<size_t> g_slices = 0;
+
+static void enumerate(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	const ipc::cancellation_token &token = ipc::cancellation_token::current();
+	for (size_t idx = 0; (idx < SLICES) && !token.is_cancelled(); idx++) {
+		auto end = std::chrono::steady_clock::now() + SLICE_TIME;
+		while (std::chrono::steady_clock::now() < end) {
+		}
+		g_slices++;
+	}
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static void ignore_reply(void *data, const std::vector<ipc::value> &rval) {}
+
+static size_t run(const char *mode, std::shared_ptr<ipc::client> client, bool cancel)
+{
+	g_slices = 0;
+	std::vector<int64_t> ids(CALLS);
+	for (int64_t &cbid : ids) {
+		client->call("Bench", "Enumerate", {}, ignore_reply, nullptr, cbid);
+	}
+	std::this_thread::sleep_for(ABANDON_AFTER);
+	if (cancel) {
+		for (int64_t cbid : ids) {
+			client->cancel_call(cbid);
+		}
+	}
+
+	// Echo only gets through once the executor threads are free again.
+	auto start = std::chrono::steady_clock::now();
+	size_t errors = (client->call_synchronous_helper("Bench", "Echo", {}).size() == 1) ? 0 : 1;
+	double next = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Let whatever still runs finish before counting.
+	std::this_thread::sleep_for(std::chrono::milliseconds(CALLS * SLICES / 2));
+	printf("%-8s | %12.1f | %6zu of %d\n", mode, next, g_slices.load(), CALLS * SLICES);
+
+	// Abandoned calls still do all their work, cancelled ones must not.
+	if (cancel) {
+		errors += (g_slices < CALLS * SLICES) ? 0 : 1;
+	} else {
+		errors += (g_slices == CALLS * SLICES) ? 0 : 1;
+	}
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Enumerate", std::vector<ipc::type>{}, enumerate));
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.set_executor_threads(2);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	printf("Mode     | Next call ms | Slices of work\n");
+	size_t errors = run("abandon", client, false);
+	errors += run("cancel", client, true);
+
+	ipc::server::cancel_statistics stats = server.get_cancel_statistics();
+	printf("\nServer dropped %llu queued calls and cancelled %llu running handlers\n", (unsigned long long)stats.cancelled_calls,
+	       (unsigned long long)stats.cancelled_handlers);
+	errors += (stats.cancelled_calls + stats.cancelled_handlers > 0) ? 0 : 1;
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A burst of calls to a slow handler, as when the UI fires requests and moves
+// on. Without deadlines the server works through all of them and a call made
+// right after the burst waits behind the backlog. With deadlines the calls
+// the client gave up on are dropped and the next call gets through quickly.
+
+#ifdef _WIN32
+#define CONN "CallDeadlineIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-call-deadline"
+#endif
+#define BURST 200
+#define HANDLER_TIME std::chrono::milliseconds(1)
+#define DEADLINE std::chrono::milliseconds(20)
+
+static std::atomic<size_t> g_handled = 0;
+
+static void slow(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	std::this_thread::sleep_for(HANDLER_TIME);
+	g_handled++;
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+struct burst {
+	std::mutex lock;
+	std::condition_variable cv;
+	size_t pending = 0;
+	size_t expired = 0;
+	size_t errors = 0;
+};
+
+static void on_reply(void *data, const std::vector<ipc::value> &rval)
+{
+	burst *b = static_cast<burst *>(data);
+	std::unique_lock<std::mutex> ul(b->lock);
+	if ((rval.size() == 1) && (rval[0].type == ipc::type::Null) && (rval[0].value_str == IPC_DEADLINE_EXCEEDED)) {
+		b->expired++;
+	} else if ((rval.size() != 1) || (rval[0].type != ipc::type::UInt64)) {
+		b->errors++;
+	}
+	b->pending--;
+	b->cv.notify_all();
+}
+
+static size_t run(const char *mode, std::shared_ptr<ipc::client> client, bool deadlines)
+{
+	burst b;
+	g_handled = 0;
+	int64_t cbid = 0;
+	b.pending = BURST;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < BURST; idx++) {
+		if (deadlines) {
+			client->call_with_deadline("Bench", "Slow", {}, std::chrono::steady_clock::now() + DEADLINE, on_reply, &b, cbid);
+		} else {
+			client->call("Bench", "Slow", {}, on_reply, &b, cbid);
+		}
+	}
+
+	// The call the user is waiting for now.
+	auto probe_start = std::chrono::steady_clock::now();
+	size_t errors = (client->call_synchronous_helper("Bench", "Slow", {}).size() == 1) ? 0 : 1;
+	double probe = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - probe_start).count();
+
+	std::unique_lock<std::mutex> ul(b.lock);
+	b.cv.wait(ul, [&b]() { return b.pending == 0; });
+	double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%-10s | %12.1f | %9.1f | %8zu | %7zu\n", mode, probe, total, g_handled.load() - 1, b.expired);
+
+	// Without deadlines every call runs, with them the backlog has to shrink.
+	if (deadlines) {
+		errors += (b.expired > 0) ? 0 : 1;
+	} else {
+		errors += (b.expired == 0 && g_handled == BURST + 1) ? 0 : 1;
+	}
+	return errors + b.errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Slow", std::vector<ipc::type>{}, slow));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.set_executor_threads(1);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	printf("Mode       | Next call ms | Burst ms  | Handled  | Expired\n");
+	size_t errors = run("plain", client, false);
+	errors += run("deadline", client, true);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<ipc::value> rval = client->call_synchronous_with_deadline("Bench", "Slow", {}, start + std::chrono::microseconds(200));
+	double waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	bool expired = (rval.size() == 1) && (rval[0].value_str == IPC_DEADLINE_EXCEEDED);
+	printf("\nSynchronous call with 0.2 ms deadline returned after %.2f ms: %s\n", waited, expired ? "expired" : "completed");
+	errors += expired ? 0 : 1;
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	ipc::server::deadline_statistics stats = server.get_deadline_statistics();
+	printf("Server dropped %llu calls before running them, %llu replies after\n", (unsigned long long)stats.expired_calls,
+	       (unsigned long long)stats.expired_replies);
+	errors += (stats.expired_calls > 0) ? 0 : 1;
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
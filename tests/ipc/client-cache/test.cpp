@@ -0,0 +1,116 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures synchronous reads of a cacheable getter with the client cache off
+// and on, then how long it takes the client to see a change once the server
+// invalidates the getter.
+
+#ifdef _WIN32
+#define CONN "ClientCacheIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-client-cache"
+#endif
+#define DURATION std::chrono::seconds(1)
+#define SOURCES 16
+#define CHANGES 200
+
+static std::atomic<uint64_t> g_state = 0;
+
+static void get_settings(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(ipc::value(g_state.load()));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static size_t read_rate(const char *mode, std::shared_ptr<ipc::client> client)
+{
+	size_t calls = 0, errors = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (std::chrono::steady_clock::now() < start + DURATION) {
+		std::string name = "source_" + std::to_string(calls % SOURCES);
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "GetSettings", {ipc::value(name)});
+		if ((rval.size() != 2) || (rval[1].value_union.ui64 != g_state.load())) {
+			errors++;
+		}
+		calls++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-10s | %12.0f | %6zu\n", mode, calls / seconds, errors);
+	return errors;
+}
+
+static size_t invalidation_latency(ipc::server &server, std::shared_ptr<ipc::client> client)
+{
+	std::vector<double> latencies;
+	size_t stale = 0, errors = 0;
+	for (size_t idx = 0; idx < CHANGES; idx++) {
+		client->call_synchronous_helper("Bench", "GetSettings", {ipc::value(std::string("source_0"))});
+		uint64_t state = ++g_state;
+		auto start = std::chrono::steady_clock::now();
+		server.invalidate("Bench", "GetSettings");
+		// The change has to show up, if only after a few stale reads.
+		while (true) {
+			std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "GetSettings", {ipc::value(std::string("source_0"))});
+			if ((rval.size() == 2) && (rval[1].value_union.ui64 == state)) {
+				break;
+			}
+			if (std::chrono::steady_clock::now() > start + std::chrono::seconds(1)) {
+				errors++;
+				break;
+			}
+			stale++;
+		}
+		latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+	}
+	std::sort(latencies.begin(), latencies.end());
+	printf("\nChange visible after p50 %.1f us, p99 %.1f us, %zu stale reads in %d changes\n", latencies[latencies.size() / 2],
+	       latencies[latencies.size() * 99 / 100], stale, CHANGES);
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	std::shared_ptr<ipc::function> getter = std::make_shared<ipc::function>("GetSettings", std::vector<ipc::type>{ipc::type::String}, get_settings);
+	getter->set_cacheable(true);
+	collection->register_function(getter);
+	server.register_collection(collection);
+	server.set_cache_capacity(0);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	printf("Mode       |      Calls/s | Errors\n");
+	client->set_cache_capacity(0);
+	size_t errors = read_rate("uncached", client);
+	client->set_cache_capacity(1024);
+	errors += read_rate("cached", client);
+
+	errors += invalidation_latency(server, client);
+
+	ipc::reply_cache::statistics stats = client->cache_statistics();
+	printf("Client hits %llu, misses %llu, invalidations %llu\n", (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+	       (unsigned long long)stats.invalidations);
+	errors += (stats.hits > 0 && stats.invalidations > 0) ? 0 : 1;
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include "ipc.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Memory and speed of argument vectors of typical size: a few scalars and a
+// short name, as most calls send.
+
+#define DURATION std::chrono::milliseconds(500)
+#define VECTORS 100000
+
+static std::atomic<size_t> g_allocations{0};
+static std::atomic<size_t> g_bytes{0};
+
+void *operator new(size_t size)
+{
+	g_allocations++;
+	g_bytes += size;
+	if (void *ptr = malloc(size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+static std::vector<ipc::value> make_arguments(uint64_t idx)
+{
+	std::vector<ipc::value> args;
+	args.reserve(4);
+	args.push_back(ipc::value(idx));
+	args.push_back(ipc::value(std::string("scene_item_14")));
+	args.push_back(ipc::value(1.5));
+	args.push_back(ipc::value(uint32_t(3)));
+	return args;
+}
+
+// Whether |args| still holds what make_arguments(|idx|) put in.
+static bool intact(const std::vector<ipc::value> &args, uint64_t idx)
+{
+	return (args.size() == 4) && (args[0].type == ipc::type::UInt64) && (args[0].value_union.ui64 == idx) && (args[1].type == ipc::type::String) &&
+	       (args[1].value_str == "scene_item_14") && (args[2].type == ipc::type::Double) && (args[2].value_union.fp64 == 1.5) &&
+	       (args[3].type == ipc::type::UInt32) && (args[3].value_union.ui32 == 3);
+}
+
+template<typename F> static double rate(F fn)
+{
+	size_t count = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	auto end = start + DURATION;
+	do {
+		for (size_t idx = 0; idx < 64; idx++) {
+			fn();
+		}
+		count += 64;
+	} while (std::chrono::high_resolution_clock::now() < end);
+	return count / std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+	printf("sizeof(ipc::value): %zu bytes\n\n", sizeof(ipc::value));
+
+	size_t allocations = g_allocations, bytes = g_bytes;
+	std::vector<std::vector<ipc::value>> calls;
+	calls.reserve(VECTORS);
+	for (uint64_t idx = 0; idx < VECTORS; idx++) {
+		calls.push_back(make_arguments(idx));
+	}
+	printf("Per argument vector: %.1f allocations, %.0f heap bytes\n\n", double(g_allocations - allocations) / VECTORS,
+	       double(g_bytes - bytes) / VECTORS);
+
+	ipc::message::function_call call;
+	call.uid = ipc::value(uint64_t(1));
+	call.class_name = ipc::value(uint32_t(7));
+	call.function_name = ipc::value();
+	call.arguments = make_arguments(1);
+	std::vector<char> buffer(call.size_v2());
+	call.serialize_v2(buffer, 0);
+
+	uint64_t counter = 0;
+	double build = rate([&]() { counter += make_arguments(counter).size(); });
+	double copy = rate([&]() {
+		std::vector<ipc::value> args = calls[counter++ % VECTORS];
+		counter += args.size();
+	});
+	double move = rate([&]() {
+		std::vector<ipc::value> args = make_arguments(counter);
+		std::vector<ipc::value> moved;
+		moved.reserve(args.size());
+		for (ipc::value &arg : args) {
+			moved.push_back(std::move(arg));
+		}
+		counter += moved.size();
+	});
+	double decode = rate([&]() {
+		ipc::message::function_call_view view;
+		view.deserialize_v2(buffer, 0);
+		std::vector<ipc::value> args;
+		args.reserve(view.arguments.size());
+		for (const ipc::value_view &arg : view.arguments) {
+			args.push_back(arg.to_value());
+		}
+		counter += args.size();
+	});
+
+	printf("Operation        | Vectors/s\n");
+	printf("build            | %9.0f\n", build);
+	printf("copy             | %9.0f\n", copy);
+	printf("move elements    | %9.0f\n", move);
+	printf("decode to values | %9.0f\n", decode);
+
+	// Copying, moving and decoding keep the values intact.
+	size_t errors = 0;
+	std::vector<ipc::value> copied = calls[VECTORS - 1];
+	errors += (intact(copied, VECTORS - 1) && intact(calls[VECTORS - 1], VECTORS - 1)) ? 0 : 1;
+	std::vector<ipc::value> moved;
+	for (ipc::value &arg : copied) {
+		moved.push_back(std::move(arg));
+	}
+	errors += intact(moved, VECTORS - 1) ? 0 : 1;
+	ipc::message::function_call_view view;
+	view.deserialize_v2(buffer, 0);
+	std::vector<ipc::value> decoded;
+	for (const ipc::value_view &arg : view.arguments) {
+		decoded.push_back(arg.to_value());
+	}
+	errors += intact(decoded, 1) ? 0 : 1;
+	printf("\nValues: %s\n", errors == 0 ? "ok" : "failed");
+
+	return (errors == 0 && counter != 0) ? 0 : 1;
+}
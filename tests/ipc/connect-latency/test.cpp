@@ -0,0 +1,83 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+// Measures how long a fresh client takes from connecting to its first reply,
+// including the server noticing the previous client left, and how much CPU
+// an idle server uses with and without a connected client.
+
+#ifdef _WIN32
+#define CONN "ConnectLatencyIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-connect-latency"
+#endif
+#define CONNECTIONS 200
+#define IDLE std::chrono::seconds(2)
+
+static void ping(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static size_t connect_latency()
+{
+	std::vector<double> samples;
+	size_t errors = 0;
+	for (size_t idx = 0; idx < CONNECTIONS; idx++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Ping", {});
+		samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count());
+		if (rval.size() != 1) {
+			errors++;
+		}
+		client->stop();
+	}
+
+	std::sort(samples.begin(), samples.end());
+	printf("Connect to first reply (us): p50 %.1f, p99 %.1f, max %.1f, errors %zu\n", samples[samples.size() / 2], samples[samples.size() * 99 / 100],
+	       samples.back(), errors);
+	return errors;
+}
+
+static void idle_cpu(const char *name)
+{
+	std::clock_t start = std::clock();
+	std::this_thread::sleep_for(IDLE);
+	double cpu = double(std::clock() - start) / CLOCKS_PER_SEC;
+	printf("Idle CPU %-18s: %.3f ms per second\n", name, cpu * 1000.0 / std::chrono::duration<double>(IDLE).count());
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Ping", ping));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	size_t errors = connect_latency();
+	idle_cpu("(no client)");
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+	errors += (client->call_synchronous_helper("Bench", "Ping", {}).size() == 1) ? 0 : 1;
+	idle_cpu("(one client)");
+	client->stop();
+
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
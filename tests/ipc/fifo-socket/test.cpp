@@ -0,0 +1,138 @@
+#ifdef _WIN32
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+	printf("The FIFO socket is only used on macOS, nothing to measure here.\n");
+	return 0;
+}
+#else
+#include "apple/ipc-socket-osx.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Measures small-call round trips over the POSIX FIFO socket that the macOS
+// transport uses. It builds on Linux as well. "reopen" opens and closes the
+// pipe around every message the way the socket used to, "persistent" goes
+// through socket_osx, which keeps the pipes open.
+
+#define CONN "/tmp/lib-streamlabs-ipc-fifo-socket"
+#define HEADER 8
+
+struct reopen_pipe {
+	std::string name_req = std::string(CONN) + "-req";
+	std::string name_rep = std::string(CONN) + "-rep";
+	// Keeps the pipes from dropping data while neither side has them open.
+	int anchor_req = open(name_req.c_str(), O_RDWR);
+	int anchor_rep = open(name_rep.c_str(), O_RDWR);
+
+	~reopen_pipe()
+	{
+		close(anchor_req);
+		close(anchor_rep);
+	}
+
+	bool read(char *buffer, size_t length, SocketType t)
+	{
+		int fd = open(t == REQUEST ? name_req.c_str() : name_rep.c_str(), O_RDWR);
+		size_t offset = 0;
+		while (fd >= 0 && offset < length) {
+			ssize_t ret = ::read(fd, buffer + offset, length - offset);
+			if (ret <= 0)
+				break;
+			offset += ret;
+		}
+		close(fd);
+		return offset == length;
+	}
+
+	bool write(const char *buffer, size_t length, SocketType t)
+	{
+		int fd = open(t == REQUEST ? name_req.c_str() : name_rep.c_str(), O_WRONLY | O_DSYNC);
+		size_t offset = 0;
+		while (fd >= 0 && offset < length) {
+			ssize_t ret = ::write(fd, buffer + offset, length - offset);
+			if (ret <= 0)
+				break;
+			offset += ret;
+		}
+		close(fd);
+		return offset == length;
+	}
+};
+
+struct persistent_pipe {
+	std::unique_ptr<os::apple::socket_osx> socket = os::apple::socket_osx::create(os::open_only, CONN);
+
+	bool read(char *buffer, size_t length, SocketType t) { return socket->read(buffer, length, t) == (uint32_t)os::error::Success; }
+
+	bool write(const char *buffer, size_t length, SocketType t) { return socket->write(buffer, length, t) == (uint32_t)os::error::Success; }
+};
+
+template<typename pipe_t> static size_t run(const char *mode, size_t size, size_t count)
+{
+	pid_t pid = fork();
+	if (pid == 0) {
+		// Server: echo every request back as the reply.
+		pipe_t pipe;
+		std::vector<char> buffer(HEADER + size);
+		for (size_t idx = 0; idx < count; idx++) {
+			if (!pipe.read(buffer.data(), HEADER, REQUEST) || !pipe.read(buffer.data() + HEADER, size, REQUEST) ||
+			    !pipe.write(buffer.data(), buffer.size(), REPLY))
+				_exit(1);
+		}
+		_exit(0);
+	}
+
+	pipe_t pipe;
+	std::vector<char> buffer(HEADER + size, 'x');
+	std::vector<double> latencies;
+	latencies.reserve(count);
+	size_t errors = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t idx = 0; idx < count; idx++) {
+		auto call_start = std::chrono::high_resolution_clock::now();
+		if (!pipe.write(buffer.data(), buffer.size(), REQUEST) || !pipe.read(buffer.data(), HEADER, REPLY) ||
+		    !pipe.read(buffer.data() + HEADER, size, REPLY)) {
+			errors++;
+			break;
+		}
+		latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - call_start).count());
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		errors++;
+
+	std::sort(latencies.begin(), latencies.end());
+	double p50 = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+	double p99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+	printf("%-10s | %7zu | %13.0f | %7.1f %7.1f | %6zu\n", mode, size, latencies.size() / seconds, p50, p99, errors);
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	// Creates both pipes, the benchmark then opens them by name like a client.
+	std::unique_ptr<os::apple::socket_osx> server = os::apple::socket_osx::create(os::create_only, CONN);
+
+	size_t errors = 0;
+	printf("Mode       |   Bytes | Round trips/s | p50/p99 (us)    | Errors\n");
+	for (size_t size : {16, 1024, 65536}) {
+		size_t count = size > 4096 ? 2000 : 20000;
+		errors += run<reopen_pipe>("reopen", size, count);
+		errors += run<persistent_pipe>("persistent", size, count);
+	}
+
+	server->clean_file_descriptors();
+	return errors == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,134 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include "ipc-buffer-pool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#ifdef __linux__
+#include "linux/ipc-socket-linux.hpp"
+#endif
+
+// Compares serializing a call with one large binary argument into a single
+// buffer against laying it out for a gathered write, then measures echo
+// round trips where the binary goes out gathered both ways. On Linux the
+// round trips run again over the plain socket, without shared memory.
+
+#ifdef _WIN32
+#define CONN "GatherWriteIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-gather-write"
+#endif
+#define DURATION std::chrono::milliseconds(500)
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static ipc::message::function_call make_call(size_t size)
+{
+	ipc::message::function_call call;
+	call.uid = ipc::value((uint64_t)1);
+	call.class_name = ipc::value("Bench");
+	call.function_name = ipc::value("Echo");
+	call.arguments.push_back(ipc::value(std::vector<char>(size, 'x')));
+	return call;
+}
+
+template<typename F> static double per_call_us(F fn)
+{
+	size_t count = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	auto end = start + DURATION;
+	do {
+		for (size_t idx = 0; idx < 16; idx++) {
+			fn();
+		}
+		count += 16;
+	} while (std::chrono::high_resolution_clock::now() < end);
+	return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / count;
+}
+
+// Echoes payloads of every size for a while, returns the bad replies.
+static size_t run_echo(std::shared_ptr<ipc::client> client, const std::vector<size_t> &sizes)
+{
+	size_t failed = 0;
+	printf("\nBytes    | Round trips/s |   MiB/s | Errors\n");
+	for (size_t size : sizes) {
+		std::vector<char> payload(size, 'y');
+		size_t errors = 0;
+		size_t count = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		auto end = start + DURATION;
+		do {
+			std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Echo", {ipc::value(payload)});
+			if ((rval.size() != 2) || (rval[1].value_bin() != payload)) {
+				errors++;
+			}
+			count++;
+		} while (std::chrono::high_resolution_clock::now() < end);
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		printf("%8zu | %13.0f | %7.0f | %6zu\n", size, count / seconds, 2.0 * size * count / seconds / (1024 * 1024), errors);
+		failed += errors;
+	}
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<size_t> sizes = {256, 4096, 65536, 1024 * 1024, 16 * 1024 * 1024};
+
+	printf("Bytes    | Contiguous (us) | Gathered (us) | Parts\n");
+	for (size_t size : sizes) {
+		ipc::message::function_call call = make_call(size);
+		size_t parts = 0;
+		double contiguous = per_call_us([&]() {
+			std::vector<char> buffer = ipc::buffer_pool::acquire(call.size_v2() + sizeof(ipc::ipc_size_t));
+			call.serialize_v2(buffer, sizeof(ipc::ipc_size_t));
+			ipc::make_sendable(buffer, ipc::wire_v2);
+			ipc::buffer_pool::release(std::move(buffer));
+		});
+		double gathered = per_call_us([&]() {
+			ipc::message::gather out;
+			call.serialize(out, ipc::wire_v2);
+			out.make_sendable(ipc::wire_v2);
+			// Frames without references go out as plain buffers.
+			parts = out.references.empty() ? 1 : out.parts().size();
+			ipc::buffer_pool::release(std::move(out.head));
+		});
+		printf("%8zu | %15.2f | %13.2f | %5zu\n", size, contiguous, gathered, parts);
+	}
+
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{ipc::type::Binary}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	size_t failed = run_echo(client, sizes);
+	client->stop();
+
+#ifdef __linux__
+	// Connections made from now on stay on the socket.
+	os::linux::socket_linux::set_shared_memory(0);
+	client = ipc::client::create(CONN, []() {});
+	printf("\nWithout shared memory:");
+	failed += run_echo(client, sizes);
+	client->stop();
+#endif
+
+	server.finalize();
+	return failed == 0 ? 0 : 1;
+}
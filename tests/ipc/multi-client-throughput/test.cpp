@@ -0,0 +1,93 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Portable take on simple-multi-client: N clients connect at once and each
+// makes synchronous calls from its own thread. Reports the combined calls per
+// second, which should grow with the client count up to the number of cores.
+
+#ifdef _WIN32
+#define CONN "MultiClientThroughputIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-multi-client-throughput"
+#endif
+#define DURATION std::chrono::seconds(1)
+#define WORK std::chrono::microseconds(20)
+
+// Stands in for a handler doing real work.
+static void work(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	auto end = std::chrono::high_resolution_clock::now() + WORK;
+	while (std::chrono::high_resolution_clock::now() < end) {
+	}
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static size_t run(size_t count)
+{
+	std::vector<std::shared_ptr<ipc::client>> clients;
+	for (size_t idx = 0; idx < count; idx++) {
+		clients.push_back(ipc::client::create(CONN, []() {}));
+	}
+
+	std::atomic<uint64_t> calls(0), errors(0);
+	std::vector<std::thread> threads;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (auto &client : clients) {
+		threads.emplace_back([&client, &calls, &errors, start]() {
+			uint64_t idx = 0;
+			while (std::chrono::high_resolution_clock::now() < start + DURATION) {
+				std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Work", {ipc::value(idx)});
+				if ((rval.size() != 2) || (rval[1].value_union.ui64 != idx)) {
+					errors++;
+				}
+				idx++;
+				calls++;
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	for (auto &client : clients) {
+		client->stop();
+	}
+	printf("%7zu | %10.0f | %6llu\n", count, calls / seconds, (unsigned long long)errors.load());
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Work", std::vector<ipc::type>{ipc::type::UInt64}, work));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.set_executor_threads();
+	server.initialize(CONN);
+
+	size_t errors = 0;
+	printf("Clients |    Calls/s | Errors\n");
+	for (size_t count : {1, 2, 4, 8, 16}) {
+		errors += run(count);
+	}
+
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include "ipc-metrics.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Measures calls per second on a single connection while keeping a fixed
+// number of calls in flight. Depth 1 is the classic request/reply pattern.
+// Afterwards the metrics of both ends have to account for every call, and the
+// histogram has to keep its precision around powers of two.
+
+#ifdef _WIN32
+#define CONN "PipelinedCallsIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-pipelined-calls"
+#endif
+#define DURATION std::chrono::seconds(1)
+#define SYNC_CALLS 1000
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+struct window {
+	std::mutex lock;
+	std::condition_variable cv;
+	size_t in_flight = 0;
+	size_t completed = 0;
+	size_t errors = 0;
+};
+
+static void on_reply(void *data, const std::vector<ipc::value> &rval)
+{
+	window *wnd = static_cast<window *>(data);
+	std::unique_lock<std::mutex> ul(wnd->lock);
+	if (rval.size() != 2) {
+		wnd->errors++;
+	}
+	wnd->in_flight--;
+	wnd->completed++;
+	wnd->cv.notify_all();
+}
+
+static size_t run(std::shared_ptr<ipc::client> client, size_t depth, size_t &calls)
+{
+	window wnd;
+	uint64_t idx = 0;
+	int64_t cbid = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto end = start + DURATION;
+	while (std::chrono::high_resolution_clock::now() < end) {
+		{
+			std::unique_lock<std::mutex> ul(wnd.lock);
+			wnd.cv.wait(ul, [&wnd, depth]() { return wnd.in_flight < depth; });
+			wnd.in_flight++;
+		}
+		if (!client->call("Bench", "Echo", {ipc::value(idx++)}, on_reply, &wnd, cbid)) {
+			std::unique_lock<std::mutex> ul(wnd.lock);
+			wnd.in_flight--;
+			wnd.errors++;
+			break;
+		}
+	}
+
+	std::unique_lock<std::mutex> ul(wnd.lock);
+	wnd.cv.wait(ul, [&wnd]() { return wnd.in_flight == 0; });
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("%5zu | %12.0f | %6zu\n", depth, wnd.completed / seconds, wnd.errors);
+	calls += wnd.completed;
+	return wnd.errors;
+}
+
+// Percentiles can only grow, and none can exceed the slowest call.
+static bool ordered(const ipc::latency_summary &summary)
+{
+	return (summary.p50 <= summary.p99) && (summary.p99 <= summary.p999) && (summary.p999 <= summary.max);
+}
+
+// Next to one value that sets the maximum far away, the median of a value
+// reports the top of its bucket, which must not be more than 1/16 above it.
+static size_t run_histogram()
+{
+	size_t errors = 0;
+	for (uint64_t exponent = 0; exponent < 39; exponent++) {
+		uint64_t edge = uint64_t(1) << exponent;
+		for (uint64_t value : {edge - 1, edge, edge + 1}) {
+			ipc::histogram hist;
+			hist.record(std::chrono::nanoseconds(value));
+			hist.record(std::chrono::nanoseconds(value));
+			hist.record(std::chrono::hours(1));
+			uint64_t p50 = uint64_t(hist.summarize().p50.count());
+			if ((p50 < value) || (p50 - value > value / 16)) {
+				printf("Histogram reports %llu for %llu\n", (unsigned long long)p50, (unsigned long long)value);
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{ipc::type::UInt64}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	size_t errors = 0;
+	size_t calls = 0;
+	printf("Depth |      Calls/s | Errors\n");
+	for (size_t depth : {1, 2, 4, 8, 16, 32, 64, 128, 256}) {
+		errors += run(client, depth, calls);
+	}
+
+	// The client only times synchronous round trips.
+	for (uint64_t idx = 0; idx < SYNC_CALLS; idx++) {
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Echo", {ipc::value(idx)});
+		errors += (rval.size() == 2) ? 0 : 1;
+	}
+	calls += SYNC_CALLS;
+
+	printf("\nFunction         |      Calls | Handler p50/p99/p999 (us)    | Queue p50/p99 (us)\n");
+	for (auto &entry : server.snapshot_metrics()) {
+		const ipc::function_summary &m = entry.second;
+		printf("%-16s | %10llu | %8.1f %8.1f %8.1f   | %8.1f %8.1f\n", entry.first.c_str(), (unsigned long long)m.handler.count, m.handler.p50.count() / 1e3,
+		       m.handler.p99.count() / 1e3, m.handler.p999.count() / 1e3, m.queue_wait.p50.count() / 1e3, m.queue_wait.p99.count() / 1e3);
+		errors += (ordered(m.handler) && ordered(m.queue_wait) && ordered(m.serialize)) ? 0 : 1;
+	}
+	ipc::function_summary server_echo = server.snapshot_metrics()["Bench::Echo"];
+	ipc::latency_summary client_echo = client->snapshot_metrics()["Bench::Echo"];
+	printf("\nCalls made %zu, counted by the server %llu, synchronous %d, counted by the client %llu\n", calls,
+	       (unsigned long long)server_echo.handler.count, SYNC_CALLS, (unsigned long long)client_echo.count);
+	errors += (server_echo.handler.count == calls) ? 0 : 1;
+	errors += ((client_echo.count == SYNC_CALLS) && ordered(client_echo)) ? 0 : 1;
+
+	size_t histogram_errors = run_histogram();
+	printf("Histogram bucket bounds: %s\n", histogram_errors == 0 ? "ok" : "off");
+	errors += histogram_errors;
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
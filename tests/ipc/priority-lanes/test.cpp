@@ -0,0 +1,163 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Latency of small calls while the same connection keeps the executor busy
+// with a backlog of slow bulk calls. In one lane the probes queue behind the
+// backlog, with lanes they wait for the next free worker, whether the client
+// asks for the lane or the functions were registered with it.
+
+#ifdef _WIN32
+#define CONN "PriorityLanesIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-priority-lanes"
+#endif
+#define BACKLOG 64
+#define PROBES 50
+#define WORK_TIME std::chrono::milliseconds(1)
+#define PROBE_INTERVAL std::chrono::milliseconds(5)
+
+static void work(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	std::this_thread::sleep_for(WORK_TIME);
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+struct flood {
+	std::mutex lock;
+	std::condition_variable cv;
+	size_t in_flight = 0;
+	size_t errors = 0;
+	std::atomic_bool stop = false;
+};
+
+static void on_work(void *data, const std::vector<ipc::value> &rval)
+{
+	flood *fl = static_cast<flood *>(data);
+	std::unique_lock<std::mutex> ul(fl->lock);
+	if (rval.size() != 1) {
+		fl->errors++;
+	}
+	fl->in_flight--;
+	fl->cv.notify_all();
+}
+
+// Keeps BACKLOG calls of |fname| queued, in |lane| if given.
+static void run_flood(std::shared_ptr<ipc::client> client, const char *fname, const ipc::priority *lane, flood *fl)
+{
+	int64_t cbid = 0;
+	while (!fl->stop) {
+		{
+			std::unique_lock<std::mutex> ul(fl->lock);
+			fl->cv.wait(ul, [fl]() { return fl->in_flight < BACKLOG; });
+			fl->in_flight++;
+		}
+		bool sent;
+		if (lane) {
+			ipc::priority_scope scope(*lane);
+			sent = client->call("Bench", fname, {}, on_work, fl, cbid);
+		} else {
+			sent = client->call("Bench", fname, {}, on_work, fl, cbid);
+		}
+		if (!sent) {
+			std::unique_lock<std::mutex> ul(fl->lock);
+			fl->in_flight--;
+			fl->errors++;
+			break;
+		}
+	}
+
+	std::unique_lock<std::mutex> ul(fl->lock);
+	fl->cv.wait(ul, [fl]() { return fl->in_flight == 0; });
+}
+
+static size_t run(const char *mode, std::shared_ptr<ipc::client> client, const char *bulk, const char *probe, bool scoped)
+{
+	const ipc::priority bulk_lane = ipc::priority::bulk;
+	flood fl;
+	std::thread flooder(run_flood, client, bulk, scoped ? &bulk_lane : nullptr, &fl);
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	std::vector<double> latencies;
+	size_t errors = 0;
+	for (size_t idx = 0; idx < PROBES; idx++) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<ipc::value> rval;
+		if (scoped) {
+			ipc::priority_scope scope(ipc::priority::interactive);
+			rval = client->call_synchronous_helper("Bench", probe, {});
+		} else {
+			rval = client->call_synchronous_helper("Bench", probe, {});
+		}
+		errors += (rval.size() == 1) ? 0 : 1;
+		latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		std::this_thread::sleep_for(PROBE_INTERVAL);
+	}
+
+	fl.stop = true;
+	flooder.join();
+
+	std::sort(latencies.begin(), latencies.end());
+	printf("%-10s | %8.2f %8.2f %8.2f\n", mode, latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+	return errors + fl.errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Work", std::vector<ipc::type>{}, work));
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{}, echo));
+
+	std::shared_ptr<ipc::function> bulk = std::make_shared<ipc::function>("BulkWork", std::vector<ipc::type>{}, work);
+	bulk->set_priority(ipc::priority::bulk);
+	collection->register_function(bulk);
+	std::shared_ptr<ipc::function> interactive = std::make_shared<ipc::function>("InteractiveEcho", std::vector<ipc::type>{}, echo);
+	interactive->set_priority(ipc::priority::interactive);
+	collection->register_function(interactive);
+
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.set_executor_threads(2);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	printf("Mode       | Probe p50/p99/max (ms)\n");
+	size_t errors = run("one lane", client, "Work", "Echo", false);
+	errors += run("client", client, "Work", "Echo", true);
+	errors += run("registered", client, "BulkWork", "InteractiveEcho", false);
+
+	printf("\nLane        |  Tasks | Peak depth | Wait p50/p99 (ms)\n");
+	for (auto &entry : server.snapshot_lanes()) {
+		const ipc::lane_summary &lane = entry.second;
+		printf("%-11s | %6llu | %10llu | %8.2f %8.2f\n", entry.first.c_str(), (unsigned long long)lane.queue_wait.count, (unsigned long long)lane.peak_depth,
+		       lane.queue_wait.p50.count() / 1e6, lane.queue_wait.p99.count() / 1e6);
+		// Each lane carried the calls of at least one of the modes.
+		errors += (lane.queue_wait.count > 0) ? 0 : 1;
+	}
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
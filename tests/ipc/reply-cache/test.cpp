@@ -0,0 +1,103 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures synchronous calls per second to a getter that takes a lock and
+// does some work, as getters reaching into the host application do. The same
+// calls run with the reply cache off, on, and on while the state keeps
+// changing and the getter's tag is invalidated after every few calls.
+
+#ifdef _WIN32
+#define CONN "ReplyCacheIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-reply-cache"
+#endif
+#define DURATION std::chrono::seconds(1)
+#define SOURCES 16
+#define HANDLER_WORK std::chrono::microseconds(20)
+
+static std::mutex g_state_lock;
+static uint64_t g_state = 0;
+
+static void get_settings(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	std::unique_lock<std::mutex> ul(g_state_lock);
+	auto end = std::chrono::steady_clock::now() + HANDLER_WORK;
+	while (std::chrono::steady_clock::now() < end) {
+	}
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(ipc::value(std::string(args[0].value_str) + "#" + std::to_string(g_state)));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static size_t run(const char *mode, ipc::server &server, std::shared_ptr<ipc::client> client, size_t invalidate_every)
+{
+	size_t calls = 0, stale = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (std::chrono::steady_clock::now() < start + DURATION) {
+		if (invalidate_every && (calls % invalidate_every == 0)) {
+			{
+				std::unique_lock<std::mutex> ul(g_state_lock);
+				g_state++;
+			}
+			server.invalidate_tag("settings");
+		}
+
+		std::string name = "source_" + std::to_string(calls % SOURCES);
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "GetSettings", {ipc::value(name)});
+		uint64_t state;
+		{
+			std::unique_lock<std::mutex> ul(g_state_lock);
+			state = g_state;
+		}
+		if ((rval.size() != 2) || (rval[1].value_str != name + "#" + std::to_string(state))) {
+			stale++;
+		}
+		calls++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-22s | %10.0f | %5zu\n", mode, calls / seconds, stale);
+	return stale;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	std::shared_ptr<ipc::function> getter = std::make_shared<ipc::function>("GetSettings", std::vector<ipc::type>{ipc::type::String}, get_settings);
+	collection->register_function(getter);
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	printf("Mode                   |    Calls/s | Stale\n");
+	size_t errors = run("uncached", server, client, 0);
+	getter->set_cacheable(true, {"settings"});
+	errors += run("cached", server, client, 0);
+	errors += run("cached, invalidate/64", server, client, 64);
+
+	ipc::reply_cache::statistics stats = server.cache_statistics();
+	printf("\nHits %llu, misses %llu, evictions %llu, invalidations %llu, entries %llu\n", (unsigned long long)stats.hits,
+	       (unsigned long long)stats.misses, (unsigned long long)stats.evictions, (unsigned long long)stats.invalidations,
+	       (unsigned long long)stats.entries);
+	// Replies of the cacheable getter have to come from the cache.
+	errors += (stats.hits > 0) ? 0 : 1;
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Two clients keep calls into a serial and into a normal collection in flight
+// while the server runs them on an executor. Calls into the serial one must
+// never overlap and must run in the order each client sent them, calls into
+// the normal one are expected to overlap.
+
+#ifdef _WIN32
+#define CONN "SerialCollectionIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-serial-collection"
+#endif
+#define CLIENTS 2
+#define CALLS 100
+#define WORK_TIME std::chrono::milliseconds(1)
+
+struct tracker {
+	std::atomic<size_t> inside = 0;
+	std::atomic<size_t> most_inside = 0;
+	std::mutex lock;
+	uint64_t next[CLIENTS] = {};
+	size_t out_of_order = 0;
+};
+
+static void work(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	tracker *tr = static_cast<tracker *>(data);
+	size_t inside = ++tr->inside;
+	size_t most = tr->most_inside;
+	while ((inside > most) && !tr->most_inside.compare_exchange_weak(most, inside)) {
+	}
+
+	{
+		std::unique_lock<std::mutex> ul(tr->lock);
+		uint64_t client = args[0].value_union.ui64;
+		uint64_t seq = args[1].value_union.ui64;
+		if (seq != tr->next[client]) {
+			tr->out_of_order++;
+		}
+		tr->next[client] = seq + 1;
+	}
+
+	std::this_thread::sleep_for(WORK_TIME);
+	tr->inside--;
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+struct pending {
+	std::mutex lock;
+	std::condition_variable cv;
+	size_t in_flight = 0;
+	size_t errors = 0;
+};
+
+static void on_work(void *data, const std::vector<ipc::value> &rval)
+{
+	pending *pd = static_cast<pending *>(data);
+	std::unique_lock<std::mutex> ul(pd->lock);
+	if (rval.size() != 1) {
+		pd->errors++;
+	}
+	pd->in_flight--;
+	pd->cv.notify_all();
+}
+
+// Sends all calls of one client without waiting for the replies in between.
+static size_t run_client(std::shared_ptr<ipc::client> client, const char *cname, uint64_t index)
+{
+	pending pd;
+	int64_t cbid = 0;
+	for (uint64_t seq = 0; seq < CALLS; seq++) {
+		{
+			std::unique_lock<std::mutex> ul(pd.lock);
+			pd.in_flight++;
+		}
+		if (!client->call(cname, "Work", {ipc::value(index), ipc::value(seq)}, on_work, &pd, cbid)) {
+			std::unique_lock<std::mutex> ul(pd.lock);
+			pd.in_flight--;
+			pd.errors++;
+			break;
+		}
+	}
+
+	std::unique_lock<std::mutex> ul(pd.lock);
+	pd.cv.wait(ul, [&pd]() { return pd.in_flight == 0; });
+	return pd.errors;
+}
+
+static size_t run(const char *cname, std::vector<std::shared_ptr<ipc::client>> &clients, tracker *tr, bool serial)
+{
+	std::vector<std::thread> threads;
+	std::vector<size_t> errors(clients.size());
+	auto start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < clients.size(); idx++) {
+		threads.emplace_back([&, idx]() { errors[idx] = run_client(clients[idx], cname, uint64_t(idx)); });
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	size_t failed = 0;
+	for (size_t count : errors) {
+		failed += count;
+	}
+	bool overlapped = tr->most_inside > 1;
+	printf("%-8s | %8.1f | %11zu | %12zu | %6zu\n", cname, ms, size_t(tr->most_inside), tr->out_of_order, failed);
+	if (serial) {
+		failed += overlapped ? 1 : 0;
+		failed += tr->out_of_order;
+	} else {
+		failed += overlapped ? 0 : 1;
+	}
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	tracker serial_tracker;
+	tracker normal_tracker;
+
+	ipc::server server;
+	std::shared_ptr<ipc::collection> serial = std::make_shared<ipc::collection>("Serial");
+	serial->register_function(std::make_shared<ipc::function>("Work", std::vector<ipc::type>{ipc::type::UInt64, ipc::type::UInt64}, work, &serial_tracker));
+	serial->set_serial(true);
+	server.register_collection(serial);
+	std::shared_ptr<ipc::collection> normal = std::make_shared<ipc::collection>("Normal");
+	normal->register_function(std::make_shared<ipc::function>("Work", std::vector<ipc::type>{ipc::type::UInt64, ipc::type::UInt64}, work, &normal_tracker));
+	server.register_collection(normal);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.set_executor_threads(4);
+	server.initialize(CONN);
+
+	std::vector<std::shared_ptr<ipc::client>> clients;
+	for (size_t idx = 0; idx < CLIENTS; idx++) {
+		clients.push_back(ipc::client::create(CONN, []() {}));
+	}
+
+	printf("Name     | Time(ms) | Most inside | Out of order | Errors\n");
+	size_t errors = run("Serial", clients, &serial_tracker, true);
+	errors += run("Normal", clients, &normal_tracker, false);
+
+	for (std::shared_ptr<ipc::client> &client : clients) {
+		client->stop();
+	}
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
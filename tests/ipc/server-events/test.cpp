@@ -0,0 +1,184 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A publisher updates a "levels" topic every 100us, like a volume meter.
+// Subscribed clients get the updates pushed, coalesced while they are busy,
+// which the slow client taking 1ms per event shows.
+// For comparison a client polls the same state 60 times per second. Age is
+// the time from the update to the client seeing it.
+
+#ifdef _WIN32
+#define CONN "ServerEventsIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-server-events"
+#endif
+#define DURATION std::chrono::seconds(1)
+#define INTERVAL std::chrono::microseconds(100)
+#define POLL_INTERVAL std::chrono::microseconds(16667)
+
+static uint64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Latest published state, for the polling client.
+static std::mutex g_lock;
+static uint64_t g_sequence = 0;
+static uint64_t g_published = 0;
+
+static void get_level(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	std::unique_lock<std::mutex> ul(g_lock);
+	rval.push_back(ipc::value(g_sequence));
+	rval.push_back(ipc::value(g_published));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+struct subscriber {
+	std::shared_ptr<ipc::client> client;
+	bool slow = false;
+	std::atomic<uint64_t> received = 0;
+	std::atomic<uint64_t> last = 0;
+	std::atomic<uint64_t> reordered = 0;
+	std::atomic<uint64_t> age_sum = 0;
+	std::atomic<uint64_t> age_max = 0;
+};
+
+static void on_levels(void *data, const std::string &topic, const std::vector<ipc::value> &values)
+{
+	subscriber *sub = static_cast<subscriber *>(data);
+	uint64_t age = now_ns() - values[1].value_union.ui64;
+	sub->received++;
+	if (values[0].value_union.ui64 <= sub->last) {
+		sub->reordered++;
+	}
+	sub->last = values[0].value_union.ui64;
+	sub->age_sum += age;
+	if (age > sub->age_max) {
+		sub->age_max = age;
+	}
+	if (sub->slow) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static size_t run(ipc::server &server, size_t count, bool slow)
+{
+	std::vector<std::unique_ptr<subscriber>> subs;
+	for (size_t idx = 0; idx < count; idx++) {
+		subs.push_back(std::make_unique<subscriber>());
+		subs.back()->client = ipc::client::create(CONN, []() {});
+		subs.back()->slow = slow;
+		if (!subs.back()->client->subscribe("levels", on_levels, subs.back().get())) {
+			printf("Subscribing failed\n");
+			return 1;
+		}
+	}
+
+	uint64_t published = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto next = start; next < start + DURATION; next += INTERVAL) {
+		std::this_thread::sleep_until(next);
+		published++;
+		{
+			std::unique_lock<std::mutex> ul(g_lock);
+			g_sequence = published;
+			g_published = now_ns();
+		}
+		server.publish("levels", {ipc::value(published), ipc::value(now_ns())});
+	}
+
+	// Every client ends up with the final state, seeing updates in order.
+	size_t errors = 0;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	for (auto &sub : subs) {
+		while (sub->last != published && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		errors += (sub->last == published && sub->reordered == 0) ? 0 : 1;
+	}
+
+	uint64_t received = 0, age_sum = 0, age_max = 0;
+	for (auto &sub : subs) {
+		received += sub->received;
+		age_sum += sub->age_sum;
+		age_max = std::max<uint64_t>(age_max, sub->age_max);
+		sub->client->unsubscribe("levels");
+		sub->client->stop();
+	}
+	printf("%s %3zu | %9llu | %9.0f | %8.1f | %8.1f\n", slow ? "slow" : "push", count, (unsigned long long)published, double(received) / count,
+	       double(age_sum) / received / 1e3, age_max / 1e3);
+	return errors;
+}
+
+static size_t poll(ipc::server &server)
+{
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+	std::atomic_bool stop = false;
+
+	std::thread publisher([&]() {
+		auto start = std::chrono::steady_clock::now();
+		for (auto next = start; !stop; next += INTERVAL) {
+			std::this_thread::sleep_until(next);
+			std::unique_lock<std::mutex> ul(g_lock);
+			g_sequence++;
+			g_published = now_ns();
+		}
+	});
+
+	uint64_t received = 0, age_sum = 0, age_max = 0;
+	size_t errors = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto next = start; next < start + DURATION; next += POLL_INTERVAL) {
+		std::this_thread::sleep_until(next);
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Level", {});
+		if (rval.size() != 2) {
+			errors++;
+			continue;
+		}
+		uint64_t age = now_ns() - rval[1].value_union.ui64;
+		received++;
+		age_sum += age;
+		age_max = std::max(age_max, age);
+	}
+	stop = true;
+	publisher.join();
+	client->stop();
+	printf("poll   1 | %9s | %9llu | %8.1f | %8.1f\n", "-", (unsigned long long)received, double(age_sum) / received / 1e3, age_max / 1e3);
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Level", std::vector<ipc::type>{}, get_level));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	size_t errors = 0;
+	printf("Clients  | Published |  Received | Age (us) |  Max (us)\n");
+	for (size_t count : {1, 4}) {
+		errors += run(server, count, false);
+	}
+	errors += run(server, 1, true);
+	errors += poll(server);
+
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#ifndef __linux__
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+	printf("The shared memory rings are only used on Linux, nothing to check here.\n");
+	return 0;
+}
+#else
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include "linux/ipc-socket-linux.hpp"
+#include "linux/shm-channel.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Checks that calls come back intact over the plain socket once shared memory
+// is turned off, and that a peer which scribbles over the ring counters gets
+// its connection dropped instead of having the rings read past their end.
+
+#define CONN "/tmp/lib-streamlabs-ipc-shm-ring"
+
+// Mirrors the control block in source/linux/shm-channel.cpp.
+struct ring {
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+	alignas(64) std::atomic<uint32_t> reader_waiting;
+	alignas(64) std::atomic<uint32_t> writer_waiting;
+};
+
+struct layout {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	ring rings[2];
+};
+
+static std::atomic<size_t> g_disconnects(0);
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id)
+{
+	g_disconnects++;
+}
+
+// Descriptors of the shared memory regions this process has open.
+static std::vector<int> find_regions()
+{
+	std::vector<int> fds;
+	DIR *dir = opendir("/proc/self/fd");
+	if (!dir) {
+		return fds;
+	}
+	while (struct dirent *entry = readdir(dir)) {
+		char target[256] = {};
+		std::string path = std::string("/proc/self/fd/") + entry->d_name;
+		if ((readlink(path.c_str(), target, sizeof(target) - 1) > 0) &&
+		    (std::string(target).find("memfd:lib-streamlabs-ipc") != std::string::npos)) {
+			fds.push_back(atoi(entry->d_name));
+		}
+	}
+	closedir(dir);
+	return fds;
+}
+
+// Echoes payloads around the ring size, returns the bad replies.
+static size_t run_echo(std::shared_ptr<ipc::client> client)
+{
+	size_t errors = 0;
+	std::vector<size_t> sizes = {0, 1, 4096, os::linux::shm_channel::default_capacity - 1, os::linux::shm_channel::default_capacity + 1,
+				     4 * os::linux::shm_channel::default_capacity};
+	for (size_t size : sizes) {
+		std::vector<char> payload(size);
+		for (size_t idx = 0; idx < size; idx++) {
+			payload[idx] = char(idx * 31 + size);
+		}
+		for (size_t idx = 0; idx < 8; idx++) {
+			std::vector<ipc::value> rval = client->call_synchronous_helper("Ring", "Echo", {ipc::value(payload)});
+			if ((rval.size() != 2) || (rval[1].value_bin() != payload)) {
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+template<typename F> static bool wait_for(F done)
+{
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!done()) {
+		if (std::chrono::steady_clock::now() > end) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+// Calls over a connection without shared memory.
+static size_t run_socket()
+{
+	os::linux::socket_linux::set_shared_memory(0);
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+	size_t errors = run_echo(client);
+	size_t regions = find_regions().size();
+	printf("Socket only  | Bad replies %zu | Regions %zu\n", errors, regions);
+	errors += regions;
+	client->stop();
+	os::linux::socket_linux::set_shared_memory(os::linux::shm_channel::default_capacity);
+	return errors;
+}
+
+// Moves the head of the ring the server reads four rings ahead.
+static size_t run_corrupt()
+{
+	std::atomic<bool> dropped(false);
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, [&dropped]() { dropped = true; });
+	size_t errors = run_echo(client);
+	std::vector<int> regions = find_regions();
+	if (regions.empty()) {
+		printf("Corrupt ring | No shared memory region\n");
+		client->stop();
+		return errors + 1;
+	}
+
+	struct stat st;
+	fstat(regions[0], &st);
+	void *base = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, regions[0], 0);
+	if (base == MAP_FAILED) {
+		printf("Corrupt ring | Mapping failed\n");
+		client->stop();
+		return errors + 1;
+	}
+	layout *header = reinterpret_cast<layout *>(base);
+	header->rings[0].head += 4 * header->capacity;
+	munmap(base, size_t(st.st_size));
+
+	size_t disconnects = g_disconnects;
+	std::vector<ipc::value> rval = client->call_synchronous_helper("Ring", "Echo", {ipc::value(std::vector<char>(4096, 'z'))});
+	bool client_dropped = wait_for([&dropped]() { return dropped.load(); });
+	bool server_dropped = wait_for([disconnects]() { return g_disconnects > disconnects; });
+	bool echoed = (rval.size() == 2);
+	printf("Corrupt ring | Echoed %s | Client dropped %s | Server dropped %s\n", echoed ? "yes" : "no", client_dropped ? "yes" : "no",
+	       server_dropped ? "yes" : "no");
+	errors += echoed ? 1 : 0;
+	errors += client_dropped ? 0 : 1;
+	errors += server_dropped ? 0 : 1;
+	client->stop();
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Ring");
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{ipc::type::Binary}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	size_t errors = run_socket();
+	errors += run_corrupt();
+
+	// The server keeps serving everyone else.
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+	size_t after = run_echo(client);
+	printf("Afterwards   | Bad replies %zu\n", after);
+	errors += after;
+	client->stop();
+
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,228 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include "ipc-stream.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+// Uploads a large payload once as a single Binary value and once as a stream,
+// while another thread pings the server over the same connection. The ping
+// latency shows whether the upload blocks the connection, the peak resident
+// memory growth shows the copies a payload takes.
+
+#ifdef _WIN32
+#define CONN "StreamBinaryIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-stream-binary"
+#endif
+#define PAYLOAD (64 * 1024 * 1024)
+#define PIECE (1024 * 1024)
+
+static char pattern(size_t idx)
+{
+	return char(idx * 31 + (idx >> 12));
+}
+
+static uint64_t checksum(uint64_t sum, const char *data, size_t length)
+{
+	for (size_t idx = 0; idx < length; idx++) {
+		sum = sum * 1099511628211ull + uint8_t(data[idx]);
+	}
+	return sum;
+}
+
+static void upload(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(ipc::value(checksum(0, args[0].value_bin().data(), args[0].value_bin().size())));
+}
+
+static void upload_stream(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	std::shared_ptr<ipc::stream_reader> reader = ipc::stream_reader::open(args[0].value_union.ui64);
+	std::vector<char> buffer(PIECE);
+	uint64_t sum = 0;
+	while (size_t size = reader->read(buffer.data(), buffer.size())) {
+		sum = checksum(sum, buffer.data(), size);
+	}
+	rval.push_back(ipc::value((uint64_t)(reader->failed() ? 1 : 0)));
+	rval.push_back(ipc::value(sum));
+}
+
+// Turns the upload down without reading it.
+static void reject(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	std::shared_ptr<ipc::stream_reader> reader = ipc::stream_reader::open(args[0].value_union.ui64);
+	rval.push_back(ipc::value((uint64_t)1));
+}
+
+// Writes until a write fails, false if |bytes| went through.
+static bool refused(std::shared_ptr<ipc::stream_writer> writer, size_t bytes)
+{
+	std::vector<char> piece(PIECE);
+	for (size_t idx = 0; idx < bytes; idx += PIECE) {
+		if (!writer->write(piece.data(), piece.size())) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void ping(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+static double peak_mib()
+{
+#ifdef __linux__
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / 1024.0;
+#else
+	return 0;
+#endif
+}
+
+// Pings every millisecond until |stop|, returns the slowest round trip.
+static std::thread pinger(std::shared_ptr<ipc::client> client, std::atomic_bool &stop, double &slowest)
+{
+	return std::thread([client, &stop, &slowest]() {
+		slowest = 0;
+		while (!stop) {
+			auto start = std::chrono::high_resolution_clock::now();
+			client->call_synchronous_helper("Files", "Ping", {});
+			slowest = std::max(slowest, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+}
+
+static bool report(const char *name, std::chrono::high_resolution_clock::time_point start, double peak_before, double slowest, bool valid)
+{
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("%-6s | %8.0f | %14.0f | %13.1f | %s\n", name, PAYLOAD / seconds / (1024 * 1024), peak_mib() - peak_before, slowest, valid ? "ok" : "failed");
+	return valid;
+}
+
+int main(int argc, char *argv[])
+{
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Files");
+	collection->register_function(std::make_shared<ipc::function>("Upload", std::vector<ipc::type>{ipc::type::Binary}, upload));
+	collection->register_function(std::make_shared<ipc::function>("UploadStream", std::vector<ipc::type>{ipc::type::UInt64}, upload_stream));
+	collection->register_function(std::make_shared<ipc::function>("Reject", std::vector<ipc::type>{ipc::type::UInt64}, reject));
+	collection->register_function(std::make_shared<ipc::function>("Ping", std::vector<ipc::type>{}, ping));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	// Stream readers wait for chunks, which must not hold up the connection.
+	server.set_executor_threads(2);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+	client->call_synchronous_helper("Files", "Ping", {});
+
+	uint64_t expected = 0;
+	for (size_t idx = 0; idx < PAYLOAD; idx += PIECE) {
+		char piece[4096];
+		for (size_t offset = 0; offset < PIECE; offset += sizeof(piece)) {
+			for (size_t pos = 0; pos < sizeof(piece); pos++) {
+				piece[pos] = pattern(idx + offset + pos);
+			}
+			expected = checksum(expected, piece, sizeof(piece));
+		}
+	}
+
+	size_t errors = 0;
+	printf("Mode   |    MiB/s | Peak RSS (MiB) | Ping max (ms) | Data\n");
+
+	// The stream is produced piece by piece, the whole payload never exists.
+	{
+		std::shared_ptr<ipc::stream_writer> writer = client->open_stream();
+		if (!writer) {
+			printf("Streams are not supported\n");
+			return 1;
+		}
+
+		std::atomic_bool stop = false;
+		double slowest = 0;
+		double peak_before = peak_mib();
+		auto start = std::chrono::high_resolution_clock::now();
+		std::thread pings = pinger(client, stop, slowest);
+
+		ipc::call_future future = client->call_async("Files", "UploadStream", {ipc::value(writer->id())});
+		std::vector<char> piece(PIECE);
+		for (size_t idx = 0; idx < PAYLOAD; idx += PIECE) {
+			for (size_t pos = 0; pos < PIECE; pos++) {
+				piece[pos] = pattern(idx + pos);
+			}
+			writer->write(piece.data(), piece.size());
+		}
+		writer->close();
+		std::vector<ipc::value> rval = future.get();
+
+		stop = true;
+		pings.join();
+		bool valid = rval.size() == 2 && rval[0].value_union.ui64 == 0 && rval[1].value_union.ui64 == expected;
+		errors += report("stream", start, peak_before, slowest, valid) ? 0 : 1;
+	}
+
+	{
+		std::atomic_bool stop = false;
+		double slowest = 0;
+		double peak_before = peak_mib();
+		auto start = std::chrono::high_resolution_clock::now();
+		std::thread pings = pinger(client, stop, slowest);
+
+		std::vector<char> payload(PAYLOAD);
+		for (size_t idx = 0; idx < PAYLOAD; idx++) {
+			payload[idx] = pattern(idx);
+		}
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Files", "Upload", {ipc::value(payload)});
+
+		stop = true;
+		pings.join();
+		errors += report("binary", start, peak_before, slowest, rval.size() == 2 && rval[1].value_union.ui64 == expected) ? 0 : 1;
+	}
+
+	// Dropping the reader early resets the stream, the writer must not wait
+	// for credit that never comes.
+	{
+		std::shared_ptr<ipc::stream_writer> writer = client->open_stream();
+		client->call_synchronous_helper("Files", "Reject", {ipc::value(writer->id())});
+		bool failed = refused(writer, 4 * ipc::stream_writer::window);
+		printf("\nRejected upload: %s\n", failed ? "reset" : "kept going");
+		errors += failed ? 0 : 1;
+	}
+
+	// Streams nobody opens are limited, the oldest one gets reset.
+	{
+		std::vector<std::shared_ptr<ipc::stream_writer>> writers;
+		for (size_t idx = 0; idx <= ipc::stream_table::max_unopened; idx++) {
+			writers.push_back(client->open_stream());
+			writers.back()->write("x", 1);
+		}
+		bool failed = refused(writers.front(), 4 * ipc::stream_writer::window);
+		printf("Unopened streams: %s\n", failed ? "oldest reset" : "kept going");
+		errors += failed ? 0 : 1;
+	}
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
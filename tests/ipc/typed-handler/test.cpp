@@ -0,0 +1,123 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Compares a handler that unpacks its arguments by hand with the same
+// function registered through collection::register_typed(), first by calling
+// the functions directly and then over a connection.
+
+#ifdef _WIN32
+#define CONN "TypedHandlerIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-typed-handler"
+#endif
+#define DURATION std::chrono::milliseconds(500)
+
+static void scale_raw(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	int64_t factor = args[0].value_union.i64;
+	const std::string &name = args[1].value_str;
+	const std::vector<char> &samples = args[2].value_bin();
+	rval.push_back(ipc::value(int64_t(factor * int64_t(samples.size()))));
+	rval.push_back(ipc::value(uint32_t(name.size())));
+}
+
+static std::tuple<int64_t, uint32_t> scale_typed(int64_t factor, std::string_view name, ipc::span<const char> samples)
+{
+	return {factor * int64_t(samples.size()), uint32_t(name.size())};
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+template<typename F> static double rate(F fn)
+{
+	size_t count = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	auto end = start + DURATION;
+	do {
+		for (size_t idx = 0; idx < 16; idx++) {
+			fn();
+		}
+		count += 16;
+	} while (std::chrono::high_resolution_clock::now() < end);
+	return count / std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static bool check(const std::vector<ipc::value> &rval, size_t samples)
+{
+	return (rval.size() == 2) && (rval[0].value_union.i64 == int64_t(3 * samples)) && (rval[1].value_union.ui32 == 6);
+}
+
+// Rejected calls reply with a single Null value carrying the reason, returns 1
+// if the call was accepted or failed for another reason.
+static size_t expect_rejected(const char *what, const std::vector<ipc::value> &rval, const char *error)
+{
+	bool rejected = (rval.size() == 1) && (rval[0].type == ipc::type::Null);
+	printf("%-11s: %s\n", what, rejected ? rval[0].value_str.c_str() : "accepted");
+	return (rejected && (rval[0].value_str == error)) ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(
+		std::make_shared<ipc::function>("ScaleRaw", std::vector<ipc::type>{ipc::type::Int64, ipc::type::String, ipc::type::Binary}, scale_raw));
+	collection->register_typed<&scale_typed>("ScaleTyped");
+	printf("Unique names: %s %s\n\n", collection->get_function("ScaleRaw")->get_unique_name().c_str(),
+	       collection->get_function("ScaleTyped")->get_unique_name().c_str());
+
+	ipc::server server;
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	size_t failed = 0;
+	printf("Samples | Direct raw/s | Direct typed/s | Remote raw/s | Remote typed/s | Errors\n");
+
+	for (size_t samples : {16, 4096, 262144}) {
+		std::vector<ipc::value> args = {ipc::value(int64_t(3)), ipc::value(std::string("camera")), ipc::value(std::vector<char>(samples, 1))};
+		std::vector<ipc::value_view> views(args.begin(), args.end());
+		size_t errors = 0;
+
+		// The server hands handlers views into the receive buffer.
+		double rates[4];
+		for (int idx = 0; idx < 2; idx++) {
+			std::shared_ptr<ipc::function> fn = collection->get_function(idx == 0 ? "ScaleRaw" : "ScaleTyped");
+			rates[idx] = rate([&]() {
+				std::vector<ipc::value> rval;
+				fn->call(0, views, rval);
+				errors += check(rval, samples) ? 0 : 1;
+			});
+		}
+		for (int idx = 0; idx < 2; idx++) {
+			const char *name = idx == 0 ? "ScaleRaw" : "ScaleTyped";
+			rates[2 + idx] = rate([&]() { errors += check(client->call_synchronous_helper("Bench", name, args), samples) ? 0 : 1; });
+		}
+		printf("%7zu | %12.0f | %14.0f | %12.0f | %14.0f | %6zu\n", samples, rates[0], rates[1], rates[2], rates[3], errors);
+		failed += errors;
+	}
+
+	// Typed functions turn arguments of the wrong count or type away before running.
+	std::vector<ipc::value> wrong_count = {ipc::value(uint32_t(3))};
+	std::vector<ipc::value> wrong_type = {ipc::value(uint32_t(3)), ipc::value(std::string("camera")), ipc::value(std::vector<char>(16, 1))};
+	printf("\n");
+	failed += expect_rejected("Wrong count", client->call_synchronous_helper("Bench", "ScaleTyped", wrong_count),
+				  "Function 'ScaleTyped' takes 3 arguments, got 1.");
+	failed += expect_rejected("Wrong type", client->call_synchronous_helper("Bench", "ScaleTyped", wrong_type),
+				  "Argument 0 of function 'ScaleTyped' has the wrong type.");
+
+	client->stop();
+	server.finalize();
+	return failed == 0 ? 0 : 1;
+}
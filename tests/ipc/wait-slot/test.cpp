@@ -0,0 +1,175 @@
+#include "ipc-server.hpp"
+#include "ipc-client.hpp"
+#include "ipc-wait-slot.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif __APPLE__
+#include <fcntl.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#else
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+// Per call cost of waking a synchronous caller. "kernel" is what the clients
+// used to do: create a semaphore (eventfd, CreateSemaphore or sem_open) for
+// every call. "slot" is the per thread ipc::wait_slot. A responder thread
+// plays the reply thread, then real synchronous calls are measured as well.
+
+#ifdef _WIN32
+#define CONN "WaitSlotIPC"
+#else
+#define CONN "/tmp/lib-streamlabs-ipc-wait-slot"
+#endif
+#define ROUNDS 20000
+#define DURATION std::chrono::seconds(1)
+
+struct kernel_wait {
+#ifdef _WIN32
+	HANDLE handle = CreateSemaphoreW(NULL, 0, 1, NULL);
+	~kernel_wait() { CloseHandle(handle); }
+	void signal() { ReleaseSemaphore(handle, 1, NULL); }
+	void wait() { WaitForSingleObject(handle, INFINITE); }
+#elif __APPLE__
+	std::string path = "/tmp/sem-bench" + std::to_string(rand());
+	sem_t *sem = sem_open(path.c_str(), O_CREAT | O_EXCL, 0644, 0);
+	~kernel_wait()
+	{
+		sem_close(sem);
+		sem_unlink(path.c_str());
+	}
+	void signal() { sem_post(sem); }
+	void wait() { sem_wait(sem); }
+#else
+	int fd = eventfd(0, EFD_CLOEXEC);
+	~kernel_wait() { close(fd); }
+	void signal()
+	{
+		uint64_t value = 1;
+		(void)!write(fd, &value, sizeof(value));
+	}
+	void wait()
+	{
+		uint64_t value;
+		(void)!read(fd, &value, sizeof(value));
+	}
+#endif
+};
+
+struct slot_wait {
+	ipc::wait_slot *slot = &ipc::wait_slot::local();
+	std::atomic_bool called = false;
+	void signal()
+	{
+		ipc::wait_slot *local = slot;
+		called = true;
+		local->signal();
+	}
+	void wait()
+	{
+		while (!called) {
+			slot->wait(std::chrono::seconds(1));
+		}
+	}
+};
+
+// Hands each request to a responder thread that signals it right back.
+template<typename T> static double ping_pong()
+{
+	std::atomic<T *> request = nullptr;
+	std::atomic_bool stop = false;
+	ipc::wait_slot *responder_slot = nullptr;
+	std::atomic_bool ready = false;
+
+	std::thread responder([&]() {
+		responder_slot = &ipc::wait_slot::local();
+		ready = true;
+		while (!stop) {
+			T *item = request.exchange(nullptr);
+			if (item) {
+				item->signal();
+			} else {
+				responder_slot->wait(std::chrono::milliseconds(10));
+			}
+		}
+	});
+	while (!ready) {
+		std::this_thread::yield();
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t round = 0; round < ROUNDS; round++) {
+		T item;
+		request = &item;
+		responder_slot->signal();
+		item.wait();
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+
+	stop = true;
+	responder_slot->signal();
+	responder.join();
+	return ns;
+}
+
+template<typename T> static double create_only()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t round = 0; round < ROUNDS; round++) {
+		T item;
+		item.signal();
+		item.wait();
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / ROUNDS;
+}
+
+static void echo(void *data, const int64_t id, const std::vector<ipc::value> &args, std::vector<ipc::value> &rval)
+{
+	rval.push_back(ipc::value((uint64_t)0));
+	rval.push_back(args[0]);
+}
+
+static bool on_connect(void *data, int64_t id)
+{
+	return true;
+}
+
+static void on_disconnect(void *data, int64_t id) {}
+
+int main(int argc, char *argv[])
+{
+	printf("Wait   | Same thread (ns) | Cross thread (ns)\n");
+	printf("kernel | %16.0f | %17.0f\n", create_only<kernel_wait>(), ping_pong<kernel_wait>());
+	printf("slot   | %16.0f | %17.0f\n", create_only<slot_wait>(), ping_pong<slot_wait>());
+
+	ipc::server server;
+	std::shared_ptr<ipc::collection> collection = std::make_shared<ipc::collection>("Bench");
+	collection->register_function(std::make_shared<ipc::function>("Echo", std::vector<ipc::type>{ipc::type::UInt64}, echo));
+	server.register_collection(collection);
+	server.set_connect_handler(on_connect, nullptr);
+	server.set_disconnect_handler(on_disconnect, nullptr);
+	server.initialize(CONN);
+
+	std::shared_ptr<ipc::client> client = ipc::client::create(CONN, []() {});
+
+	size_t completed = 0, errors = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	while (std::chrono::high_resolution_clock::now() < start + DURATION) {
+		std::vector<ipc::value> rval = client->call_synchronous_helper("Bench", "Echo", {ipc::value(uint64_t(completed))});
+		errors += (rval.size() == 2 && rval[1].value_union.ui64 == completed) ? 0 : 1;
+		completed++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("\nSynchronous calls/s: %.0f, errors: %zu\n", completed / seconds, errors);
+
+	client->stop();
+	server.finalize();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+#include "ipc.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Compares the v1 and v2 wire formats on call mixes like the ones the
+// frontend sends: message size per call and reply, and how many of them can
+// be encoded and decoded per second.
+
+#define DURATION std::chrono::milliseconds(500)
+
+struct sample {
+	const char *name;
+	ipc::message::function_call call;
+	ipc::message::function_reply reply;
+};
+
+static ipc::message::function_call make_call(uint64_t uid, ipc::value cname, ipc::value fname, std::vector<ipc::value> args)
+{
+	ipc::message::function_call call;
+	call.uid = ipc::value(uid);
+	call.class_name = std::move(cname);
+	call.function_name = std::move(fname);
+	call.arguments = std::move(args);
+	return call;
+}
+
+static ipc::message::function_reply make_reply(uint64_t uid, std::vector<ipc::value> values)
+{
+	ipc::message::function_reply reply;
+	reply.uid = ipc::value(uid);
+	reply.values = std::move(values);
+	return reply;
+}
+
+static std::vector<sample> make_samples()
+{
+	std::vector<sample> samples;
+	uint64_t uid = 12345;
+
+	samples.push_back({"int getter",
+			   make_call(uid, ipc::value("Scene"), ipc::value("GetItemCount"), {ipc::value(uint64_t(42))}),
+			   make_reply(uid, {ipc::value(uint64_t(0)), ipc::value(uint32_t(7))})});
+	uid++;
+
+	samples.push_back({"string setter",
+			   make_call(uid, ipc::value("Source"), ipc::value("SetName"), {ipc::value(std::string("source_0f3a9b2c")), ipc::value("Webcam (front)")}),
+			   make_reply(uid, {ipc::value(uint64_t(0))})});
+	uid++;
+
+	samples.push_back({"id call",
+			   make_call(uid, ipc::value(uint32_t(17)), ipc::value(), {ipc::value(std::string("source_0f3a9b2c")), ipc::value(int32_t(-1)), ipc::value(1.0f)}),
+			   make_reply(uid, {ipc::value(uint64_t(0)), ipc::value(int64_t(-3)), ipc::value(0.5)})});
+	uid++;
+
+	samples.push_back({"thumbnail",
+			   make_call(uid, ipc::value("Video"), ipc::value("GetThumbnail"), {ipc::value(uint32_t(320)), ipc::value(uint32_t(180))}),
+			   make_reply(uid, {ipc::value(uint64_t(0)), ipc::value(std::vector<char>(320 * 180 * 4, 'x'))})});
+	uid++;
+
+	return samples;
+}
+
+template<typename T>
+static double rate(T fn)
+{
+	size_t count = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	auto end = start + DURATION;
+	while (std::chrono::high_resolution_clock::now() < end) {
+		for (size_t i = 0; i < 100; i++) {
+			fn();
+		}
+		count += 100;
+	}
+	return count / std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Decoding and encoding again has to give back the same bytes in both formats.
+static bool round_trips(sample &s, std::vector<char> &call_v1, std::vector<char> &call_v2, std::vector<char> &reply_v1, std::vector<char> &reply_v2)
+{
+	ipc::message::function_call call;
+	ipc::message::function_call_view view;
+	ipc::message::function_reply reply, reply2;
+	if (call.deserialize(call_v1, 0) != call_v1.size() || view.deserialize_v2(call_v2, 0) != call_v2.size() ||
+	    view.arguments.size() != s.call.arguments.size() || reply.deserialize(reply_v1, 0) != reply_v1.size() ||
+	    reply2.deserialize_v2(reply_v2, 0) != reply_v2.size()) {
+		return false;
+	}
+
+	std::vector<char> call_again(call.size()), reply_again(reply.size()), reply2_again(reply2.size_v2());
+	call.serialize(call_again, 0);
+	reply.serialize(reply_again, 0);
+	reply2.serialize_v2(reply2_again, 0);
+	return (call_again == call_v1) && (reply_again == reply_v1) && (reply2_again == reply_v2);
+}
+
+static bool run(sample &s)
+{
+	std::vector<char> call_v1(s.call.size()), call_v2(s.call.size_v2());
+	std::vector<char> reply_v1(s.reply.size()), reply_v2(s.reply.size_v2());
+	s.call.serialize(call_v1, 0);
+	s.call.serialize_v2(call_v2, 0);
+	s.reply.serialize(reply_v1, 0);
+	s.reply.serialize_v2(reply_v2, 0);
+
+	ipc::message::function_call_view view;
+	double enc_v1 = rate([&]() {
+		std::vector<char> buf(s.call.size() + sizeof(ipc::ipc_size_t));
+		s.call.serialize(buf, sizeof(ipc::ipc_size_t));
+		ipc::make_sendable(buf, ipc::wire_v1);
+	});
+	double enc_v2 = rate([&]() {
+		std::vector<char> buf(s.call.size_v2() + sizeof(ipc::ipc_size_t));
+		s.call.serialize_v2(buf, sizeof(ipc::ipc_size_t));
+		ipc::make_sendable(buf, ipc::wire_v2);
+	});
+	double dec_v1 = rate([&]() {
+		ipc::message::function_reply reply;
+		view.deserialize(call_v1, 0);
+		reply.deserialize(reply_v1, 0);
+	});
+	double dec_v2 = rate([&]() {
+		ipc::message::function_reply reply;
+		view.deserialize_v2(call_v2, 0);
+		reply.deserialize_v2(reply_v2, 0);
+	});
+
+	bool valid = round_trips(s, call_v1, call_v2, reply_v1, reply_v2);
+	printf("%-14s | %7zu %7zu | %7zu %7zu | %10.0f %10.0f | %10.0f %10.0f | %s\n", s.name, call_v1.size(), call_v2.size(), reply_v1.size(), reply_v2.size(),
+	       enc_v1, enc_v2, dec_v1, dec_v2, valid ? "ok" : "failed");
+	return valid;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<sample> samples = make_samples();
+
+	size_t errors = 0;
+	printf("Message        |   Call bytes    |  Reply bytes    |  Encodes/s (call)     |  Decodes/s (call+reply) | Round trip\n");
+	printf("               |      v1      v2 |      v1      v2 |         v1         v2 |         v1         v2 |\n");
+	for (sample &s : samples) {
+		errors += run(s) ? 0 : 1;
+	}
+	return errors == 0 ? 0 : 1;
+}